@@ -0,0 +1,8138 @@
+#ifndef BIDIRECTIONAL_LIST_H_
+#define BIDIRECTIONAL_LIST_H_
+
+#include <iterator>
+#include <vector>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <span>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <limits>
+#include <array>
+#include <string>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BIDIRECTIONAL_LIST_X86_SIMD
+#endif
+
+#if __has_include(<unistd.h>)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#define BIDIRECTIONAL_LIST_POSIX
+#endif
+
+#if defined(BIDIRECTIONAL_LIST_POSIX) && __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define BIDIRECTIONAL_LIST_MMAP
+#endif
+
+// Пул памяти для узлов списка. Память выделяется блоками, выровненными по
+// кэш-линии, и нарезается на ячейки фиксированного размера; освобождённые
+// ячейки попадают в список свободных и переиспользуются без обращения к куче.
+// Пул не потокобезопасен, как и сам BiDirectionalList.
+class NodePool {
+ public:
+  static constexpr size_t kCacheLineSize = 64;
+  static constexpr size_t kBlockSize = 4096;
+  static constexpr size_t kSlotAlignment = 16;
+  static constexpr size_t kMaxSlotSize = 256;
+
+  NodePool() = default;
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  ~NodePool() { ReleaseAll(); }
+
+  void* Allocate(size_t size, size_t alignment);
+  void Deallocate(void* pointer, size_t size, size_t alignment);
+
+  void Reserve(size_t size, size_t alignment, size_t count);
+  void ReleaseAll();
+
+  // Число блоков, взятых у кучи. Пока хватает свободных ячеек, не растёт.
+  size_t BlockCount() const { return blocks_.size(); }
+
+ private:
+  struct FreeSlot {
+    FreeSlot* next_slot_;
+  };
+
+  struct SizeClass {
+    FreeSlot* free_slots_ = nullptr;
+    char* bump_begin_ = nullptr;
+    char* bump_end_ = nullptr;
+  };
+
+  static constexpr size_t kSizeClassCount = kMaxSlotSize / kSlotAlignment;
+
+  SizeClass size_classes_[kSizeClassCount];
+  std::vector<void*> blocks_;
+
+  static bool IsPooled(size_t size, size_t alignment) {
+    return size != 0 && size <= kMaxSlotSize && alignment <= kSlotAlignment;
+  }
+  static size_t SizeClassIndex(size_t size) {
+    return (size + kSlotAlignment - 1) / kSlotAlignment - 1;
+  }
+  static size_t SlotSize(size_t index) {
+    return (index + 1) * kSlotAlignment;
+  }
+
+  void AllocateBlock(SizeClass& size_class, size_t bytes);
+};
+
+inline void* NodePool::Allocate(size_t size, size_t alignment) {
+  if (!IsPooled(size, alignment)) {
+    return ::operator new(size, std::align_val_t(alignment));
+  }
+  size_t index = SizeClassIndex(size);
+  SizeClass& size_class = size_classes_[index];
+  if (size_class.free_slots_ != nullptr) {
+    FreeSlot* slot = size_class.free_slots_;
+    size_class.free_slots_ = slot->next_slot_;
+    return slot;
+  }
+  size_t slot_size = SlotSize(index);
+  if (size_class.bump_begin_ == size_class.bump_end_) {
+    AllocateBlock(size_class, kBlockSize - kBlockSize % slot_size);
+  }
+  void* slot = size_class.bump_begin_;
+  size_class.bump_begin_ += slot_size;
+  return slot;
+}
+
+inline void NodePool::Deallocate(void* pointer, size_t size,
+                                 size_t alignment) {
+  if (!IsPooled(size, alignment)) {
+    ::operator delete(pointer, std::align_val_t(alignment));
+    return;
+  }
+  SizeClass& size_class = size_classes_[SizeClassIndex(size)];
+  FreeSlot* slot = static_cast<FreeSlot*>(pointer);
+  slot->next_slot_ = size_class.free_slots_;
+  size_class.free_slots_ = slot;
+}
+
+inline void NodePool::Reserve(size_t size, size_t alignment, size_t count) {
+  if (!IsPooled(size, alignment)) {
+    return;
+  }
+  size_t index = SizeClassIndex(size);
+  SizeClass& size_class = size_classes_[index];
+  size_t slot_size = SlotSize(index);
+  size_t available = (size_class.bump_end_ - size_class.bump_begin_) /
+      slot_size;
+  for (FreeSlot* slot = size_class.free_slots_;
+       slot != nullptr && available < count; slot = slot->next_slot_) {
+    ++available;
+  }
+  if (available >= count) {
+    return;
+  }
+  // Остаток текущего блока отдаём в список свободных, чтобы не потерять его.
+  while (size_class.bump_begin_ != size_class.bump_end_) {
+    Deallocate(size_class.bump_begin_, size, alignment);
+    size_class.bump_begin_ += slot_size;
+  }
+  AllocateBlock(size_class, (count - available) * slot_size);
+}
+
+inline void NodePool::ReleaseAll() {
+  for (void* block : blocks_) {
+    ::operator delete(block, std::align_val_t(kCacheLineSize));
+  }
+  blocks_.clear();
+  for (SizeClass& size_class : size_classes_) {
+    size_class = SizeClass();
+  }
+}
+
+inline void NodePool::AllocateBlock(SizeClass& size_class, size_t bytes) {
+  blocks_.reserve(blocks_.size() + 1);
+  char* block = static_cast<char*>(
+      ::operator new(bytes, std::align_val_t(kCacheLineSize)));
+  blocks_.push_back(block);
+  size_class.bump_begin_ = block;
+  size_class.bump_end_ = block + bytes;
+}
+
+// Стандартный аллокатор поверх NodePool. Копии аллокатора (в том числе
+// полученные через rebind) разделяют один пул и поэтому равны между собой.
+template<typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  PoolAllocator() : pool_(std::make_shared<NodePool>()) {}
+
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool_) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(pool_->Allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* pointer, size_t count) {
+    pool_->Deallocate(pointer, count * sizeof(T), alignof(T));
+  }
+
+  void Reserve(size_t count) {
+    pool_->Reserve(sizeof(T), alignof(T), count);
+  }
+
+  size_t BlockCount() const {
+    return pool_->BlockCount();
+  }
+
+  // Освобождает все блоки пула разом. Возможно, только если пулом больше
+  // никто не пользуется, иначе возвращает false и ничего не делает.
+  bool TryReleaseAll() {
+    if (pool_.use_count() != 1) {
+      return false;
+    }
+    pool_->ReleaseAll();
+    return true;
+  }
+
+  template<typename U>
+  bool operator==(const PoolAllocator<U>& other) const {
+    return pool_ == other.pool_;
+  }
+  template<typename U>
+  bool operator!=(const PoolAllocator<U>& other) const {
+    return pool_ != other.pool_;
+  }
+
+ private:
+  template<typename U>
+  friend class PoolAllocator;
+
+  std::shared_ptr<NodePool> pool_;
+};
+
+template<typename Allocator, typename = void>
+struct HasTryReleaseAll : std::false_type {};
+template<typename Allocator>
+struct HasTryReleaseAll<Allocator, std::void_t<
+    decltype(std::declval<Allocator&>().TryReleaseAll())>> : std::true_type {};
+
+template<typename Allocator, typename = void>
+struct HasReserve : std::false_type {};
+template<typename Allocator>
+struct HasReserve<Allocator, std::void_t<
+    decltype(std::declval<Allocator&>().Reserve(size_t()))>>
+    : std::true_type {};
+
+// Двоичный формат Save/Load. Заголовок (ListFileHeader) содержит сигнатуру,
+// версию, размер элемента (0 для элементов переменной длины) и число
+// элементов. За ним идут куски: число элементов и длина в байтах, затем сами
+// байты; пустой кусок завершает список. Куски ограничены kChunkBytes (кроме
+// куска с единственным большим элементом), поэтому файл можно читать по
+// частям в ограниченной памяти. Порядок байтов -- родной для платформы.
+struct ListFileHeader {
+  static constexpr uint64_t kMagic = 0x31564153494c4442;  // "BDLISAV1"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kChunkBytes = 1 << 16;
+
+  uint64_t magic_;
+  uint32_t version_;
+  uint32_t value_size_;
+  uint64_t size_;
+};
+
+// Кодирование элементов для Save/Load. Тривиально копируемые элементы
+// пишутся побайтово, std::string -- длиной и байтами. Другие типы
+// подключаются специализацией с теми же членами. kMaxValueBytes ограничивает
+// закодированный элемент, а с ним и кусок, который читатель согласен
+// разместить в памяти.
+template<typename T, typename Enable = void>
+struct ListCodec;
+
+template<typename T>
+struct ListCodec<T, std::enable_if_t<std::is_trivially_copyable_v<T>>> {
+  static constexpr uint32_t kValueSize = sizeof(T);
+  static constexpr size_t kMaxValueBytes = sizeof(T);
+
+  static void Encode(const T& value, std::vector<char>& buffer) {
+    size_t size = buffer.size();
+    buffer.resize(size + sizeof(T));
+    std::memcpy(buffer.data() + size, &value, sizeof(T));
+  }
+  static T Decode(const char*& position, const char* end) {
+    if (static_cast<size_t>(end - position) < sizeof(T)) {
+      throw std::runtime_error("Impossible to read truncated list");
+    }
+    std::array<char, sizeof(T)> bytes;
+    std::memcpy(bytes.data(), position, sizeof(T));
+    position += sizeof(T);
+    return std::bit_cast<T>(bytes);
+  }
+};
+
+template<>
+struct ListCodec<std::string> {
+  static constexpr uint32_t kValueSize = 0;
+  static constexpr size_t kMaxLength = size_t(1) << 30;
+  static constexpr size_t kMaxValueBytes = sizeof(uint64_t) + kMaxLength;
+
+  static void Encode(const std::string& value, std::vector<char>& buffer) {
+    if (value.size() > kMaxLength) {
+      throw std::runtime_error("Impossible to save string longer than 1 GiB");
+    }
+    uint64_t length = value.size();
+    size_t size = buffer.size();
+    buffer.resize(size + sizeof(length) + value.size());
+    std::memcpy(buffer.data() + size, &length, sizeof(length));
+    std::memcpy(buffer.data() + size + sizeof(length), value.data(),
+                value.size());
+  }
+  static std::string Decode(const char*& position, const char* end) {
+    uint64_t length;
+    if (static_cast<size_t>(end - position) < sizeof(length)) {
+      throw std::runtime_error("Impossible to read truncated list");
+    }
+    std::memcpy(&length, position, sizeof(length));
+    position += sizeof(length);
+    if (static_cast<uint64_t>(end - position) < length) {
+      throw std::runtime_error("Impossible to read truncated list");
+    }
+    std::string value(position, length);
+    position += length;
+    return value;
+  }
+};
+
+// Приёмник и источник байтов для Save/Load: поток или файловый дескриптор.
+class ListByteSink {
+ public:
+  explicit ListByteSink(std::ostream& stream) : stream_(&stream), fd_(-1) {}
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  explicit ListByteSink(int fd) : stream_(nullptr), fd_(fd) {}
+#endif
+
+  void Write(const void* data, size_t size);
+
+ private:
+  std::ostream* stream_;
+  int fd_;
+};
+
+class ListByteSource {
+ public:
+  explicit ListByteSource(std::istream& stream)
+      : stream_(&stream), fd_(-1) {}
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  explicit ListByteSource(int fd) : stream_(nullptr), fd_(fd) {}
+#endif
+
+  void Read(void* data, size_t size);
+
+ private:
+  std::istream* stream_;
+  int fd_;
+};
+
+inline void ListByteSink::Write(const void* data, size_t size) {
+  if (stream_ != nullptr) {
+    if (!stream_->write(static_cast<const char*>(data),
+                        static_cast<std::streamsize>(size))) {
+      throw std::runtime_error("Impossible to write list");
+    }
+    return;
+  }
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  const char* position = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = ::write(fd_, position, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      throw std::runtime_error("Impossible to write list");
+    }
+    position += written;
+    size -= static_cast<size_t>(written);
+  }
+#endif
+}
+
+inline void ListByteSource::Read(void* data, size_t size) {
+  if (stream_ != nullptr) {
+    if (!stream_->read(static_cast<char*>(data),
+                       static_cast<std::streamsize>(size))) {
+      throw std::runtime_error("Impossible to read truncated list");
+    }
+    return;
+  }
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  char* position = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t count = ::read(fd_, position, size);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      throw std::runtime_error("Impossible to read list");
+    }
+    if (count == 0) {
+      throw std::runtime_error("Impossible to read truncated list");
+    }
+    position += count;
+    size -= static_cast<size_t>(count);
+  }
+#endif
+}
+
+// Пишет список из size элементов в формате ListFileHeader. visit(encode)
+// должна вызвать encode(value) для каждого элемента по порядку. Кусок
+// собирается в буфере вместе с префиксом и уходит одной записью.
+template<typename T, typename Visit>
+void SaveList(ListByteSink& sink, uint64_t size, Visit visit) {
+  ListFileHeader header{ListFileHeader::kMagic, ListFileHeader::kVersion,
+                        ListCodec<T>::kValueSize, size};
+  sink.Write(&header, sizeof(header));
+  uint64_t prefix[2] = {0, 0};
+  std::vector<char> chunk(sizeof(prefix));
+  chunk.reserve(sizeof(prefix) + ListFileHeader::kChunkBytes +
+                ListCodec<T>::kValueSize);
+  auto flush = [&]() {
+    prefix[1] = chunk.size() - sizeof(prefix);
+    std::memcpy(chunk.data(), prefix, sizeof(prefix));
+    sink.Write(chunk.data(), chunk.size());
+    chunk.resize(sizeof(prefix));
+    prefix[0] = 0;
+  };
+  auto encode = [&](const T& value) {
+    ListCodec<T>::Encode(value, chunk);
+    ++prefix[0];
+    if (chunk.size() - sizeof(prefix) >= ListFileHeader::kChunkBytes) {
+      flush();
+    }
+  };
+  visit(encode);
+  if (prefix[0] != 0) {
+    flush();
+  }
+  flush();
+}
+
+// Читает сохранённый список по одному куску, не держа в памяти больше
+// одного куска. BiDirectionalList::Load построен на нём же.
+template<typename T>
+class BiDirectionalListReader {
+ public:
+  explicit BiDirectionalListReader(std::istream& stream);
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  explicit BiDirectionalListReader(int fd);
+#endif
+
+  // Число элементов во всём списке, из заголовка.
+  size_t Size() const;
+
+  // Передаёт элементы следующего куска в consume(T&&). Возвращает false,
+  // когда куски закончились.
+  template<typename Consume>
+  bool ReadChunk(Consume consume);
+  // Заменяет содержимое chunk элементами следующего куска.
+  bool ReadChunk(std::vector<T>& chunk);
+
+ private:
+  ListByteSource source_;
+  uint64_t size_;
+  uint64_t read_;
+  bool finished_;
+  std::vector<char> buffer_;
+
+  void ReadHeader();
+};
+
+template<typename T>
+BiDirectionalListReader<T>::BiDirectionalListReader(std::istream& stream)
+    : source_(stream), size_(0), read_(0), finished_(false) {
+  ReadHeader();
+}
+#ifdef BIDIRECTIONAL_LIST_POSIX
+template<typename T>
+BiDirectionalListReader<T>::BiDirectionalListReader(int fd)
+    : source_(fd), size_(0), read_(0), finished_(false) {
+  ReadHeader();
+}
+#endif
+
+template<typename T>
+size_t BiDirectionalListReader<T>::Size() const {
+  return size_;
+}
+
+template<typename T>
+template<typename Consume>
+bool BiDirectionalListReader<T>::ReadChunk(Consume consume) {
+  if (finished_) {
+    return false;
+  }
+  uint64_t prefix[2];
+  source_.Read(prefix, sizeof(prefix));
+  uint64_t count = prefix[0];
+  uint64_t bytes = prefix[1];
+  if (count == 0) {
+    if (bytes != 0 || read_ != size_) {
+      throw std::runtime_error("Impossible to read corrupted list");
+    }
+    finished_ = true;
+    return false;
+  }
+  // Размеры проверяются до выделения буфера: заголовок куска приходит из
+  // файла, и доверять ему нельзя.
+  constexpr size_t kValueSize = ListCodec<T>::kValueSize;
+  constexpr size_t kMaxBytes = ListFileHeader::kChunkBytes +
+                               ListCodec<T>::kMaxValueBytes;
+  bool corrupted = count > size_ - read_ || bytes > kMaxBytes;
+  if constexpr (kValueSize != 0) {
+    constexpr size_t kMaxCount =
+        (ListFileHeader::kChunkBytes + kValueSize - 1) / kValueSize;
+    corrupted = corrupted || count > kMaxCount || bytes != count * kValueSize;
+  } else {
+    // Элемент переменной длины начинается с 8-байтной длины.
+    corrupted = corrupted || count > bytes / sizeof(uint64_t);
+  }
+  if (corrupted) {
+    throw std::runtime_error("Impossible to read corrupted list");
+  }
+  buffer_.resize(bytes);
+  source_.Read(buffer_.data(), bytes);
+  const char* position = buffer_.data();
+  const char* end = position + bytes;
+  for (uint64_t i = 0; i < count; ++i) {
+    consume(ListCodec<T>::Decode(position, end));
+  }
+  if (position != end) {
+    throw std::runtime_error("Impossible to read corrupted list");
+  }
+  read_ += count;
+  return true;
+}
+template<typename T>
+bool BiDirectionalListReader<T>::ReadChunk(std::vector<T>& chunk) {
+  chunk.clear();
+  return ReadChunk([&chunk](T&& value) { chunk.push_back(std::move(value)); });
+}
+
+template<typename T>
+void BiDirectionalListReader<T>::ReadHeader() {
+  ListFileHeader header;
+  source_.Read(&header, sizeof(header));
+  if (header.magic_ != ListFileHeader::kMagic ||
+      header.version_ != ListFileHeader::kVersion ||
+      header.value_size_ != ListCodec<T>::kValueSize) {
+    throw std::runtime_error("Impossible to read list of another format");
+  }
+  size_ = header.size_;
+}
+
+// Политики итераторов BiDirectionalList. Проверяемые итераторы бросают
+// исключение при выходе за границы списка. Непроверяемые не содержат ветвлений
+// в operator++ и тривиально копируются, поэтому циклы по ним компилятор
+// разворачивает; выход за границы для них -- неопределённое поведение.
+struct CheckedIterators {
+  static constexpr bool kChecked = true;
+};
+struct UncheckedIterators {
+  static constexpr bool kChecked = false;
+};
+
+// Политики выполнения параллельных алгоритмов BiDirectionalList. Список
+// делится на отрезки по grain_ элементов; при ParallelPolicy отрезки
+// разбирают threads_ потоков (0 -- по числу ядер).
+struct SequencedPolicy {
+  size_t grain_ = 1024;
+};
+struct ParallelPolicy {
+  size_t threads_ = 0;
+  size_t grain_ = 1024;
+};
+
+// Выполняет run(segment) для отрезков 0..count-1: по порядку при
+// SequencedPolicy или в threads_ потоках при ParallelPolicy. false из run
+// прекращает раздачу оставшихся отрезков; первое исключение пробрасывается
+// после завершения всех потоков.
+template<typename Policy, typename Run>
+void RunListSegments(const Policy& policy, size_t count, Run& run) {
+  if constexpr (std::is_same_v<Policy, SequencedPolicy>) {
+    for (size_t segment = 0; segment < count && run(segment); segment++) {}
+  } else {
+    size_t threads = policy.threads_ != 0 ?
+        policy.threads_ : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, count);
+    std::atomic<size_t> next_segment(0);
+    std::atomic<bool> stop(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        size_t segment = next_segment.fetch_add(1, std::memory_order_relaxed);
+        if (segment >= count) {
+          return;
+        }
+        try {
+          if (!run(segment)) {
+            stop = true;
+          }
+        } catch (...) {
+          std::lock_guard lock(error_mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+          stop = true;
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    try {
+      for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(worker);
+      }
+    } catch (...) {
+      // Если поток не создался, работу доделают уже запущенные.
+    }
+    worker();
+    for (std::thread& thread : workers) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+#ifdef BIDIRECTIONAL_LIST_STATS
+// Статистика горячих путей BiDirectionalList. Собирается только при сборке
+// с BIDIRECTIONAL_LIST_STATS, без него счётчиков и методов доступа к ним
+// нет. find_links_ -- узлы, просмотренные Find и FindLast, iterator_links_
+// -- шаги итераторов, longest_scan_ -- самый длинный просмотр одного Find,
+// bounds_exceptions_ -- исключения из проверок границ в итераторах.
+struct BiDirectionalListStats {
+  uint64_t allocations_ = 0;
+  uint64_t frees_ = 0;
+  uint64_t find_links_ = 0;
+  uint64_t iterator_links_ = 0;
+  uint64_t longest_scan_ = 0;
+  uint64_t bounds_exceptions_ = 0;
+  uint64_t peak_size_ = 0;
+};
+
+// Счётчик статистики. Константные обходы списка можно вести из нескольких
+// потоков, поэтому значение атомарное, но обновляется отдельными relaxed
+// чтением и записью без блокирующей инструкции: при одновременных обходах
+// часть приращений теряется, зато шаг итератора почти ничего не стоит.
+class StatsCounter {
+ public:
+  uint64_t Get() const { return value_.load(std::memory_order_relaxed); }
+  void Set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(uint64_t count) { Set(Get() + count); }
+  void Maximize(uint64_t value) {
+    if (value > Get()) {
+      Set(value);
+    }
+  }
+
+ private:
+  std::atomic<uint64_t> value_ = 0;
+};
+#endif
+
+template<typename T, typename Allocator = std::allocator<T>,
+    typename IteratorPolicy = CheckedIterators>
+class BiDirectionalList {
+ protected:
+  struct Node;
+
+ public:
+  class Iterator : public std::iterator<std::bidirectional_iterator_tag, T> {
+   public:
+    T& operator*() const;
+    T* operator->() const;
+
+    Iterator& operator++();
+    const Iterator operator++(int);
+
+    Iterator& operator--();
+    const Iterator operator--(int);
+
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+
+   private:
+    friend class BiDirectionalList;
+
+    const BiDirectionalList* list_;
+    Node* node_;
+
+    Iterator(const BiDirectionalList* list, Node* node) : list_(list),
+                                                          node_(node) {}
+  };
+
+  class ConstIterator :
+      public std::iterator<std::bidirectional_iterator_tag, T> {
+   public:
+    const T& operator*() const;
+    const T* operator->() const;
+
+    ConstIterator& operator++();
+    const ConstIterator operator++(int);
+
+    ConstIterator& operator--();
+    const ConstIterator operator--(int);
+
+    bool operator==(const ConstIterator& other) const;
+    bool operator!=(const ConstIterator& other) const;
+
+   private:
+    friend class BiDirectionalList;
+
+    const BiDirectionalList* list_;
+    const Node* node_;
+
+    ConstIterator(const BiDirectionalList* list, Node* node)
+        : list_(list), node_(node) {}
+  };
+
+  BiDirectionalList() : BiDirectionalList(Allocator()) {}
+  explicit BiDirectionalList(const Allocator& allocator)
+      : node_allocator_(allocator), first_(nullptr), last_(nullptr),
+        size_(0) {}
+
+  // Итераторы перемещённого списка продолжают ссылаться на старый объект
+  // списка, поэтому после перемещения их нужно получить заново.
+  BiDirectionalList(const BiDirectionalList& other);
+  BiDirectionalList(BiDirectionalList&& other) noexcept;
+
+  BiDirectionalList& operator=(const BiDirectionalList& other);
+  BiDirectionalList& operator=(BiDirectionalList&& other);
+
+  ~BiDirectionalList() { Clear(); }
+
+  Allocator GetAllocator() const;
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  void Clear();
+
+  Iterator begin();
+  Iterator end();
+
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  std::vector<T> AsArray() const &;
+  std::vector<T> AsArray() &&;
+
+  template<typename OutputIt>
+    requires std::output_iterator<OutputIt, const T&>
+  OutputIt CopyTo(OutputIt destination) const;
+  size_t CopyTo(std::span<T> destination) const;
+
+  void InsertBefore(Iterator position, const T& value);
+  void InsertBefore(Iterator position, T&& value);
+
+  void InsertAfter(Iterator position, const T& value);
+  void InsertAfter(Iterator position, T&& value);
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+
+  void PushFront(const T& value);
+  void PushFront(T&& value);
+
+  template<typename... Args>
+  Iterator EmplaceBefore(Iterator position, Args&&... args);
+  template<typename... Args>
+  Iterator EmplaceAfter(Iterator position, Args&&... args);
+
+  template<typename... Args>
+  Iterator EmplaceBack(Args&&... args);
+  template<typename... Args>
+  Iterator EmplaceFront(Args&&... args);
+
+  void Erase(Iterator position);
+
+  void PopFront();
+  void PopBack();
+
+  // Splice, Merge и SplitAt перевешивают существующие узлы, не копируя
+  // элементов. Итераторы на перенесённые элементы остаются
+  // разыменовываемыми, но сравнивать и уменьшать их нужно уже через
+  // итераторы нового списка.
+  void Splice(Iterator position, BiDirectionalList& other);
+  void Splice(Iterator position, BiDirectionalList& other, Iterator element);
+  void Splice(Iterator position, BiDirectionalList& other, Iterator first,
+              Iterator last);
+
+  void Merge(BiDirectionalList& other);
+  template<typename Compare>
+  void Merge(BiDirectionalList& other, Compare compare);
+
+  BiDirectionalList SplitAt(Iterator position);
+
+  // Сортировка восходящим слиянием по цепочке узлов: устойчива, требует
+  // O(1) дополнительной памяти и не инвалидирует итераторы.
+  void Sort();
+  template<typename Compare>
+  void Sort(Compare compare);
+
+  size_t Unique();
+  template<typename BinaryPredicate>
+  size_t Unique(BinaryPredicate predicate);
+
+  void Reverse();
+
+  Iterator Find(const T& value);
+  ConstIterator Find(const T& value) const;
+
+  Iterator Find(std::function<bool(const T&)> predicate);
+  ConstIterator Find(std::function<bool(const T&)> predicate) const;
+
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  Iterator Find(Predicate predicate);
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  ConstIterator Find(Predicate predicate) const;
+
+  template<typename Predicate>
+  Iterator FindLast(Predicate predicate);
+  template<typename Predicate>
+  ConstIterator FindLast(Predicate predicate) const;
+
+  template<typename Predicate>
+  std::vector<Iterator> FindAll(Predicate predicate);
+  template<typename Predicate>
+  std::vector<ConstIterator> FindAll(Predicate predicate) const;
+
+  template<typename Predicate>
+  size_t CountIf(Predicate predicate) const;
+
+  template<typename Predicate>
+  size_t RemoveIf(Predicate predicate);
+
+  // Reduce сворачивает каждый отрезок слева направо, а затем частичные
+  // результаты по порядку отрезков. Поэтому операция должна быть только
+  // ассоциативной, а результат зависит от grain_, но не от числа потоков.
+  // FindAny возвращает любой подходящий элемент. Исключение из функции
+  // останавливает остальные отрезки и пробрасывается вызывающему.
+  template<typename Policy, typename Function>
+  void ForEach(const Policy& policy, Function function);
+  template<typename Policy, typename Function>
+  std::vector<std::invoke_result_t<Function&, const T&>> Transform(
+      const Policy& policy, Function function) const;
+  template<typename Policy, typename U, typename BinaryOperation>
+  U Reduce(const Policy& policy, U init, BinaryOperation operation) const;
+  template<typename Policy, typename Predicate>
+  Iterator FindAny(const Policy& policy, Predicate predicate);
+  template<typename Policy, typename Predicate>
+  ConstIterator FindAny(const Policy& policy, Predicate predicate) const;
+
+  // Сохраняет список в формате ListFileHeader; у тривиально копируемых T
+  // каждый кусок уходит одной записью. Load заменяет содержимое списка
+  // загруженным и при ошибке оставляет список прежним.
+  void Save(std::ostream& stream) const;
+  void Load(std::istream& stream);
+  void Load(BiDirectionalListReader<T>& reader);
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  void Save(int fd) const;
+  void Load(int fd);
+#endif
+
+#ifdef BIDIRECTIONAL_LIST_STATS
+  using StatsDumpHook = std::function<void(const BiDirectionalListStats&)>;
+
+  BiDirectionalListStats Stats() const;
+  // Сбрасывает счётчики; пиковой длиной становится текущая.
+  void ResetStats();
+  // hook получает снимок после каждых period выделений и освобождений узлов
+  // (пустой hook или нулевой period отключают вызовы). Он вызывается посреди
+  // изменения списка, поэтому не должен ни бросать исключения, ни
+  // обращаться к самому списку, кроме Stats().
+  void SetStatsDumpHook(StatsDumpHook hook, uint64_t period);
+#endif
+
+ protected:
+  struct Node {
+    explicit Node(const T& value);
+    explicit Node(T&& value);
+    template<typename... Args>
+    explicit Node(std::in_place_t, Args&&... args);
+
+    T value_;
+    Node* next_node_;
+    Node* previous_node_;
+  };
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::
+      template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  NodeAllocator node_allocator_;
+  Node* first_;
+  Node* last_;
+  size_t size_;
+
+#ifdef BIDIRECTIONAL_LIST_STATS
+  // Счётчики изменений трогают только неконстантные методы, которые и так
+  // нельзя вызывать конкурентно, поэтому они обычные.
+  struct StatsCounters {
+    uint64_t allocations_ = 0;
+    uint64_t frees_ = 0;
+    uint64_t peak_size_ = 0;
+    StatsCounter find_links_;
+    StatsCounter iterator_links_;
+    StatsCounter longest_scan_;
+    StatsCounter bounds_exceptions_;
+  };
+
+  mutable StatsCounters stats_;
+  StatsDumpHook stats_hook_;
+  uint64_t stats_period_ = 0;
+  uint64_t stats_countdown_ = 0;
+
+  [[gnu::noinline, gnu::cold]] void DumpStats() noexcept;
+#endif
+
+  template<typename... Args>
+  Node* CreateNode(Args&&... args);
+  void DestroyNode(Node* node);
+
+  // Точки учёта статистики; без BIDIRECTIONAL_LIST_STATS они пустые.
+  void CountNodeChanges(size_t allocations, size_t frees);
+  void CountSize();
+  void CountScan(size_t links) const;
+  void CountIteratorLink() const;
+  void CountBoundsException() const;
+
+  void ReserveNodes(size_t count);
+  void AppendCopies(const Node* first);
+
+  // Перед end() можно вставлять, после него -- только в пустой список.
+  void CheckInsertAfter(Iterator position) const;
+  void InsertBefore(Node* existing_node, Node* new_node);
+  void InsertAfter(Node* existing_node, Node* new_node);
+  void Erase(Node* node);
+
+  // Unlink отцепляет узел, не уничтожая его. Диапазоны [first, last]
+  // задаются включительно; размер списка для них поддерживает вызывающий.
+  void Unlink(Node* node);
+  void LinkRangeBefore(Node* position, Node* first, Node* last);
+  void UnlinkRange(Node* first, Node* last);
+
+  void CheckSameAllocator(const BiDirectionalList& other) const;
+
+  void Save(ListByteSink& sink) const;
+
+  // Переход между итераторами и узлами для производных контейнеров.
+  static Node* NodeOf(Iterator position);
+  static Iterator IteratorOf(ConstIterator position);
+  Iterator IteratorOf(Node* node);
+  ConstIterator IteratorOf(Node* node) const;
+
+  static Node* CutChain(Node* head, size_t count);
+  // Сливает left и right в конец цепочки *tail. Все три аргумента
+  // продвигаются по ходу слияния, так что если compare бросит исключение,
+  // через них видны неслитые остатки и конец слитой части.
+  template<typename Compare>
+  static void MergeChains(Node*& left, Node*& right, Node**& tail,
+                          Compare& compare);
+
+  // Вызывает segment_function(index, first, count) для каждого отрезка;
+  // false из неё прекращает раздачу оставшихся отрезков.
+  template<typename Policy, typename SegmentFunction>
+  void RunSegments(const Policy& policy,
+                   SegmentFunction& segment_function) const;
+};
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalList<T, Allocator, IteratorPolicy>::Node::Node(const T& value)
+    : value_(value), next_node_(nullptr), previous_node_(nullptr) {}
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalList<T, Allocator, IteratorPolicy>::Node::Node(T&& value)
+    : value_(std::move(value)), next_node_(nullptr), previous_node_(nullptr) {}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename... Args>
+BiDirectionalList<T, Allocator, IteratorPolicy>::Node::Node(std::in_place_t,
+                                                           Args&&... args)
+    : value_(std::forward<Args>(args)...), next_node_(nullptr),
+      previous_node_(nullptr) {}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+T& BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::
+    operator*() const {
+  return node_->value_;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+T* BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::
+    operator->() const {
+  return &node_->value_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator&
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::operator++() {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == nullptr) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to increase iterator");
+    }
+  }
+  list_->CountIteratorLink();
+  node_ = node_->next_node_;
+  return *this;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+const typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::operator++(int) {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == nullptr) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to increase iterator");
+    }
+  }
+  auto new_node = node_;
+  list_->CountIteratorLink();
+  node_ = node_->next_node_;
+  Iterator new_iterator(list_, new_node);
+  return new_iterator;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator&
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::operator--() {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == list_->first_) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to reduce iterator");
+    }
+  }
+  list_->CountIteratorLink();
+  node_ = node_ == nullptr ? list_->last_ : node_->previous_node_;
+  return *this;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+const typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::operator--(int) {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == list_->first_) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to reduce iterator");
+    }
+  }
+  auto new_node = node_;
+  list_->CountIteratorLink();
+  node_ = node_ == nullptr ? list_->last_ : node_->previous_node_;
+  Iterator new_iterator(list_, new_node);
+  return new_iterator;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+bool BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::operator==(
+    const BiDirectionalList::Iterator& other) const {
+  return other.node_ == node_;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+bool BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator::operator!=(
+    const BiDirectionalList::Iterator& other) const {
+  return other.node_ != node_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+const T& BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::
+    operator*() const {
+  return node_->value_;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+const T* BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::
+    operator->() const {
+  return &node_->value_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator&
+    BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::
+        operator++() {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == nullptr) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to increase iterator");
+    }
+  }
+  list_->CountIteratorLink();
+  node_ = node_->next_node_;
+  return *this;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+const typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::
+        operator++(int) {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == nullptr) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to increase iterator");
+    }
+  }
+  auto new_node = node_;
+  list_->CountIteratorLink();
+  node_ = node_->next_node_;
+  ConstIterator new_iterator(list_, new_node);
+  return new_iterator;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator&
+    BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::
+        operator--() {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == list_->first_) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to reduce iterator");
+    }
+  }
+  list_->CountIteratorLink();
+  node_ = node_ == nullptr ? list_->last_ : node_->previous_node_;
+  return *this;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+const typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::
+        operator--(int) {
+  if constexpr (IteratorPolicy::kChecked) {
+    if (node_ == list_->first_) {
+      list_->CountBoundsException();
+      throw std::runtime_error("Impossible to reduce iterator");
+    }
+  }
+  auto new_node = node_;
+  list_->CountIteratorLink();
+  node_ = node_ == nullptr ? list_->last_ : node_->previous_node_;
+  ConstIterator new_iterator(list_, new_node);
+  return new_iterator;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+bool BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::operator==(
+    const BiDirectionalList::ConstIterator& other) const {
+  return other.node_ == node_;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+bool BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator::operator!=(
+    const BiDirectionalList::ConstIterator& other) const {
+  return other.node_ != node_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalList<T, Allocator, IteratorPolicy>::BiDirectionalList(
+    const BiDirectionalList& other)
+    : node_allocator_(NodeAllocatorTraits::
+          select_on_container_copy_construction(other.node_allocator_)),
+      first_(nullptr), last_(nullptr), size_(0) {
+  try {
+    ReserveNodes(other.size_);
+    AppendCopies(other.first_);
+  } catch (...) {
+    Clear();
+    throw;
+  }
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalList<T, Allocator, IteratorPolicy>::BiDirectionalList(
+    BiDirectionalList&& other) noexcept
+    : node_allocator_(other.node_allocator_), first_(other.first_),
+      last_(other.last_), size_(other.size_) {
+  other.first_ = other.last_ = nullptr;
+  other.size_ = 0;
+  CountSize();
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalList<T, Allocator, IteratorPolicy>&
+    BiDirectionalList<T, Allocator, IteratorPolicy>::operator=(
+        const BiDirectionalList& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if constexpr (NodeAllocatorTraits::
+      propagate_on_container_copy_assignment::value) {
+    if (node_allocator_ != other.node_allocator_) {
+      Clear();
+    }
+    node_allocator_ = other.node_allocator_;
+  }
+  // Уже выделенные узлы переиспользуем, чтобы не перевыделять их заново.
+  Node* node = first_;
+  const Node* other_node = other.first_;
+  for (; node != nullptr && other_node != nullptr;
+       node = node->next_node_, other_node = other_node->next_node_) {
+    node->value_ = other_node->value_;
+  }
+  if (node != nullptr) {
+    Node* new_last = node->previous_node_;
+    while (last_ != new_last) {
+      Erase(last_);
+    }
+  } else {
+    ReserveNodes(other.size_ - size_);
+    AppendCopies(other_node);
+  }
+  return *this;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalList<T, Allocator, IteratorPolicy>&
+    BiDirectionalList<T, Allocator, IteratorPolicy>::operator=(
+        BiDirectionalList&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  Clear();
+  if (NodeAllocatorTraits::propagate_on_container_move_assignment::value ||
+      node_allocator_ == other.node_allocator_) {
+    if constexpr (NodeAllocatorTraits::
+        propagate_on_container_move_assignment::value) {
+      node_allocator_ = other.node_allocator_;
+    }
+    first_ = other.first_;
+    last_ = other.last_;
+    size_ = other.size_;
+    other.first_ = other.last_ = nullptr;
+    other.size_ = 0;
+    CountSize();
+  } else {
+    ReserveNodes(other.size_);
+    for (Node* node = other.first_; node != nullptr;
+         node = node->next_node_) {
+      PushBack(std::move(node->value_));
+    }
+    other.Clear();
+  }
+  return *this;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+Allocator BiDirectionalList<T, Allocator, IteratorPolicy>::
+    GetAllocator() const {
+  return Allocator(node_allocator_);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+bool BiDirectionalList<T, Allocator, IteratorPolicy>::IsEmpty() const {
+  return last_ == first_ && last_ == nullptr;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+size_t BiDirectionalList<T, Allocator, IteratorPolicy>::Size() const {
+  return size_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Clear() {
+  bool released = false;
+  if constexpr (std::is_trivially_destructible_v<Node> &&
+      HasTryReleaseAll<NodeAllocator>::value) {
+    released = node_allocator_.TryReleaseAll();
+  }
+  if (released) {
+    CountNodeChanges(0, size_);
+  } else {
+    Node* node = first_;
+    while (node != nullptr) {
+      Node* next = node->next_node_;
+      DestroyNode(node);
+      node = next;
+    }
+  }
+  first_ = last_ = nullptr;
+  size_ = 0;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::begin() {
+  return BiDirectionalList::Iterator(this, first_);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::end() {
+  return BiDirectionalList::Iterator(this, nullptr);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::begin() const {
+  return BiDirectionalList::ConstIterator(this, first_);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::end() const {
+  return BiDirectionalList::ConstIterator(this, nullptr);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+std::vector<T> BiDirectionalList<T, Allocator, IteratorPolicy>::
+    AsArray() const & {
+  std::vector<T> new_vector;
+  new_vector.reserve(size_);
+  CopyTo(std::back_inserter(new_vector));
+  return new_vector;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+std::vector<T> BiDirectionalList<T, Allocator, IteratorPolicy>::AsArray() && {
+  std::vector<T> new_vector;
+  new_vector.reserve(size_);
+  for (Node* node = first_; node != nullptr; node = node->next_node_) {
+    new_vector.push_back(std::move(node->value_));
+  }
+  Clear();
+  return new_vector;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename OutputIt>
+  requires std::output_iterator<OutputIt, const T&>
+OutputIt BiDirectionalList<T, Allocator, IteratorPolicy>::CopyTo(
+    OutputIt destination) const {
+  for (const Node* node = first_; node != nullptr; node = node->next_node_) {
+    *destination = node->value_;
+    ++destination;
+  }
+  return destination;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+size_t BiDirectionalList<T, Allocator, IteratorPolicy>::CopyTo(
+    std::span<T> destination) const {
+  if (destination.size() < size_) {
+    throw std::runtime_error("Impossible to copy list into smaller buffer");
+  }
+  CopyTo(destination.begin());
+  return size_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::InsertBefore(
+    BiDirectionalList::Iterator position, const T& value) {
+  Node* new_node = CreateNode(value);
+  InsertBefore(position.node_, new_node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::InsertBefore(
+    BiDirectionalList::Iterator position, T&& value) {
+  Node* new_node = CreateNode(std::move(value));
+  InsertBefore(position.node_, new_node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::InsertAfter(
+    BiDirectionalList::Iterator position, const T& value) {
+  CheckInsertAfter(position);
+  Node* new_node = CreateNode(value);
+  InsertAfter(position.node_, new_node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::InsertAfter(
+    BiDirectionalList::Iterator position, T&& value) {
+  CheckInsertAfter(position);
+  Node* new_node = CreateNode(std::move(value));
+  InsertAfter(position.node_, new_node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::PushBack(const T& value) {
+  Node* new_node = CreateNode(value);
+  InsertAfter(last_, new_node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::PushBack(T&& value) {
+  Node* new_node = CreateNode(std::move(value));
+  InsertAfter(last_, new_node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::PushFront(
+    const T& value) {
+  Node* new_node = CreateNode(value);
+  InsertBefore(first_, new_node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::PushFront(T&& value) {
+  Node* new_node = CreateNode(std::move(value));
+  InsertBefore(first_, new_node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename... Args>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::EmplaceBefore(
+        BiDirectionalList::Iterator position, Args&&... args) {
+  Node* new_node = CreateNode(std::in_place, std::forward<Args>(args)...);
+  InsertBefore(position.node_, new_node);
+  return Iterator(this, new_node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename... Args>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::EmplaceAfter(
+        BiDirectionalList::Iterator position, Args&&... args) {
+  CheckInsertAfter(position);
+  Node* new_node = CreateNode(std::in_place, std::forward<Args>(args)...);
+  InsertAfter(position.node_, new_node);
+  return Iterator(this, new_node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename... Args>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::EmplaceBack(
+        Args&&... args) {
+  Node* new_node = CreateNode(std::in_place, std::forward<Args>(args)...);
+  InsertAfter(last_, new_node);
+  return Iterator(this, new_node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename... Args>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::EmplaceFront(
+        Args&&... args) {
+  Node* new_node = CreateNode(std::in_place, std::forward<Args>(args)...);
+  InsertBefore(first_, new_node);
+  return Iterator(this, new_node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Erase(
+    BiDirectionalList::Iterator position) {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  if (position == end()) {
+    throw std::runtime_error("Impossible to delete end");
+  }
+  Erase(position.node_);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::PopFront() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase(begin().node_);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::PopBack() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase((--end()).node_);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Splice(
+    BiDirectionalList::Iterator position, BiDirectionalList& other) {
+  if (this == &other || other.IsEmpty()) {
+    return;
+  }
+  CheckSameAllocator(other);
+  Node* first = other.first_;
+  Node* last = other.last_;
+  size_t count = other.size_;
+  other.first_ = other.last_ = nullptr;
+  other.size_ = 0;
+  LinkRangeBefore(position.node_, first, last);
+  size_ += count;
+  CountSize();
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Splice(
+    BiDirectionalList::Iterator position, BiDirectionalList& other,
+    BiDirectionalList::Iterator element) {
+  if (element.node_ == nullptr) {
+    throw std::runtime_error("Impossible to splice end");
+  }
+  Node* node = element.node_;
+  if (this != &other) {
+    CheckSameAllocator(other);
+  } else if (node == position.node_ || node->next_node_ == position.node_) {
+    return;
+  }
+  other.Unlink(node);
+  LinkRangeBefore(position.node_, node, node);
+  ++size_;
+  CountSize();
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Splice(
+    BiDirectionalList::Iterator position, BiDirectionalList& other,
+    BiDirectionalList::Iterator first, BiDirectionalList::Iterator last) {
+  if (first == last) {
+    return;
+  }
+  Node* first_node = first.node_;
+  Node* last_node = last.node_ == nullptr ? other.last_
+                                          : last.node_->previous_node_;
+  if (this != &other) {
+    CheckSameAllocator(other);
+    size_t count = 1;
+    for (Node* node = first_node; node != last_node;
+         node = node->next_node_) {
+      ++count;
+    }
+    other.size_ -= count;
+    size_ += count;
+    CountSize();
+  } else if (position == last) {
+    return;
+  }
+  other.UnlinkRange(first_node, last_node);
+  LinkRangeBefore(position.node_, first_node, last_node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Merge(
+    BiDirectionalList& other) {
+  Merge(other, std::less<T>());
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Compare>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Merge(
+    BiDirectionalList& other, Compare compare) {
+  if (this == &other || other.IsEmpty()) {
+    return;
+  }
+  CheckSameAllocator(other);
+  // Размеры правятся вместе с каждым переносом: если compare бросит
+  // исключение, оба списка останутся целыми и с верными размерами.
+  Node* node = first_;
+  while (other.first_ != nullptr) {
+    if (node == nullptr) {
+      Node* first = other.first_;
+      Node* last = other.last_;
+      other.first_ = other.last_ = nullptr;
+      LinkRangeBefore(nullptr, first, last);
+      size_ += other.size_;
+      other.size_ = 0;
+      break;
+    }
+    if (compare(std::as_const(other.first_->value_),
+                std::as_const(node->value_))) {
+      Node* moved = other.first_;
+      other.UnlinkRange(moved, moved);
+      LinkRangeBefore(node, moved, moved);
+      ++size_;
+      --other.size_;
+      CountSize();
+    } else {
+      node = node->next_node_;
+    }
+  }
+  CountSize();
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalList<T, Allocator, IteratorPolicy>
+    BiDirectionalList<T, Allocator, IteratorPolicy>::SplitAt(
+        BiDirectionalList::Iterator position) {
+  BiDirectionalList tail(GetAllocator());
+  if (position.node_ == nullptr) {
+    return tail;
+  }
+  size_t count = 0;
+  for (Node* node = position.node_; node != nullptr;
+       node = node->next_node_) {
+    ++count;
+  }
+  Node* last = last_;
+  UnlinkRange(position.node_, last);
+  size_ -= count;
+  tail.LinkRangeBefore(nullptr, position.node_, last);
+  tail.size_ = count;
+  tail.CountSize();
+  return tail;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Sort() {
+  Sort(std::less<T>());
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Compare>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Sort(Compare compare) {
+  if (size_ < 2) {
+    return;
+  }
+  // На время сортировки цепочка односвязная; previous_node_ восстанавливаем
+  // одним проходом в конце.
+  auto relink = [this](Node* head) {
+    Node* previous = nullptr;
+    for (Node* node = head; node != nullptr; node = node->next_node_) {
+      node->previous_node_ = previous;
+      previous = node;
+    }
+    first_ = head;
+    last_ = previous;
+  };
+  Node* merged = first_;
+  Node** tail = nullptr;
+  Node* left = nullptr;
+  Node* right = nullptr;
+  Node* rest = nullptr;
+  try {
+    for (size_t width = 1; width < size_; width *= 2) {
+      rest = merged;
+      merged = nullptr;
+      tail = &merged;
+      while (rest != nullptr) {
+        left = rest;
+        right = CutChain(left, width);
+        rest = CutChain(right, width);
+        MergeChains(left, right, tail, compare);
+      }
+    }
+  } catch (...) {
+    // Сравнение бросило исключение: сшиваем слитую часть с остатками в одну
+    // цепочку, и список остаётся целым, хотя и не упорядоченным.
+    for (Node* chain : {left, right, rest}) {
+      *tail = chain;
+      while (*tail != nullptr) {
+        tail = &(*tail)->next_node_;
+      }
+    }
+    relink(merged);
+    throw;
+  }
+  relink(merged);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+size_t BiDirectionalList<T, Allocator, IteratorPolicy>::Unique() {
+  return Unique(std::equal_to<T>());
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename BinaryPredicate>
+size_t BiDirectionalList<T, Allocator, IteratorPolicy>::Unique(
+    BinaryPredicate predicate) {
+  size_t removed = 0;
+  if (first_ == nullptr) {
+    return removed;
+  }
+  Node* node = first_;
+  while (node->next_node_ != nullptr) {
+    Node* next = node->next_node_;
+    if (predicate(std::as_const(node->value_), std::as_const(next->value_))) {
+      Erase(next);
+      ++removed;
+    } else {
+      node = next;
+    }
+  }
+  return removed;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Reverse() {
+  for (Node* node = first_; node != nullptr; node = node->previous_node_) {
+    std::swap(node->next_node_, node->previous_node_);
+  }
+  std::swap(first_, last_);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Node*
+    BiDirectionalList<T, Allocator, IteratorPolicy>::CutChain(
+        BiDirectionalList::Node* head, size_t count) {
+  for (size_t i = 1; head != nullptr && i < count; i++) {
+    head = head->next_node_;
+  }
+  if (head == nullptr) {
+    return nullptr;
+  }
+  Node* rest = head->next_node_;
+  head->next_node_ = nullptr;
+  return rest;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Compare>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::MergeChains(
+    BiDirectionalList::Node*& left, BiDirectionalList::Node*& right,
+    BiDirectionalList::Node**& tail, Compare& compare) {
+  while (left != nullptr && right != nullptr) {
+    if (compare(std::as_const(right->value_), std::as_const(left->value_))) {
+      *tail = right;
+      right = right->next_node_;
+    } else {
+      *tail = left;
+      left = left->next_node_;
+    }
+    tail = &(*tail)->next_node_;
+  }
+  *tail = left != nullptr ? left : right;
+  left = right = nullptr;
+  while (*tail != nullptr) {
+    tail = &(*tail)->next_node_;
+  }
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Policy, typename SegmentFunction>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::RunSegments(
+    const Policy& policy, SegmentFunction& segment_function) const {
+  size_t grain = std::max<size_t>(policy.grain_, 1);
+  std::vector<Node*> starts;
+  starts.reserve((size_ + grain - 1) / grain);
+  size_t index = 0;
+  for (Node* node = first_; node != nullptr;
+       node = node->next_node_, ++index) {
+    if (index % grain == 0) {
+      starts.push_back(node);
+    }
+  }
+  auto run = [&](size_t segment) {
+    return segment_function(segment, starts[segment],
+                            std::min(grain, size_ - segment * grain));
+  };
+  RunListSegments(policy, starts.size(), run);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Find(const T& value) {
+  return Find([&value](const T& element) { return element == value; });
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Find(
+        const T& value) const {
+  return Find([&value](const T& element) { return element == value; });
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Find(
+        std::function<bool(const T&)> predicate) {
+  return Find<std::function<bool(const T&)>&>(predicate);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Find(
+        std::function<bool(const T&)> predicate) const {
+  return Find<std::function<bool(const T&)>&>(predicate);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Find(Predicate predicate) {
+  size_t links = 0;
+  for (Node* node = first_; node != nullptr; node = node->next_node_) {
+    ++links;
+    if (predicate(std::as_const(node->value_))) {
+      CountScan(links);
+      return Iterator(this, node);
+    }
+  }
+  CountScan(links);
+  return end();
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Find(
+        Predicate predicate) const {
+  size_t links = 0;
+  for (Node* node = first_; node != nullptr; node = node->next_node_) {
+    ++links;
+    if (predicate(std::as_const(node->value_))) {
+      CountScan(links);
+      return ConstIterator(this, node);
+    }
+  }
+  CountScan(links);
+  return end();
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::FindLast(
+        Predicate predicate) {
+  size_t links = 0;
+  for (Node* node = last_; node != nullptr; node = node->previous_node_) {
+    ++links;
+    if (predicate(std::as_const(node->value_))) {
+      CountScan(links);
+      return Iterator(this, node);
+    }
+  }
+  CountScan(links);
+  return end();
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::FindLast(
+        Predicate predicate) const {
+  size_t links = 0;
+  for (Node* node = last_; node != nullptr; node = node->previous_node_) {
+    ++links;
+    if (predicate(std::as_const(node->value_))) {
+      CountScan(links);
+      return ConstIterator(this, node);
+    }
+  }
+  CountScan(links);
+  return end();
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+std::vector<typename BiDirectionalList<T, Allocator,
+                                      IteratorPolicy>::Iterator>
+    BiDirectionalList<T, Allocator, IteratorPolicy>::FindAll(
+        Predicate predicate) {
+  std::vector<Iterator> found;
+  for (Node* node = first_; node != nullptr; node = node->next_node_) {
+    if (predicate(std::as_const(node->value_))) {
+      found.push_back(Iterator(this, node));
+    }
+  }
+  return found;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+std::vector<typename BiDirectionalList<T, Allocator,
+                                      IteratorPolicy>::ConstIterator>
+    BiDirectionalList<T, Allocator, IteratorPolicy>::FindAll(
+        Predicate predicate) const {
+  std::vector<ConstIterator> found;
+  for (Node* node = first_; node != nullptr; node = node->next_node_) {
+    if (predicate(std::as_const(node->value_))) {
+      found.push_back(ConstIterator(this, node));
+    }
+  }
+  return found;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+size_t BiDirectionalList<T, Allocator, IteratorPolicy>::CountIf(
+    Predicate predicate) const {
+  size_t count = 0;
+  for (Node* node = first_; node != nullptr; node = node->next_node_) {
+    if (predicate(std::as_const(node->value_))) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Predicate>
+size_t BiDirectionalList<T, Allocator, IteratorPolicy>::RemoveIf(
+    Predicate predicate) {
+  size_t removed = 0;
+  Node* node = first_;
+  while (node != nullptr) {
+    Node* next = node->next_node_;
+    if (predicate(std::as_const(node->value_))) {
+      Erase(node);
+      ++removed;
+    }
+    node = next;
+  }
+  return removed;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Policy, typename Function>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::ForEach(
+    const Policy& policy, Function function) {
+  auto segment_function = [&function](size_t, Node* node, size_t count) {
+    for (; count > 0; --count, node = node->next_node_) {
+      function(node->value_);
+    }
+    return true;
+  };
+  RunSegments(policy, segment_function);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Policy, typename Function>
+std::vector<std::invoke_result_t<Function&, const T&>>
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Transform(
+        const Policy& policy, Function function) const {
+  using Result = std::invoke_result_t<Function&, const T&>;
+  std::vector<std::vector<Result>> segments(
+      (size_ + std::max<size_t>(policy.grain_, 1) - 1) /
+      std::max<size_t>(policy.grain_, 1));
+  auto segment_function = [&](size_t index, Node* node, size_t count) {
+    std::vector<Result>& segment = segments[index];
+    segment.reserve(count);
+    for (; count > 0; --count, node = node->next_node_) {
+      segment.push_back(function(std::as_const(node->value_)));
+    }
+    return true;
+  };
+  RunSegments(policy, segment_function);
+  std::vector<Result> result;
+  result.reserve(size_);
+  for (std::vector<Result>& segment : segments) {
+    std::move(segment.begin(), segment.end(), std::back_inserter(result));
+  }
+  return result;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Policy, typename U, typename BinaryOperation>
+U BiDirectionalList<T, Allocator, IteratorPolicy>::Reduce(
+    const Policy& policy, U init, BinaryOperation operation) const {
+  std::vector<std::optional<U>> partials(
+      (size_ + std::max<size_t>(policy.grain_, 1) - 1) /
+      std::max<size_t>(policy.grain_, 1));
+  auto segment_function = [&](size_t index, Node* node, size_t count) {
+    U partial(node->value_);
+    for (node = node->next_node_, --count; count > 0;
+         --count, node = node->next_node_) {
+      partial = operation(std::move(partial), U(node->value_));
+    }
+    partials[index].emplace(std::move(partial));
+    return true;
+  };
+  RunSegments(policy, segment_function);
+  for (std::optional<U>& partial : partials) {
+    init = operation(std::move(init), std::move(*partial));
+  }
+  return init;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Policy, typename Predicate>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::FindAny(
+        const Policy& policy, Predicate predicate) {
+  ConstIterator found = std::as_const(*this).FindAny(policy,
+                                                     std::move(predicate));
+  return Iterator(this, const_cast<Node*>(found.node_));
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename Policy, typename Predicate>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::FindAny(
+        const Policy& policy, Predicate predicate) const {
+  std::atomic<Node*> found(nullptr);
+  auto segment_function = [&](size_t, Node* node, size_t count) {
+    for (; count > 0; --count, node = node->next_node_) {
+      if (predicate(std::as_const(node->value_))) {
+        found.store(node, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    return found.load(std::memory_order_relaxed) == nullptr;
+  };
+  RunSegments(policy, segment_function);
+  return ConstIterator(this, found.load());
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Save(
+    std::ostream& stream) const {
+  ListByteSink sink(stream);
+  Save(sink);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Load(
+    std::istream& stream) {
+  BiDirectionalListReader<T> reader(stream);
+  Load(reader);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Load(
+    BiDirectionalListReader<T>& reader) {
+  BiDirectionalList loaded(GetAllocator());
+  // Размер из заголовка не проверен, поэтому узлы резервируются не сразу на
+  // весь список, а с удвоением по мере прихода прочитанных элементов.
+  size_t reserved = 0;
+  while (reader.ReadChunk([&loaded, &reader, &reserved](T&& value) {
+    if (loaded.size_ == reserved) {
+      reserved = std::min(reader.Size(), std::max<size_t>(2 * reserved,
+                                                          1024));
+      loaded.ReserveNodes(reserved - loaded.size_);
+    }
+    loaded.InsertAfter(loaded.last_, loaded.CreateNode(std::move(value)));
+  })) {}
+  *this = std::move(loaded);
+}
+#ifdef BIDIRECTIONAL_LIST_POSIX
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Save(int fd) const {
+  ListByteSink sink(fd);
+  Save(sink);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Load(int fd) {
+  BiDirectionalListReader<T> reader(fd);
+  Load(reader);
+}
+#endif
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Save(
+    ListByteSink& sink) const {
+  SaveList<T>(sink, size_, [this](auto& encode) {
+    for (const Node* node = first_; node != nullptr;
+         node = node->next_node_) {
+      encode(node->value_);
+    }
+  });
+}
+
+#ifdef BIDIRECTIONAL_LIST_STATS
+template<typename T, typename Allocator, typename IteratorPolicy>
+BiDirectionalListStats
+    BiDirectionalList<T, Allocator, IteratorPolicy>::Stats() const {
+  BiDirectionalListStats stats;
+  stats.allocations_ = stats_.allocations_;
+  stats.frees_ = stats_.frees_;
+  stats.find_links_ = stats_.find_links_.Get();
+  stats.iterator_links_ = stats_.iterator_links_.Get();
+  stats.longest_scan_ = stats_.longest_scan_.Get();
+  stats.bounds_exceptions_ = stats_.bounds_exceptions_.Get();
+  stats.peak_size_ = stats_.peak_size_;
+  return stats;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::ResetStats() {
+  stats_.allocations_ = 0;
+  stats_.frees_ = 0;
+  stats_.find_links_.Set(0);
+  stats_.iterator_links_.Set(0);
+  stats_.longest_scan_.Set(0);
+  stats_.bounds_exceptions_.Set(0);
+  stats_.peak_size_ = size_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::SetStatsDumpHook(
+    StatsDumpHook hook, uint64_t period) {
+  stats_hook_ = std::move(hook);
+  stats_period_ = stats_hook_ ? period : 0;
+  stats_countdown_ = stats_period_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::DumpStats() noexcept {
+  stats_countdown_ = stats_period_;
+  stats_hook_(Stats());
+}
+#endif
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::CheckInsertAfter(
+    BiDirectionalList::Iterator position) const {
+  if (position.node_ == nullptr && !IsEmpty()) {
+    throw std::runtime_error("Impossible to insert after end");
+  }
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::InsertBefore(
+    BiDirectionalList::Node* existing_node, BiDirectionalList::Node* new_node) {
+  // Вставка перед end() -- это вставка в конец.
+  if (existing_node == nullptr && first_ != nullptr) {
+    InsertAfter(last_, new_node);
+    return;
+  }
+  if (first_ == nullptr) {
+    first_ = last_ = new_node;
+  } else if (existing_node == first_) {
+    new_node->next_node_ = existing_node;
+    existing_node->previous_node_ = new_node;
+    first_ = new_node;
+  } else {
+    Node* existing_previous_node = existing_node->previous_node_;
+    existing_node->previous_node_ = new_node;
+    new_node->previous_node_ = existing_previous_node;
+    existing_previous_node->next_node_ = new_node;
+    new_node->next_node_ = existing_node;
+  }
+  ++size_;
+  CountSize();
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::InsertAfter(
+    BiDirectionalList::Node* existing_node, BiDirectionalList::Node* new_node) {
+  if (IsEmpty()) {
+    first_ = last_ = new_node;
+  } else if (existing_node == last_) {
+    existing_node->next_node_ = new_node;
+    new_node->previous_node_ = existing_node;
+    last_ = new_node;
+  } else {
+    Node* existing_next_node = existing_node->next_node_;
+    existing_node->next_node_ = new_node;
+    new_node->next_node_ = existing_next_node;
+    existing_next_node->previous_node_ = new_node;
+    new_node->previous_node_ = existing_node;
+  }
+  ++size_;
+  CountSize();
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Erase(
+    BiDirectionalList::Node* node) {
+  Unlink(node);
+  DestroyNode(node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::Unlink(
+    BiDirectionalList::Node* node) {
+  UnlinkRange(node, node);
+  --size_;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::LinkRangeBefore(
+    BiDirectionalList::Node* position, BiDirectionalList::Node* first,
+    BiDirectionalList::Node* last) {
+  Node* previous = position == nullptr ? last_ : position->previous_node_;
+  first->previous_node_ = previous;
+  last->next_node_ = position;
+  if (previous == nullptr) {
+    first_ = first;
+  } else {
+    previous->next_node_ = first;
+  }
+  if (position == nullptr) {
+    last_ = last;
+  } else {
+    position->previous_node_ = last;
+  }
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::UnlinkRange(
+    BiDirectionalList::Node* first, BiDirectionalList::Node* last) {
+  if (first->previous_node_ == nullptr) {
+    first_ = last->next_node_;
+  } else {
+    first->previous_node_->next_node_ = last->next_node_;
+  }
+  if (last->next_node_ == nullptr) {
+    last_ = first->previous_node_;
+  } else {
+    last->next_node_->previous_node_ = first->previous_node_;
+  }
+  first->previous_node_ = nullptr;
+  last->next_node_ = nullptr;
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::CheckSameAllocator(
+    const BiDirectionalList& other) const {
+  if (node_allocator_ != other.node_allocator_) {
+    throw std::runtime_error(
+        "Impossible to move nodes between lists with different allocators");
+  }
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Node*
+    BiDirectionalList<T, Allocator, IteratorPolicy>::NodeOf(
+        BiDirectionalList::Iterator position) {
+  return position.node_;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::IteratorOf(
+        BiDirectionalList::ConstIterator position) {
+  return Iterator(position.list_, const_cast<Node*>(position.node_));
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Iterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::IteratorOf(
+        BiDirectionalList::Node* node) {
+  return Iterator(this, node);
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::ConstIterator
+    BiDirectionalList<T, Allocator, IteratorPolicy>::IteratorOf(
+        BiDirectionalList::Node* node) const {
+  return ConstIterator(this, node);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+template<typename... Args>
+typename BiDirectionalList<T, Allocator, IteratorPolicy>::Node*
+    BiDirectionalList<T, Allocator, IteratorPolicy>::CreateNode(
+        Args&&... args) {
+  Node* node = NodeAllocatorTraits::allocate(node_allocator_, 1);
+  try {
+    NodeAllocatorTraits::construct(node_allocator_, node,
+                                   std::forward<Args>(args)...);
+  } catch (...) {
+    NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+    throw;
+  }
+  CountNodeChanges(1, 0);
+  return node;
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::DestroyNode(
+    BiDirectionalList::Node* node) {
+  NodeAllocatorTraits::destroy(node_allocator_, node);
+  NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+  CountNodeChanges(0, 1);
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::CountNodeChanges(
+    [[maybe_unused]] size_t allocations, [[maybe_unused]] size_t frees) {
+#ifdef BIDIRECTIONAL_LIST_STATS
+  stats_.allocations_ += allocations;
+  stats_.frees_ += frees;
+  if (allocations + frees < stats_countdown_) {
+    stats_countdown_ -= allocations + frees;
+  } else if (stats_period_ != 0) [[unlikely]] {
+    DumpStats();
+  }
+#endif
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::CountSize() {
+#ifdef BIDIRECTIONAL_LIST_STATS
+  stats_.peak_size_ = std::max<uint64_t>(stats_.peak_size_, size_);
+#endif
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::CountScan(
+    [[maybe_unused]] size_t links) const {
+#ifdef BIDIRECTIONAL_LIST_STATS
+  stats_.find_links_.Add(links);
+  stats_.longest_scan_.Maximize(links);
+#endif
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::
+    CountIteratorLink() const {
+#ifdef BIDIRECTIONAL_LIST_STATS
+  stats_.iterator_links_.Add(1);
+#endif
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::
+    CountBoundsException() const {
+#ifdef BIDIRECTIONAL_LIST_STATS
+  stats_.bounds_exceptions_.Add(1);
+#endif
+}
+
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::ReserveNodes(
+    size_t count) {
+  if constexpr (HasReserve<NodeAllocator>::value) {
+    node_allocator_.Reserve(count);
+  }
+}
+template<typename T, typename Allocator, typename IteratorPolicy>
+void BiDirectionalList<T, Allocator, IteratorPolicy>::AppendCopies(
+    const BiDirectionalList::Node* first) {
+  for (const Node* node = first; node != nullptr; node = node->next_node_) {
+    Node* new_node = CreateNode(node->value_);
+    new_node->previous_node_ = last_;
+    if (last_ == nullptr) {
+      first_ = new_node;
+    } else {
+      last_->next_node_ = new_node;
+    }
+    last_ = new_node;
+    ++size_;
+  }
+  CountSize();
+}
+
+// Векторные просмотры непрерывных массивов арифметических значений: куски
+// развёрнутого списка и снимки AsArray(). Для int и double на x86 работают
+// ядра AVX2 (8 int или 4 double за инструкцию) с выбором во время выполнения
+// и запасным SSE2; для остальных типов и платформ -- обычные циклы. Sum для
+// чисел с плавающей точкой складывает в другом порядке и может отличаться
+// от последовательной суммы в младших разрядах. Целые суммируются в
+// int64_t, беззнаковые 64-битные -- в uint64_t, long double -- в long
+// double, остальные числа с плавающей точкой -- в double. Результат Min и
+// Max при наличии NaN не определён.
+class SimdScan {
+ public:
+  template<typename T>
+  using SumType = std::conditional_t<
+      std::is_floating_point_v<T>,
+      std::conditional_t<std::is_same_v<T, long double>, long double, double>,
+      std::conditional_t<std::is_unsigned_v<T> &&
+                             sizeof(T) >= sizeof(uint64_t),
+                         uint64_t, int64_t>>;
+
+  // Индекс первого равного value элемента или values.size().
+  template<typename T>
+    requires std::is_arithmetic_v<T>
+  static size_t Find(std::span<const T> values, T value);
+  template<typename T>
+    requires std::is_arithmetic_v<T>
+  static size_t Count(std::span<const T> values, T value);
+
+  template<typename T>
+    requires std::is_arithmetic_v<T>
+  static T Min(std::span<const T> values);
+  template<typename T>
+    requires std::is_arithmetic_v<T>
+  static T Max(std::span<const T> values);
+
+  template<typename T>
+    requires std::is_arithmetic_v<T>
+  static SumType<T> Sum(std::span<const T> values);
+
+ private:
+#ifdef BIDIRECTIONAL_LIST_X86_SIMD
+  static bool HasAvx2();
+
+  static size_t FindSse2(const int* values, size_t size, int value);
+  static size_t FindAvx2(const int* values, size_t size, int value);
+  static size_t FindSse2(const double* values, size_t size, double value);
+  static size_t FindAvx2(const double* values, size_t size, double value);
+
+  static size_t CountSse2(const int* values, size_t size, int value);
+  static size_t CountAvx2(const int* values, size_t size, int value);
+  static size_t CountSse2(const double* values, size_t size, double value);
+  static size_t CountAvx2(const double* values, size_t size, double value);
+
+  template<bool kMin>
+  static int SelectSse2(const int* values, size_t size);
+  template<bool kMin>
+  static int SelectAvx2(const int* values, size_t size);
+  template<bool kMin>
+  static double SelectSse2(const double* values, size_t size);
+  template<bool kMin>
+  static double SelectAvx2(const double* values, size_t size);
+
+  static int64_t SumSse2(const int* values, size_t size);
+  static int64_t SumAvx2(const int* values, size_t size);
+  static double SumSse2(const double* values, size_t size);
+  static double SumAvx2(const double* values, size_t size);
+#endif
+
+  template<typename T>
+  static constexpr bool kVectorized =
+      std::is_same_v<T, int> || std::is_same_v<T, double>;
+
+  template<bool kMin, typename T>
+  static T Select(std::span<const T> values);
+};
+
+template<typename T>
+  requires std::is_arithmetic_v<T>
+size_t SimdScan::Find(std::span<const T> values, T value) {
+#ifdef BIDIRECTIONAL_LIST_X86_SIMD
+  if constexpr (kVectorized<T>) {
+    return HasAvx2() ? FindAvx2(values.data(), values.size(), value)
+                     : FindSse2(values.data(), values.size(), value);
+  }
+#endif
+  return std::find(values.begin(), values.end(), value) - values.begin();
+}
+
+template<typename T>
+  requires std::is_arithmetic_v<T>
+size_t SimdScan::Count(std::span<const T> values, T value) {
+#ifdef BIDIRECTIONAL_LIST_X86_SIMD
+  if constexpr (kVectorized<T>) {
+    return HasAvx2() ? CountAvx2(values.data(), values.size(), value)
+                     : CountSse2(values.data(), values.size(), value);
+  }
+#endif
+  return std::count(values.begin(), values.end(), value);
+}
+
+template<typename T>
+  requires std::is_arithmetic_v<T>
+T SimdScan::Min(std::span<const T> values) {
+  if (values.empty()) {
+    throw std::runtime_error("Impossible to find minimum of empty range");
+  }
+  return Select<true>(values);
+}
+template<typename T>
+  requires std::is_arithmetic_v<T>
+T SimdScan::Max(std::span<const T> values) {
+  if (values.empty()) {
+    throw std::runtime_error("Impossible to find maximum of empty range");
+  }
+  return Select<false>(values);
+}
+
+template<typename T>
+  requires std::is_arithmetic_v<T>
+SimdScan::SumType<T> SimdScan::Sum(std::span<const T> values) {
+#ifdef BIDIRECTIONAL_LIST_X86_SIMD
+  if constexpr (kVectorized<T>) {
+    return HasAvx2() ? SumAvx2(values.data(), values.size())
+                     : SumSse2(values.data(), values.size());
+  }
+#endif
+  SumType<T> sum = 0;
+  for (T value : values) {
+    sum += value;
+  }
+  return sum;
+}
+
+template<bool kMin, typename T>
+T SimdScan::Select(std::span<const T> values) {
+#ifdef BIDIRECTIONAL_LIST_X86_SIMD
+  if constexpr (kVectorized<T>) {
+    return HasAvx2() ? SelectAvx2<kMin>(values.data(), values.size())
+                     : SelectSse2<kMin>(values.data(), values.size());
+  }
+#endif
+  if constexpr (kMin) {
+    return *std::min_element(values.begin(), values.end());
+  } else {
+    return *std::max_element(values.begin(), values.end());
+  }
+}
+
+#ifdef BIDIRECTIONAL_LIST_X86_SIMD
+inline bool SimdScan::HasAvx2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+inline size_t SimdScan::FindSse2(const int* values, size_t size, int value) {
+  __m128i needle = _mm_set1_epi32(value);
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(values + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi32(block, needle));
+    if (mask != 0) {
+      return i + std::countr_zero(mask) / sizeof(int);
+    }
+  }
+  for (; i < size && values[i] != value; i++) {}
+  return i;
+}
+__attribute__((target("avx2")))
+inline size_t SimdScan::FindAvx2(const int* values, size_t size, int value) {
+  __m256i needle = _mm256_set1_epi32(value);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256i block = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(values + i));
+    unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(block, needle));
+    if (mask != 0) {
+      return i + std::countr_zero(mask) / sizeof(int);
+    }
+  }
+  for (; i < size && values[i] != value; i++) {}
+  return i;
+}
+inline size_t SimdScan::FindSse2(const double* values, size_t size,
+                                 double value) {
+  __m128d needle = _mm_set1_pd(value);
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    unsigned mask = _mm_movemask_pd(
+        _mm_cmpeq_pd(_mm_loadu_pd(values + i), needle));
+    if (mask != 0) {
+      return i + std::countr_zero(mask);
+    }
+  }
+  for (; i < size && values[i] != value; i++) {}
+  return i;
+}
+__attribute__((target("avx2")))
+inline size_t SimdScan::FindAvx2(const double* values, size_t size,
+                                 double value) {
+  __m256d needle = _mm256_set1_pd(value);
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    unsigned mask = _mm256_movemask_pd(
+        _mm256_cmp_pd(_mm256_loadu_pd(values + i), needle, _CMP_EQ_OQ));
+    if (mask != 0) {
+      return i + std::countr_zero(mask);
+    }
+  }
+  for (; i < size && values[i] != value; i++) {}
+  return i;
+}
+
+inline size_t SimdScan::CountSse2(const int* values, size_t size, int value) {
+  __m128i needle = _mm_set1_epi32(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(values + i));
+    count += std::popcount(static_cast<unsigned>(
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, needle)))));
+  }
+  for (; i < size; i++) {
+    count += values[i] == value;
+  }
+  return count;
+}
+__attribute__((target("avx2")))
+inline size_t SimdScan::CountAvx2(const int* values, size_t size, int value) {
+  __m256i needle = _mm256_set1_epi32(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256i block = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(values + i));
+    count += std::popcount(static_cast<unsigned>(_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpeq_epi32(block, needle)))));
+  }
+  for (; i < size; i++) {
+    count += values[i] == value;
+  }
+  return count;
+}
+inline size_t SimdScan::CountSse2(const double* values, size_t size,
+                                  double value) {
+  __m128d needle = _mm_set1_pd(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    count += std::popcount(static_cast<unsigned>(_mm_movemask_pd(
+        _mm_cmpeq_pd(_mm_loadu_pd(values + i), needle))));
+  }
+  for (; i < size; i++) {
+    count += values[i] == value;
+  }
+  return count;
+}
+__attribute__((target("avx2")))
+inline size_t SimdScan::CountAvx2(const double* values, size_t size,
+                                  double value) {
+  __m256d needle = _mm256_set1_pd(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    count += std::popcount(static_cast<unsigned>(_mm256_movemask_pd(
+        _mm256_cmp_pd(_mm256_loadu_pd(values + i), needle, _CMP_EQ_OQ))));
+  }
+  for (; i < size; i++) {
+    count += values[i] == value;
+  }
+  return count;
+}
+
+template<bool kMin>
+int SimdScan::SelectSse2(const int* values, size_t size) {
+  int best = values[0];
+  size_t i = 0;
+  if (size >= 4) {
+    // В SSE2 нет pminsd/pmaxsd, поэтому выбираем по маске сравнения.
+    __m128i accumulator = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(values));
+    for (i = 4; i + 4 <= size; i += 4) {
+      __m128i block = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(values + i));
+      __m128i take = kMin ? _mm_cmplt_epi32(block, accumulator)
+                          : _mm_cmpgt_epi32(block, accumulator);
+      accumulator = _mm_or_si128(_mm_and_si128(take, block),
+                                 _mm_andnot_si128(take, accumulator));
+    }
+    alignas(16) int lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), accumulator);
+    best = kMin ? *std::min_element(lanes, lanes + 4)
+                : *std::max_element(lanes, lanes + 4);
+  }
+  for (; i < size; i++) {
+    best = kMin ? std::min(best, values[i]) : std::max(best, values[i]);
+  }
+  return best;
+}
+template<bool kMin>
+__attribute__((target("avx2")))
+int SimdScan::SelectAvx2(const int* values, size_t size) {
+  int best = values[0];
+  size_t i = 0;
+  if (size >= 8) {
+    __m256i accumulator = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(values));
+    for (i = 8; i + 8 <= size; i += 8) {
+      __m256i block = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + i));
+      accumulator = kMin ? _mm256_min_epi32(accumulator, block)
+                         : _mm256_max_epi32(accumulator, block);
+    }
+    alignas(32) int lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), accumulator);
+    best = kMin ? *std::min_element(lanes, lanes + 8)
+                : *std::max_element(lanes, lanes + 8);
+  }
+  for (; i < size; i++) {
+    best = kMin ? std::min(best, values[i]) : std::max(best, values[i]);
+  }
+  return best;
+}
+template<bool kMin>
+double SimdScan::SelectSse2(const double* values, size_t size) {
+  double best = values[0];
+  size_t i = 0;
+  if (size >= 2) {
+    __m128d accumulator = _mm_loadu_pd(values);
+    for (i = 2; i + 2 <= size; i += 2) {
+      __m128d block = _mm_loadu_pd(values + i);
+      accumulator = kMin ? _mm_min_pd(accumulator, block)
+                         : _mm_max_pd(accumulator, block);
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, accumulator);
+    best = kMin ? std::min(lanes[0], lanes[1]) : std::max(lanes[0], lanes[1]);
+  }
+  for (; i < size; i++) {
+    best = kMin ? std::min(best, values[i]) : std::max(best, values[i]);
+  }
+  return best;
+}
+template<bool kMin>
+__attribute__((target("avx2")))
+double SimdScan::SelectAvx2(const double* values, size_t size) {
+  double best = values[0];
+  size_t i = 0;
+  if (size >= 4) {
+    __m256d accumulator = _mm256_loadu_pd(values);
+    for (i = 4; i + 4 <= size; i += 4) {
+      __m256d block = _mm256_loadu_pd(values + i);
+      accumulator = kMin ? _mm256_min_pd(accumulator, block)
+                         : _mm256_max_pd(accumulator, block);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, accumulator);
+    best = kMin ? *std::min_element(lanes, lanes + 4)
+                : *std::max_element(lanes, lanes + 4);
+  }
+  for (; i < size; i++) {
+    best = kMin ? std::min(best, values[i]) : std::max(best, values[i]);
+  }
+  return best;
+}
+
+inline int64_t SimdScan::SumSse2(const int* values, size_t size) {
+  __m128i accumulator = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    // Расширяем до 64 бит знаковым битом, иначе сумма быстро переполнится.
+    __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(values + i));
+    __m128i sign = _mm_srai_epi32(block, 31);
+    accumulator = _mm_add_epi64(accumulator, _mm_unpacklo_epi32(block, sign));
+    accumulator = _mm_add_epi64(accumulator, _mm_unpackhi_epi32(block, sign));
+  }
+  alignas(16) int64_t lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes), accumulator);
+  int64_t sum = lanes[0] + lanes[1];
+  for (; i < size; i++) {
+    sum += values[i];
+  }
+  return sum;
+}
+__attribute__((target("avx2")))
+inline int64_t SimdScan::SumAvx2(const int* values, size_t size) {
+  __m256i accumulator = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m128i low = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(values + i));
+    __m128i high = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(values + i + 4));
+    accumulator = _mm256_add_epi64(accumulator, _mm256_cvtepi32_epi64(low));
+    accumulator = _mm256_add_epi64(accumulator, _mm256_cvtepi32_epi64(high));
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), accumulator);
+  int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < size; i++) {
+    sum += values[i];
+  }
+  return sum;
+}
+inline double SimdScan::SumSse2(const double* values, size_t size) {
+  __m128d accumulator = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    accumulator = _mm_add_pd(accumulator, _mm_loadu_pd(values + i));
+  }
+  alignas(16) double lanes[2];
+  _mm_store_pd(lanes, accumulator);
+  double sum = lanes[0] + lanes[1];
+  for (; i < size; i++) {
+    sum += values[i];
+  }
+  return sum;
+}
+__attribute__((target("avx2")))
+inline double SimdScan::SumAvx2(const double* values, size_t size) {
+  __m256d accumulator = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    accumulator = _mm256_add_pd(accumulator, _mm256_loadu_pd(values + i));
+  }
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, accumulator);
+  double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < size; i++) {
+    sum += values[i];
+  }
+  return sum;
+}
+#endif // BIDIRECTIONAL_LIST_X86_SIMD
+
+// Развёрнутый (unrolled) вариант списка: каждый узел хранит небольшой массив
+// элементов, поэтому обход и поиск идут по непрерывной памяти. Вставка и
+// удаление сдвигают элементы внутри узла, поэтому инвалидируют итераторы на
+// элементы этого узла (и соседнего, если узлы разделяются или сливаются).
+template<typename T>
+constexpr size_t DefaultChunkCapacity() {
+  return std::max<size_t>(4, 256 / sizeof(T));
+}
+
+template<typename T, size_t Capacity = DefaultChunkCapacity<T>(),
+    typename Allocator = std::allocator<T>>
+class UnrolledBiDirectionalList {
+  static_assert(Capacity >= 2, "Chunk capacity must be at least 2");
+
+ protected:
+  struct Chunk;
+
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    T& operator*() const;
+    T* operator->() const;
+
+    Iterator& operator++();
+    const Iterator operator++(int);
+
+    Iterator& operator--();
+    const Iterator operator--(int);
+
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+
+   private:
+    friend class UnrolledBiDirectionalList;
+
+    const UnrolledBiDirectionalList* list_;
+    Chunk* chunk_;
+    size_t index_;
+
+    Iterator(const UnrolledBiDirectionalList* list, Chunk* chunk,
+             size_t index) : list_(list), chunk_(chunk), index_(index) {}
+  };
+
+  class ConstIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const T& operator*() const;
+    const T* operator->() const;
+
+    ConstIterator& operator++();
+    const ConstIterator operator++(int);
+
+    ConstIterator& operator--();
+    const ConstIterator operator--(int);
+
+    bool operator==(const ConstIterator& other) const;
+    bool operator!=(const ConstIterator& other) const;
+
+   private:
+    friend class UnrolledBiDirectionalList;
+
+    const UnrolledBiDirectionalList* list_;
+    const Chunk* chunk_;
+    size_t index_;
+
+    ConstIterator(const UnrolledBiDirectionalList* list, const Chunk* chunk,
+                  size_t index) : list_(list), chunk_(chunk), index_(index) {}
+  };
+
+  UnrolledBiDirectionalList() : UnrolledBiDirectionalList(Allocator()) {}
+  explicit UnrolledBiDirectionalList(const Allocator& allocator)
+      : chunk_allocator_(allocator), first_(nullptr), last_(nullptr),
+        size_(0) {}
+
+  UnrolledBiDirectionalList(const UnrolledBiDirectionalList&) = delete;
+  UnrolledBiDirectionalList& operator=(const UnrolledBiDirectionalList&) =
+      delete;
+
+  ~UnrolledBiDirectionalList() { Clear(); }
+
+  Allocator GetAllocator() const;
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  void Clear();
+
+  Iterator begin();
+  Iterator end();
+
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  std::vector<T> AsArray() const;
+
+  Iterator InsertBefore(Iterator position, const T& value);
+  Iterator InsertBefore(Iterator position, T&& value);
+
+  Iterator InsertAfter(Iterator position, const T& value);
+  Iterator InsertAfter(Iterator position, T&& value);
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+
+  void PushFront(const T& value);
+  void PushFront(T&& value);
+
+  Iterator Erase(Iterator position);
+
+  void PopFront();
+  void PopBack();
+
+  // Для арифметических T поиск по значению и агрегаты ниже просматривают
+  // куски векторными инструкциями (см. SimdScan).
+  Iterator Find(const T& value);
+  ConstIterator Find(const T& value) const;
+
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  Iterator Find(Predicate predicate);
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  ConstIterator Find(Predicate predicate) const;
+
+  size_t Count(const T& value) const;
+
+  T Min() const requires std::is_arithmetic_v<T>;
+  T Max() const requires std::is_arithmetic_v<T>;
+  SimdScan::SumType<T> Sum() const requires std::is_arithmetic_v<T>;
+
+ protected:
+  struct Chunk {
+    Chunk() {}
+
+    T* Values() { return std::launder(reinterpret_cast<T*>(storage_)); }
+    const T* Values() const {
+      return std::launder(reinterpret_cast<const T*>(storage_));
+    }
+
+    Chunk* next_chunk_ = nullptr;
+    Chunk* previous_chunk_ = nullptr;
+    size_t count_ = 0;
+    alignas(T) unsigned char storage_[Capacity * sizeof(T)];
+  };
+
+  using ChunkAllocator = typename std::allocator_traits<Allocator>::
+      template rebind_alloc<Chunk>;
+  using ChunkAllocatorTraits = std::allocator_traits<ChunkAllocator>;
+
+  ChunkAllocator chunk_allocator_;
+  Chunk* first_;
+  Chunk* last_;
+  size_t size_;
+
+  Chunk* CreateChunkAfter(Chunk* existing_chunk);
+  void DestroyChunk(Chunk* chunk);
+
+  template<typename Value>
+  Iterator InsertAt(Chunk* chunk, size_t index, Value&& value);
+  Iterator EraseAt(Chunk* chunk, size_t index);
+};
+
+template<typename T, size_t Capacity, typename Allocator>
+T& UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::
+    operator*() const {
+  return chunk_->Values()[index_];
+}
+template<typename T, size_t Capacity, typename Allocator>
+T* UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::
+    operator->() const {
+  return chunk_->Values() + index_;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator&
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::operator++() {
+  if (chunk_ == nullptr) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  if (++index_ == chunk_->count_) {
+    chunk_ = chunk_->next_chunk_;
+    index_ = 0;
+  }
+  return *this;
+}
+template<typename T, size_t Capacity, typename Allocator>
+const typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::
+        operator++(int) {
+  Iterator old_iterator = *this;
+  ++*this;
+  return old_iterator;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator&
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::operator--() {
+  if (chunk_ == list_->first_ && index_ == 0) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  } else if (chunk_ == nullptr) {
+    chunk_ = list_->last_;
+    index_ = chunk_->count_ - 1;
+  } else if (index_ == 0) {
+    chunk_ = chunk_->previous_chunk_;
+    index_ = chunk_->count_ - 1;
+  } else {
+    --index_;
+  }
+  return *this;
+}
+template<typename T, size_t Capacity, typename Allocator>
+const typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::
+        operator--(int) {
+  Iterator old_iterator = *this;
+  --*this;
+  return old_iterator;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+bool UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::operator==
+  (const UnrolledBiDirectionalList::Iterator& other) const {
+  return other.chunk_ == chunk_ && other.index_ == index_;
+}
+template<typename T, size_t Capacity, typename Allocator>
+bool UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator::operator!=
+  (const UnrolledBiDirectionalList::Iterator& other) const {
+  return !(other == *this);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+const T& UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator::
+    operator*() const {
+  return chunk_->Values()[index_];
+}
+template<typename T, size_t Capacity, typename Allocator>
+const T* UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator::
+    operator->() const {
+  return chunk_->Values() + index_;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator&
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator::
+        operator++() {
+  if (chunk_ == nullptr) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  if (++index_ == chunk_->count_) {
+    chunk_ = chunk_->next_chunk_;
+    index_ = 0;
+  }
+  return *this;
+}
+template<typename T, size_t Capacity, typename Allocator>
+const typename UnrolledBiDirectionalList<T, Capacity, Allocator>::
+    ConstIterator UnrolledBiDirectionalList<T, Capacity, Allocator>::
+        ConstIterator::operator++(int) {
+  ConstIterator old_iterator = *this;
+  ++*this;
+  return old_iterator;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator&
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator::
+        operator--() {
+  if (chunk_ == list_->first_ && index_ == 0) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  } else if (chunk_ == nullptr) {
+    chunk_ = list_->last_;
+    index_ = chunk_->count_ - 1;
+  } else if (index_ == 0) {
+    chunk_ = chunk_->previous_chunk_;
+    index_ = chunk_->count_ - 1;
+  } else {
+    --index_;
+  }
+  return *this;
+}
+template<typename T, size_t Capacity, typename Allocator>
+const typename UnrolledBiDirectionalList<T, Capacity, Allocator>::
+    ConstIterator UnrolledBiDirectionalList<T, Capacity, Allocator>::
+        ConstIterator::operator--(int) {
+  ConstIterator old_iterator = *this;
+  --*this;
+  return old_iterator;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+bool UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator::
+    operator==(const UnrolledBiDirectionalList::ConstIterator& other) const {
+  return other.chunk_ == chunk_ && other.index_ == index_;
+}
+template<typename T, size_t Capacity, typename Allocator>
+bool UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator::
+    operator!=(const UnrolledBiDirectionalList::ConstIterator& other) const {
+  return !(other == *this);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+Allocator UnrolledBiDirectionalList<T, Capacity, Allocator>::
+    GetAllocator() const {
+  return Allocator(chunk_allocator_);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+bool UnrolledBiDirectionalList<T, Capacity, Allocator>::IsEmpty() const {
+  return size_ == 0;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+size_t UnrolledBiDirectionalList<T, Capacity, Allocator>::Size() const {
+  return size_;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::Clear() {
+  Chunk* chunk = first_;
+  while (chunk != nullptr) {
+    Chunk* next = chunk->next_chunk_;
+    DestroyChunk(chunk);
+    chunk = next;
+  }
+  first_ = last_ = nullptr;
+  size_ = 0;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::begin() {
+  return Iterator(this, first_, 0);
+}
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::end() {
+  return Iterator(this, nullptr, 0);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::begin() const {
+  return ConstIterator(this, first_, 0);
+}
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::end() const {
+  return ConstIterator(this, nullptr, 0);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+std::vector<T> UnrolledBiDirectionalList<T, Capacity, Allocator>::
+    AsArray() const {
+  std::vector<T> new_vector;
+  new_vector.reserve(size_);
+  for (const Chunk* chunk = first_; chunk != nullptr;
+       chunk = chunk->next_chunk_) {
+    new_vector.insert(new_vector.end(), chunk->Values(),
+                      chunk->Values() + chunk->count_);
+  }
+  return new_vector;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::InsertBefore(
+        UnrolledBiDirectionalList::Iterator position, const T& value) {
+  if (position.chunk_ == nullptr) {
+    return InsertAt(last_, last_ == nullptr ? 0 : last_->count_, value);
+  }
+  return InsertAt(position.chunk_, position.index_, value);
+}
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::InsertBefore(
+        UnrolledBiDirectionalList::Iterator position, T&& value) {
+  if (position.chunk_ == nullptr) {
+    return InsertAt(last_, last_ == nullptr ? 0 : last_->count_,
+                    std::move(value));
+  }
+  return InsertAt(position.chunk_, position.index_, std::move(value));
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::InsertAfter(
+        UnrolledBiDirectionalList::Iterator position, const T& value) {
+  if (position.chunk_ == nullptr) {
+    if (!IsEmpty()) {
+      throw std::runtime_error("Impossible to insert after end");
+    }
+    return InsertAt(nullptr, 0, value);
+  }
+  return InsertAt(position.chunk_, position.index_ + 1, value);
+}
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::InsertAfter(
+        UnrolledBiDirectionalList::Iterator position, T&& value) {
+  if (position.chunk_ == nullptr) {
+    if (!IsEmpty()) {
+      throw std::runtime_error("Impossible to insert after end");
+    }
+    return InsertAt(nullptr, 0, std::move(value));
+  }
+  return InsertAt(position.chunk_, position.index_ + 1, std::move(value));
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::PushBack(
+    const T& value) {
+  InsertAt(last_, last_ == nullptr ? 0 : last_->count_, value);
+}
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::PushBack(T&& value) {
+  InsertAt(last_, last_ == nullptr ? 0 : last_->count_, std::move(value));
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::PushFront(
+    const T& value) {
+  InsertAt(first_, 0, value);
+}
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::PushFront(T&& value) {
+  InsertAt(first_, 0, std::move(value));
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Erase(
+        UnrolledBiDirectionalList::Iterator position) {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  if (position == end()) {
+    throw std::runtime_error("Impossible to delete end");
+  }
+  return EraseAt(position.chunk_, position.index_);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::PopFront() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  EraseAt(first_, 0);
+}
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::PopBack() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  EraseAt(last_, last_->count_ - 1);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Find(const T& value) {
+  ConstIterator found = std::as_const(*this).Find(value);
+  return Iterator(this, const_cast<Chunk*>(found.chunk_), found.index_);
+}
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Find(
+        const T& value) const {
+  if constexpr (std::is_arithmetic_v<T>) {
+    for (const Chunk* chunk = first_; chunk != nullptr;
+         chunk = chunk->next_chunk_) {
+      size_t index = SimdScan::Find(
+          std::span<const T>(chunk->Values(), chunk->count_), value);
+      if (index != chunk->count_) {
+        return ConstIterator(this, chunk, index);
+      }
+    }
+    return end();
+  } else {
+    return Find([&value](const T& element) { return element == value; });
+  }
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Find(
+        Predicate predicate) {
+  for (Chunk* chunk = first_; chunk != nullptr; chunk = chunk->next_chunk_) {
+    const T* values = chunk->Values();
+    const T* found = std::find_if(values, values + chunk->count_,
+                                  std::ref(predicate));
+    if (found != values + chunk->count_) {
+      return Iterator(this, chunk, found - values);
+    }
+  }
+  return end();
+}
+template<typename T, size_t Capacity, typename Allocator>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::ConstIterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::Find(
+        Predicate predicate) const {
+  for (const Chunk* chunk = first_; chunk != nullptr;
+       chunk = chunk->next_chunk_) {
+    const T* values = chunk->Values();
+    const T* found = std::find_if(values, values + chunk->count_,
+                                  std::ref(predicate));
+    if (found != values + chunk->count_) {
+      return ConstIterator(this, chunk, found - values);
+    }
+  }
+  return end();
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+size_t UnrolledBiDirectionalList<T, Capacity, Allocator>::Count(
+    const T& value) const {
+  size_t count = 0;
+  for (const Chunk* chunk = first_; chunk != nullptr;
+       chunk = chunk->next_chunk_) {
+    std::span<const T> values(chunk->Values(), chunk->count_);
+    if constexpr (std::is_arithmetic_v<T>) {
+      count += SimdScan::Count(values, value);
+    } else {
+      count += std::count(values.begin(), values.end(), value);
+    }
+  }
+  return count;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+T UnrolledBiDirectionalList<T, Capacity, Allocator>::Min() const
+    requires std::is_arithmetic_v<T> {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to find minimum of empty list");
+  }
+  T result = SimdScan::Min(std::span<const T>(first_->Values(),
+                                              first_->count_));
+  for (const Chunk* chunk = first_->next_chunk_; chunk != nullptr;
+       chunk = chunk->next_chunk_) {
+    result = std::min(result, SimdScan::Min(
+        std::span<const T>(chunk->Values(), chunk->count_)));
+  }
+  return result;
+}
+template<typename T, size_t Capacity, typename Allocator>
+T UnrolledBiDirectionalList<T, Capacity, Allocator>::Max() const
+    requires std::is_arithmetic_v<T> {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to find maximum of empty list");
+  }
+  T result = SimdScan::Max(std::span<const T>(first_->Values(),
+                                              first_->count_));
+  for (const Chunk* chunk = first_->next_chunk_; chunk != nullptr;
+       chunk = chunk->next_chunk_) {
+    result = std::max(result, SimdScan::Max(
+        std::span<const T>(chunk->Values(), chunk->count_)));
+  }
+  return result;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+SimdScan::SumType<T> UnrolledBiDirectionalList<T, Capacity, Allocator>::Sum()
+    const requires std::is_arithmetic_v<T> {
+  SimdScan::SumType<T> sum = 0;
+  for (const Chunk* chunk = first_; chunk != nullptr;
+       chunk = chunk->next_chunk_) {
+    sum += SimdScan::Sum(std::span<const T>(chunk->Values(), chunk->count_));
+  }
+  return sum;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Chunk*
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::CreateChunkAfter(
+        UnrolledBiDirectionalList::Chunk* existing_chunk) {
+  Chunk* chunk = ChunkAllocatorTraits::allocate(chunk_allocator_, 1);
+  ChunkAllocatorTraits::construct(chunk_allocator_, chunk);
+  if (existing_chunk == nullptr) {
+    chunk->next_chunk_ = first_;
+    if (first_ != nullptr) {
+      first_->previous_chunk_ = chunk;
+    } else {
+      last_ = chunk;
+    }
+    first_ = chunk;
+  } else {
+    chunk->previous_chunk_ = existing_chunk;
+    chunk->next_chunk_ = existing_chunk->next_chunk_;
+    if (existing_chunk->next_chunk_ != nullptr) {
+      existing_chunk->next_chunk_->previous_chunk_ = chunk;
+    } else {
+      last_ = chunk;
+    }
+    existing_chunk->next_chunk_ = chunk;
+  }
+  return chunk;
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+void UnrolledBiDirectionalList<T, Capacity, Allocator>::DestroyChunk(
+    UnrolledBiDirectionalList::Chunk* chunk) {
+  std::destroy(chunk->Values(), chunk->Values() + chunk->count_);
+  ChunkAllocatorTraits::destroy(chunk_allocator_, chunk);
+  ChunkAllocatorTraits::deallocate(chunk_allocator_, chunk, 1);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+template<typename Value>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::InsertAt(
+        UnrolledBiDirectionalList::Chunk* chunk, size_t index,
+        Value&& value) {
+  T new_value(std::forward<Value>(value));
+  if (chunk == nullptr) {
+    chunk = CreateChunkAfter(nullptr);
+  } else if (chunk->count_ == Capacity) {
+    // Полный узел делим пополам и вставляем в ту половину, куда попал index.
+    constexpr size_t kHalf = Capacity / 2;
+    Chunk* new_chunk = CreateChunkAfter(chunk);
+    std::uninitialized_move(chunk->Values() + kHalf,
+                            chunk->Values() + Capacity, new_chunk->Values());
+    std::destroy(chunk->Values() + kHalf, chunk->Values() + Capacity);
+    new_chunk->count_ = Capacity - kHalf;
+    chunk->count_ = kHalf;
+    if (index > kHalf) {
+      chunk = new_chunk;
+      index -= kHalf;
+    }
+  }
+  T* values = chunk->Values();
+  if (index == chunk->count_) {
+    ::new (static_cast<void*>(values + index)) T(std::move(new_value));
+  } else {
+    ::new (static_cast<void*>(values + chunk->count_))
+        T(std::move(values[chunk->count_ - 1]));
+    std::move_backward(values + index, values + chunk->count_ - 1,
+                       values + chunk->count_);
+    values[index] = std::move(new_value);
+  }
+  ++chunk->count_;
+  ++size_;
+  return Iterator(this, chunk, index);
+}
+
+template<typename T, size_t Capacity, typename Allocator>
+typename UnrolledBiDirectionalList<T, Capacity, Allocator>::Iterator
+    UnrolledBiDirectionalList<T, Capacity, Allocator>::EraseAt(
+        UnrolledBiDirectionalList::Chunk* chunk, size_t index) {
+  T* values = chunk->Values();
+  std::move(values + index + 1, values + chunk->count_, values + index);
+  std::destroy_at(values + chunk->count_ - 1);
+  --chunk->count_;
+  --size_;
+  Chunk* next = chunk->next_chunk_;
+  if (chunk->count_ == 0) {
+    if (chunk->previous_chunk_ != nullptr) {
+      chunk->previous_chunk_->next_chunk_ = next;
+    } else {
+      first_ = next;
+    }
+    if (next != nullptr) {
+      next->previous_chunk_ = chunk->previous_chunk_;
+    } else {
+      last_ = chunk->previous_chunk_;
+    }
+    DestroyChunk(chunk);
+    return Iterator(this, next, 0);
+  }
+  // Почти пустой узел сливаем со следующим, чтобы узлы не вырождались.
+  if (chunk->count_ < Capacity / 4 && next != nullptr &&
+      chunk->count_ + next->count_ <= Capacity) {
+    std::uninitialized_move(next->Values(), next->Values() + next->count_,
+                            values + chunk->count_);
+    chunk->count_ += next->count_;
+    chunk->next_chunk_ = next->next_chunk_;
+    if (next->next_chunk_ != nullptr) {
+      next->next_chunk_->previous_chunk_ = chunk;
+    } else {
+      last_ = chunk;
+    }
+    DestroyChunk(next);
+    next = chunk->next_chunk_;
+  }
+  if (index == chunk->count_) {
+    return Iterator(this, next, 0);
+  }
+  return Iterator(this, chunk, index);
+}
+
+// Неблокирующий (lock-free) двусторонний список-очередь для нескольких
+// производителей и потребителей, по алгоритму M. Michael "CAS-Based
+// Lock-Free Algorithm for Shared Deques". Концы списка и состояние хранятся в
+// одном 64-битном слове anchor_, поэтому узлы адресуются 31-битными индексами
+// в пуле, а не указателями. Удалённые узлы возвращаются в пул только после
+// проверки hazard pointers, так что поток, читающий ссылки узла, не увидит его
+// повторно использованным.
+template<typename T>
+class ConcurrentDeque {
+ public:
+  ConcurrentDeque() = default;
+
+  ConcurrentDeque(const ConcurrentDeque&) = delete;
+  ConcurrentDeque& operator=(const ConcurrentDeque&) = delete;
+
+  ~ConcurrentDeque();
+
+  bool IsEmpty() const;
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+
+  void PushFront(const T& value);
+  void PushFront(T&& value);
+
+  std::optional<T> PopBack();
+  std::optional<T> PopFront();
+
+ private:
+  static constexpr uint32_t kNull = 0;
+  static constexpr uint32_t kMaxIndex = (1u << 31) - 1;
+  static constexpr size_t kFirstSegmentBits = 10;
+  static constexpr size_t kSegmentCount = 32 - kFirstSegmentBits;
+  static constexpr size_t kHazardsPerRecord = 3;
+  static constexpr size_t kScanThreshold = 64;
+
+  enum Status : uint64_t {
+    kStable = 0,
+    kRightPush = 1,
+    kLeftPush = 2
+  };
+
+  struct Node {
+    T* Value() { return std::launder(reinterpret_cast<T*>(storage_)); }
+
+    std::atomic<uint32_t> left_{kNull};
+    std::atomic<uint32_t> right_{kNull};
+    std::atomic<uint32_t> next_free_{kNull};
+    alignas(T) unsigned char storage_[sizeof(T)];
+  };
+
+  struct Anchor {
+    uint32_t left_;
+    uint32_t right_;
+    Status status_;
+
+    uint64_t Pack() const {
+      return static_cast<uint64_t>(left_) |
+          (static_cast<uint64_t>(right_) << 31) |
+          (static_cast<uint64_t>(status_) << 62);
+    }
+    static Anchor Unpack(uint64_t word) {
+      return {static_cast<uint32_t>(word & kMaxIndex),
+              static_cast<uint32_t>((word >> 31) & kMaxIndex),
+              static_cast<Status>(word >> 62)};
+    }
+  };
+
+  struct HazardRecord {
+    std::atomic<bool> active_{true};
+    std::atomic<uint32_t> hazards_[kHazardsPerRecord] = {};
+    HazardRecord* next_record_ = nullptr;
+    std::vector<uint32_t> retired_;
+  };
+
+  // Держит запись hazard pointers на время одной операции.
+  class HazardGuard {
+   public:
+    explicit HazardGuard(ConcurrentDeque* deque)
+        : deque_(deque), record_(deque->AcquireRecord()) {}
+    HazardGuard(const HazardGuard&) = delete;
+    HazardGuard& operator=(const HazardGuard&) = delete;
+    ~HazardGuard() { deque_->ReleaseRecord(record_); }
+
+    void Protect(size_t slot, uint32_t index) {
+      record_->hazards_[slot].store(index);
+    }
+    HazardRecord* Record() const { return record_; }
+
+   private:
+    ConcurrentDeque* deque_;
+    HazardRecord* record_;
+  };
+
+  std::atomic<uint64_t> anchor_{0};
+  std::atomic<Node*> segments_[kSegmentCount] = {};
+  std::atomic<uint32_t> next_index_{1};
+  std::atomic<uint64_t> free_head_{0};
+  std::atomic<HazardRecord*> records_{nullptr};
+
+  Node& NodeAt(uint32_t index) const;
+  uint32_t AllocateNode();
+  void FreeNode(uint32_t index);
+
+  HazardRecord* AcquireRecord();
+  void ReleaseRecord(HazardRecord* record);
+  void Retire(HazardRecord* record, uint32_t index);
+  void Scan(HazardRecord* record);
+
+  template<typename Value>
+  void PushRight(Value&& value);
+  template<typename Value>
+  void PushLeft(Value&& value);
+  std::optional<T> TakeValue(HazardRecord* record, uint32_t index);
+
+  void Stabilize(HazardGuard& guard, Anchor anchor);
+  void StabilizeRight(HazardGuard& guard, Anchor anchor);
+  void StabilizeLeft(HazardGuard& guard, Anchor anchor);
+};
+
+template<typename T>
+ConcurrentDeque<T>::~ConcurrentDeque() {
+  Anchor anchor = Anchor::Unpack(anchor_.load());
+  if (anchor.status_ != kStable) {
+    HazardGuard guard(this);
+    Stabilize(guard, anchor);
+    anchor = Anchor::Unpack(anchor_.load());
+  }
+  for (uint32_t index = anchor.left_; index != kNull;
+       index = index == anchor.right_ ? kNull
+                                      : NodeAt(index).right_.load()) {
+    std::destroy_at(NodeAt(index).Value());
+  }
+  HazardRecord* record = records_.load();
+  while (record != nullptr) {
+    HazardRecord* next = record->next_record_;
+    delete record;
+    record = next;
+  }
+  for (auto& segment : segments_) {
+    delete[] segment.load();
+  }
+}
+
+template<typename T>
+bool ConcurrentDeque<T>::IsEmpty() const {
+  return Anchor::Unpack(anchor_.load()).right_ == kNull;
+}
+
+template<typename T>
+void ConcurrentDeque<T>::PushBack(const T& value) {
+  PushRight(value);
+}
+template<typename T>
+void ConcurrentDeque<T>::PushBack(T&& value) {
+  PushRight(std::move(value));
+}
+
+template<typename T>
+void ConcurrentDeque<T>::PushFront(const T& value) {
+  PushLeft(value);
+}
+template<typename T>
+void ConcurrentDeque<T>::PushFront(T&& value) {
+  PushLeft(std::move(value));
+}
+
+template<typename T>
+std::optional<T> ConcurrentDeque<T>::PopBack() {
+  HazardGuard guard(this);
+  uint32_t popped;
+  while (true) {
+    uint64_t word = anchor_.load();
+    Anchor anchor = Anchor::Unpack(word);
+    if (anchor.right_ == kNull) {
+      return std::nullopt;
+    }
+    if (anchor.right_ == anchor.left_) {
+      Anchor empty{kNull, kNull, anchor.status_};
+      if (anchor_.compare_exchange_strong(word, empty.Pack())) {
+        popped = anchor.right_;
+        break;
+      }
+    } else if (anchor.status_ == kStable) {
+      guard.Protect(0, anchor.left_);
+      guard.Protect(1, anchor.right_);
+      if (anchor_.load() != word) {
+        continue;
+      }
+      uint32_t previous = NodeAt(anchor.right_).left_.load();
+      Anchor shrunk{anchor.left_, previous, anchor.status_};
+      if (anchor_.compare_exchange_strong(word, shrunk.Pack())) {
+        popped = anchor.right_;
+        break;
+      }
+    } else {
+      Stabilize(guard, anchor);
+    }
+  }
+  return TakeValue(guard.Record(), popped);
+}
+template<typename T>
+std::optional<T> ConcurrentDeque<T>::PopFront() {
+  HazardGuard guard(this);
+  uint32_t popped;
+  while (true) {
+    uint64_t word = anchor_.load();
+    Anchor anchor = Anchor::Unpack(word);
+    if (anchor.left_ == kNull) {
+      return std::nullopt;
+    }
+    if (anchor.right_ == anchor.left_) {
+      Anchor empty{kNull, kNull, anchor.status_};
+      if (anchor_.compare_exchange_strong(word, empty.Pack())) {
+        popped = anchor.left_;
+        break;
+      }
+    } else if (anchor.status_ == kStable) {
+      guard.Protect(0, anchor.left_);
+      guard.Protect(1, anchor.right_);
+      if (anchor_.load() != word) {
+        continue;
+      }
+      uint32_t next = NodeAt(anchor.left_).right_.load();
+      Anchor shrunk{next, anchor.right_, anchor.status_};
+      if (anchor_.compare_exchange_strong(word, shrunk.Pack())) {
+        popped = anchor.left_;
+        break;
+      }
+    } else {
+      Stabilize(guard, anchor);
+    }
+  }
+  return TakeValue(guard.Record(), popped);
+}
+
+template<typename T>
+typename ConcurrentDeque<T>::Node& ConcurrentDeque<T>::NodeAt(
+    uint32_t index) const {
+  uint64_t position = static_cast<uint64_t>(index) - 1 +
+      (uint64_t(1) << kFirstSegmentBits);
+  size_t segment = std::bit_width(position) - 1 - kFirstSegmentBits;
+  uint64_t offset = position - (uint64_t(1) << (segment + kFirstSegmentBits));
+  return segments_[segment].load(std::memory_order_acquire)[offset];
+}
+
+template<typename T>
+uint32_t ConcurrentDeque<T>::AllocateNode() {
+  uint64_t head = free_head_.load();
+  while (static_cast<uint32_t>(head) != kNull) {
+    uint32_t index = static_cast<uint32_t>(head);
+    uint64_t next = ((head >> 32) + 1) << 32 |
+        NodeAt(index).next_free_.load();
+    if (free_head_.compare_exchange_weak(head, next)) {
+      return index;
+    }
+  }
+  uint32_t index = next_index_.fetch_add(1);
+  if (index > kMaxIndex) {
+    throw std::bad_alloc();
+  }
+  uint64_t position = static_cast<uint64_t>(index) - 1 +
+      (uint64_t(1) << kFirstSegmentBits);
+  size_t segment = std::bit_width(position) - 1 - kFirstSegmentBits;
+  if (segments_[segment].load(std::memory_order_acquire) == nullptr) {
+    Node* nodes = new Node[size_t(1) << (segment + kFirstSegmentBits)];
+    Node* expected = nullptr;
+    if (!segments_[segment].compare_exchange_strong(expected, nodes)) {
+      delete[] nodes;
+    }
+  }
+  return index;
+}
+
+template<typename T>
+void ConcurrentDeque<T>::FreeNode(uint32_t index) {
+  uint64_t head = free_head_.load();
+  do {
+    NodeAt(index).next_free_.store(static_cast<uint32_t>(head));
+  } while (!free_head_.compare_exchange_weak(
+      head, ((head >> 32) + 1) << 32 | index));
+}
+
+template<typename T>
+typename ConcurrentDeque<T>::HazardRecord*
+    ConcurrentDeque<T>::AcquireRecord() {
+  for (HazardRecord* record = records_.load(); record != nullptr;
+       record = record->next_record_) {
+    bool expected = false;
+    if (!record->active_.load(std::memory_order_relaxed) &&
+        record->active_.compare_exchange_strong(expected, true)) {
+      return record;
+    }
+  }
+  HazardRecord* record = new HazardRecord();
+  HazardRecord* head = records_.load();
+  do {
+    record->next_record_ = head;
+  } while (!records_.compare_exchange_weak(head, record));
+  return record;
+}
+
+template<typename T>
+void ConcurrentDeque<T>::ReleaseRecord(
+    ConcurrentDeque::HazardRecord* record) {
+  for (auto& hazard : record->hazards_) {
+    hazard.store(kNull, std::memory_order_release);
+  }
+  record->active_.store(false, std::memory_order_release);
+}
+
+template<typename T>
+void ConcurrentDeque<T>::Retire(ConcurrentDeque::HazardRecord* record,
+                                uint32_t index) {
+  record->retired_.push_back(index);
+  if (record->retired_.size() >= kScanThreshold) {
+    Scan(record);
+  }
+}
+
+template<typename T>
+void ConcurrentDeque<T>::Scan(ConcurrentDeque::HazardRecord* record) {
+  std::vector<uint32_t> hazards;
+  for (HazardRecord* other = records_.load(); other != nullptr;
+       other = other->next_record_) {
+    for (auto& hazard : other->hazards_) {
+      uint32_t index = hazard.load();
+      if (index != kNull) {
+        hazards.push_back(index);
+      }
+    }
+  }
+  std::sort(hazards.begin(), hazards.end());
+  std::vector<uint32_t> still_retired;
+  for (uint32_t index : record->retired_) {
+    if (std::binary_search(hazards.begin(), hazards.end(), index)) {
+      still_retired.push_back(index);
+    } else {
+      FreeNode(index);
+    }
+  }
+  record->retired_.swap(still_retired);
+}
+
+template<typename T>
+template<typename Value>
+void ConcurrentDeque<T>::PushRight(Value&& value) {
+  uint32_t index = AllocateNode();
+  Node& node = NodeAt(index);
+  try {
+    ::new (static_cast<void*>(node.storage_)) T(std::forward<Value>(value));
+  } catch (...) {
+    FreeNode(index);
+    throw;
+  }
+  node.right_.store(kNull);
+  HazardGuard guard(this);
+  while (true) {
+    uint64_t word = anchor_.load();
+    Anchor anchor = Anchor::Unpack(word);
+    if (anchor.right_ == kNull) {
+      Anchor single{index, index, anchor.status_};
+      if (anchor_.compare_exchange_strong(word, single.Pack())) {
+        return;
+      }
+    } else if (anchor.status_ == kStable) {
+      node.left_.store(anchor.right_);
+      Anchor pushed{anchor.left_, index, kRightPush};
+      if (anchor_.compare_exchange_strong(word, pushed.Pack())) {
+        StabilizeRight(guard, pushed);
+        return;
+      }
+    } else {
+      Stabilize(guard, anchor);
+    }
+  }
+}
+template<typename T>
+template<typename Value>
+void ConcurrentDeque<T>::PushLeft(Value&& value) {
+  uint32_t index = AllocateNode();
+  Node& node = NodeAt(index);
+  try {
+    ::new (static_cast<void*>(node.storage_)) T(std::forward<Value>(value));
+  } catch (...) {
+    FreeNode(index);
+    throw;
+  }
+  node.left_.store(kNull);
+  HazardGuard guard(this);
+  while (true) {
+    uint64_t word = anchor_.load();
+    Anchor anchor = Anchor::Unpack(word);
+    if (anchor.left_ == kNull) {
+      Anchor single{index, index, anchor.status_};
+      if (anchor_.compare_exchange_strong(word, single.Pack())) {
+        return;
+      }
+    } else if (anchor.status_ == kStable) {
+      node.right_.store(anchor.left_);
+      Anchor pushed{index, anchor.right_, kLeftPush};
+      if (anchor_.compare_exchange_strong(word, pushed.Pack())) {
+        StabilizeLeft(guard, pushed);
+        return;
+      }
+    } else {
+      Stabilize(guard, anchor);
+    }
+  }
+}
+
+template<typename T>
+std::optional<T> ConcurrentDeque<T>::TakeValue(
+    ConcurrentDeque::HazardRecord* record, uint32_t index) {
+  T* value = NodeAt(index).Value();
+  std::optional<T> result(std::move(*value));
+  std::destroy_at(value);
+  Retire(record, index);
+  return result;
+}
+
+template<typename T>
+void ConcurrentDeque<T>::Stabilize(HazardGuard& guard, Anchor anchor) {
+  if (anchor.status_ == kRightPush) {
+    StabilizeRight(guard, anchor);
+  } else {
+    StabilizeLeft(guard, anchor);
+  }
+}
+
+template<typename T>
+void ConcurrentDeque<T>::StabilizeRight(HazardGuard& guard, Anchor anchor) {
+  uint64_t word = anchor.Pack();
+  guard.Protect(0, anchor.left_);
+  guard.Protect(1, anchor.right_);
+  if (anchor_.load() != word) {
+    return;
+  }
+  uint32_t previous = NodeAt(anchor.right_).left_.load();
+  guard.Protect(2, previous);
+  if (anchor_.load() != word) {
+    return;
+  }
+  uint32_t previous_next = NodeAt(previous).right_.load();
+  if (previous_next != anchor.right_) {
+    if (anchor_.load() != word) {
+      return;
+    }
+    if (!NodeAt(previous).right_.compare_exchange_strong(previous_next,
+                                                          anchor.right_)) {
+      return;
+    }
+  }
+  Anchor stable{anchor.left_, anchor.right_, kStable};
+  anchor_.compare_exchange_strong(word, stable.Pack());
+}
+template<typename T>
+void ConcurrentDeque<T>::StabilizeLeft(HazardGuard& guard, Anchor anchor) {
+  uint64_t word = anchor.Pack();
+  guard.Protect(0, anchor.left_);
+  guard.Protect(1, anchor.right_);
+  if (anchor_.load() != word) {
+    return;
+  }
+  uint32_t next = NodeAt(anchor.left_).right_.load();
+  guard.Protect(2, next);
+  if (anchor_.load() != word) {
+    return;
+  }
+  uint32_t next_previous = NodeAt(next).left_.load();
+  if (next_previous != anchor.left_) {
+    if (anchor_.load() != word) {
+      return;
+    }
+    if (!NodeAt(next).left_.compare_exchange_strong(next_previous,
+                                                    anchor.left_)) {
+      return;
+    }
+  }
+  Anchor stable{anchor.left_, anchor.right_, kStable};
+  anchor_.compare_exchange_strong(word, stable.Pack());
+}
+
+// Дек для планировщика с перехватом задач (work stealing) по схеме
+// Chase-Lev. PushBack и PopBack вызывает только поток-владелец, и в обычном
+// случае они обходятся без атомарных read-modify-write операций. Остальные
+// потоки забирают элементы с противоположного конца через Steal(), которому
+// нужен один compare_exchange; при проигранной гонке Steal() возвращает
+// std::nullopt, и вызывающий может просто попробовать снова.
+//
+// Тривиально копируемые элементы, для которых std::atomic<T> не использует
+// блокировок, лежат прямо в кольцевом буфере, так что PushBack и PopBack
+// обращаются к аллокатору только при росте буфера. Остальные элементы
+// хранятся в куче по указателю: Steal() читает слот до того, как выиграет
+// гонку, и копировать сам элемент в этот момент нельзя.
+template<typename T>
+class WorkStealingDeque {
+ public:
+  explicit WorkStealingDeque(size_t capacity = 64);
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  ~WorkStealingDeque();
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+  std::optional<T> PopBack();
+
+  std::optional<T> Steal();
+
+ private:
+  static constexpr bool StoresInline() {
+    if constexpr (std::is_trivially_copyable_v<T> &&
+                  std::is_default_constructible_v<T>) {
+      return std::atomic<T>::is_always_lock_free;
+    } else {
+      return false;
+    }
+  }
+
+  using Item = std::conditional_t<StoresInline(), T, T*>;
+
+  // Кольцевой буфер элементов (или указателей на них). Старые буферы после
+  // роста не освобождаются до уничтожения дека: их ещё может читать Steal().
+  struct Buffer {
+    explicit Buffer(size_t capacity)
+        : mask_(capacity - 1),
+          items_(new std::atomic<Item>[capacity]) {}
+
+    size_t Capacity() const { return mask_ + 1; }
+    Item Get(int64_t index) const {
+      return items_[index & mask_].load(std::memory_order_relaxed);
+    }
+    void Put(int64_t index, Item item) {
+      items_[index & mask_].store(item, std::memory_order_relaxed);
+    }
+
+    size_t mask_;
+    std::unique_ptr<std::atomic<Item>[]> items_;
+  };
+
+  alignas(NodePool::kCacheLineSize) std::atomic<int64_t> top_{0};
+  alignas(NodePool::kCacheLineSize) std::atomic<int64_t> bottom_{0};
+  std::atomic<Buffer*> buffer_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
+  template<typename U>
+  void Push(U&& value);
+  static std::optional<T> Take(Item item);
+};
+
+template<typename T>
+WorkStealingDeque<T>::WorkStealingDeque(size_t capacity) {
+  buffers_.push_back(std::make_unique<Buffer>(
+      std::bit_ceil(std::max<size_t>(capacity, 2))));
+  buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+}
+
+template<typename T>
+WorkStealingDeque<T>::~WorkStealingDeque() {
+  Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+  int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  if constexpr (!StoresInline()) {
+    for (int64_t i = top_.load(std::memory_order_relaxed); i < bottom; i++) {
+      delete buffer->Get(i);
+    }
+  }
+}
+
+template<typename T>
+bool WorkStealingDeque<T>::IsEmpty() const {
+  return Size() == 0;
+}
+
+template<typename T>
+size_t WorkStealingDeque<T>::Size() const {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  int64_t top = top_.load(std::memory_order_relaxed);
+  return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+}
+
+template<typename T>
+void WorkStealingDeque<T>::PushBack(const T& value) {
+  Push(value);
+}
+template<typename T>
+void WorkStealingDeque<T>::PushBack(T&& value) {
+  Push(std::move(value));
+}
+
+template<typename T>
+std::optional<T> WorkStealingDeque<T>::PopBack() {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+  Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+  bottom_.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = top_.load(std::memory_order_relaxed);
+  if (top > bottom) {
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  Item item = buffer->Get(bottom);
+  if (top == bottom) {
+    // Последний элемент: разыгрываем его с Steal() через top_.
+    bool won = top_.compare_exchange_strong(top, top + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    if (!won) {
+      return std::nullopt;
+    }
+  }
+  return Take(item);
+}
+
+template<typename T>
+std::optional<T> WorkStealingDeque<T>::Steal() {
+  int64_t top = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t bottom = bottom_.load(std::memory_order_acquire);
+  if (top >= bottom) {
+    return std::nullopt;
+  }
+  Item item = buffer_.load(std::memory_order_acquire)->Get(top);
+  if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed)) {
+    return std::nullopt;
+  }
+  return Take(item);
+}
+
+template<typename T>
+template<typename U>
+void WorkStealingDeque<T>::Push(U&& value) {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  int64_t top = top_.load(std::memory_order_acquire);
+  Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+  // Буфер растёт до того, как создаётся элемент: если рост бросит
+  // исключение, терять будет нечего.
+  if (bottom - top > static_cast<int64_t>(buffer->Capacity()) - 1) {
+    buffers_.push_back(std::make_unique<Buffer>(2 * buffer->Capacity()));
+    Buffer* grown = buffers_.back().get();
+    for (int64_t i = top; i < bottom; i++) {
+      grown->Put(i, buffer->Get(i));
+    }
+    buffer_.store(grown, std::memory_order_release);
+    buffer = grown;
+  }
+  if constexpr (StoresInline()) {
+    buffer->Put(bottom, std::forward<U>(value));
+  } else {
+    buffer->Put(bottom, new T(std::forward<U>(value)));
+  }
+  bottom_.store(bottom + 1, std::memory_order_release);
+}
+
+template<typename T>
+std::optional<T> WorkStealingDeque<T>::Take(Item item) {
+  if constexpr (StoresInline()) {
+    return std::optional<T>(item);
+  } else {
+    std::unique_ptr<T> owned(item);
+    return std::optional<T>(std::move(*owned));
+  }
+}
+
+// Потокобезопасный двусвязный список с замком на каждом узле. Обход идёт
+// "рука об руку": следующий узел блокируется, пока удерживается предыдущий,
+// поэтому правки в разных частях списка и поиск не мешают друг другу.
+// Блокирующие захваты всегда идут от first_ к last_; операции с конца
+// захватывают предыдущий узел через try_lock и при неудаче начинают заново,
+// так что взаимной блокировки не возникает. Итераторы наружу не отдаются:
+// Find возвращает копию значения.
+template<typename T>
+class FineGrainedBiDirectionalList {
+ public:
+  FineGrainedBiDirectionalList();
+
+  FineGrainedBiDirectionalList(const FineGrainedBiDirectionalList&) = delete;
+  FineGrainedBiDirectionalList& operator=(
+      const FineGrainedBiDirectionalList&) = delete;
+
+  ~FineGrainedBiDirectionalList();
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  std::vector<T> AsArray() const;
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+  void PushFront(const T& value);
+  void PushFront(T&& value);
+
+  std::optional<T> PopFront();
+  std::optional<T> PopBack();
+
+  bool Contains(const T& value) const;
+  template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  std::optional<T> Find(Predicate predicate) const;
+
+  // Вставляют значение перед (после) первым элементом, удовлетворяющим
+  // предикату. Возвращают false, если такого элемента нет.
+  template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  bool InsertBefore(Predicate predicate, const T& value);
+  template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  bool InsertBefore(Predicate predicate, T&& value);
+  template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  bool InsertAfter(Predicate predicate, const T& value);
+  template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  bool InsertAfter(Predicate predicate, T&& value);
+
+  bool Erase(const T& value);
+  template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  bool Erase(Predicate predicate);
+
+ protected:
+  struct Link {
+    std::mutex mutex_;
+    Link* next_node_ = nullptr;
+    Link* previous_node_ = nullptr;
+  };
+
+  struct Node : Link {
+    template<typename... Args>
+    explicit Node(std::in_place_t, Args&&... args)
+        : value_(std::forward<Args>(args)...) {}
+
+    T value_;
+  };
+
+  // Пара соседних узлов, оба заблокированы. current_ может быть last_.
+  struct LockedPair {
+    Link* previous_;
+    Link* current_;
+    std::unique_lock<std::mutex> previous_lock_;
+    std::unique_lock<std::mutex> current_lock_;
+  };
+
+  Link* first_;
+  Link* last_;
+  std::atomic<size_t> size_;
+
+  template<typename Predicate>
+  LockedPair LockFirstMatch(Predicate& predicate) const;
+  template<typename Predicate>
+  bool LinkBefore(Predicate& predicate, Node* node);
+  template<typename Predicate>
+  bool LinkAfter(Predicate& predicate, Node* node);
+  static void LinkBetween(Link* previous, Node* node, Link* next);
+
+  void LinkFront(Node* node);
+  void LinkBack(Node* node);
+};
+
+template<typename T>
+FineGrainedBiDirectionalList<T>::FineGrainedBiDirectionalList()
+    : first_(new Link),
+      last_(new Link),
+      size_(0) {
+  first_->next_node_ = last_;
+  last_->previous_node_ = first_;
+}
+
+template<typename T>
+FineGrainedBiDirectionalList<T>::~FineGrainedBiDirectionalList() {
+  Link* link = first_->next_node_;
+  while (link != last_) {
+    Link* next = link->next_node_;
+    delete static_cast<Node*>(link);
+    link = next;
+  }
+  delete first_;
+  delete last_;
+}
+
+template<typename T>
+bool FineGrainedBiDirectionalList<T>::IsEmpty() const {
+  return Size() == 0;
+}
+
+template<typename T>
+size_t FineGrainedBiDirectionalList<T>::Size() const {
+  return size_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+std::vector<T> FineGrainedBiDirectionalList<T>::AsArray() const {
+  std::vector<T> result;
+  result.reserve(Size());
+  auto collect = [&result](const T& value) {
+    result.push_back(value);
+    return false;
+  };
+  LockFirstMatch(collect);
+  return result;
+}
+
+template<typename T>
+void FineGrainedBiDirectionalList<T>::PushBack(const T& value) {
+  LinkBack(new Node(std::in_place, value));
+}
+template<typename T>
+void FineGrainedBiDirectionalList<T>::PushBack(T&& value) {
+  LinkBack(new Node(std::in_place, std::move(value)));
+}
+
+template<typename T>
+void FineGrainedBiDirectionalList<T>::PushFront(const T& value) {
+  LinkFront(new Node(std::in_place, value));
+}
+template<typename T>
+void FineGrainedBiDirectionalList<T>::PushFront(T&& value) {
+  LinkFront(new Node(std::in_place, std::move(value)));
+}
+
+template<typename T>
+std::optional<T> FineGrainedBiDirectionalList<T>::PopFront() {
+  std::unique_lock first_lock(first_->mutex_);
+  Link* node = first_->next_node_;
+  if (node == last_) {
+    return std::nullopt;
+  }
+  std::unique_lock node_lock(node->mutex_);
+  Link* next = node->next_node_;
+  std::unique_lock next_lock(next->mutex_);
+  first_->next_node_ = next;
+  next->previous_node_ = first_;
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  next_lock.unlock();
+  node_lock.unlock();
+  first_lock.unlock();
+  std::unique_ptr<Node> owned(static_cast<Node*>(node));
+  return std::optional<T>(std::move(owned->value_));
+}
+
+template<typename T>
+std::optional<T> FineGrainedBiDirectionalList<T>::PopBack() {
+  while (true) {
+    std::unique_lock last_lock(last_->mutex_);
+    Link* node = last_->previous_node_;
+    if (node == first_) {
+      return std::nullopt;
+    }
+    std::unique_lock node_lock(node->mutex_, std::try_to_lock);
+    if (!node_lock.owns_lock()) {
+      last_lock.unlock();
+      std::this_thread::yield();
+      continue;
+    }
+    Link* previous = node->previous_node_;
+    std::unique_lock previous_lock(previous->mutex_, std::try_to_lock);
+    if (!previous_lock.owns_lock()) {
+      node_lock.unlock();
+      last_lock.unlock();
+      std::this_thread::yield();
+      continue;
+    }
+    previous->next_node_ = last_;
+    last_->previous_node_ = previous;
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    previous_lock.unlock();
+    node_lock.unlock();
+    last_lock.unlock();
+    std::unique_ptr<Node> owned(static_cast<Node*>(node));
+    return std::optional<T>(std::move(owned->value_));
+  }
+}
+
+template<typename T>
+bool FineGrainedBiDirectionalList<T>::Contains(const T& value) const {
+  auto equal = [&value](const T& element) { return element == value; };
+  return LockFirstMatch(equal).current_ != last_;
+}
+
+template<typename T>
+template<typename Predicate>
+requires std::is_invocable_r_v<bool, Predicate&, const T&>
+std::optional<T> FineGrainedBiDirectionalList<T>::Find(
+    Predicate predicate) const {
+  LockedPair pair = LockFirstMatch(predicate);
+  if (pair.current_ == last_) {
+    return std::nullopt;
+  }
+  return static_cast<Node*>(pair.current_)->value_;
+}
+
+template<typename T>
+template<typename Predicate>
+requires std::is_invocable_r_v<bool, Predicate&, const T&>
+bool FineGrainedBiDirectionalList<T>::InsertBefore(Predicate predicate,
+                                                   const T& value) {
+  return LinkBefore(predicate, new Node(std::in_place, value));
+}
+template<typename T>
+template<typename Predicate>
+requires std::is_invocable_r_v<bool, Predicate&, const T&>
+bool FineGrainedBiDirectionalList<T>::InsertBefore(Predicate predicate,
+                                                   T&& value) {
+  return LinkBefore(predicate, new Node(std::in_place, std::move(value)));
+}
+
+template<typename T>
+template<typename Predicate>
+requires std::is_invocable_r_v<bool, Predicate&, const T&>
+bool FineGrainedBiDirectionalList<T>::InsertAfter(Predicate predicate,
+                                                  const T& value) {
+  return LinkAfter(predicate, new Node(std::in_place, value));
+}
+template<typename T>
+template<typename Predicate>
+requires std::is_invocable_r_v<bool, Predicate&, const T&>
+bool FineGrainedBiDirectionalList<T>::InsertAfter(Predicate predicate,
+                                                  T&& value) {
+  return LinkAfter(predicate, new Node(std::in_place, std::move(value)));
+}
+
+template<typename T>
+bool FineGrainedBiDirectionalList<T>::Erase(const T& value) {
+  return Erase([&value](const T& element) { return element == value; });
+}
+
+template<typename T>
+template<typename Predicate>
+requires std::is_invocable_r_v<bool, Predicate&, const T&>
+bool FineGrainedBiDirectionalList<T>::Erase(Predicate predicate) {
+  LockedPair pair = LockFirstMatch(predicate);
+  if (pair.current_ == last_) {
+    return false;
+  }
+  Link* next = pair.current_->next_node_;
+  std::unique_lock next_lock(next->mutex_);
+  pair.previous_->next_node_ = next;
+  next->previous_node_ = pair.previous_;
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  // Узел уже недостижим, а дойти до него можно только через заблокированных
+  // соседей, поэтому после снятия замков его можно удалить.
+  next_lock.unlock();
+  pair.current_lock_.unlock();
+  pair.previous_lock_.unlock();
+  delete static_cast<Node*>(pair.current_);
+  return true;
+}
+
+template<typename T>
+template<typename Predicate>
+typename FineGrainedBiDirectionalList<T>::LockedPair
+    FineGrainedBiDirectionalList<T>::LockFirstMatch(
+        Predicate& predicate) const {
+  LockedPair pair;
+  pair.previous_ = first_;
+  pair.previous_lock_ = std::unique_lock(first_->mutex_);
+  pair.current_ = first_->next_node_;
+  pair.current_lock_ = std::unique_lock(pair.current_->mutex_);
+  while (pair.current_ != last_ &&
+         !predicate(static_cast<Node*>(pair.current_)->value_)) {
+    pair.previous_lock_ = std::move(pair.current_lock_);
+    pair.previous_ = pair.current_;
+    pair.current_ = pair.current_->next_node_;
+    pair.current_lock_ = std::unique_lock(pair.current_->mutex_);
+  }
+  return pair;
+}
+
+template<typename T>
+template<typename Predicate>
+bool FineGrainedBiDirectionalList<T>::LinkBefore(Predicate& predicate,
+                                                 Node* node) {
+  std::unique_ptr<Node> owned(node);
+  LockedPair pair = LockFirstMatch(predicate);
+  if (pair.current_ == last_) {
+    return false;
+  }
+  LinkBetween(pair.previous_, owned.release(), pair.current_);
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+template<typename T>
+template<typename Predicate>
+bool FineGrainedBiDirectionalList<T>::LinkAfter(Predicate& predicate,
+                                                Node* node) {
+  std::unique_ptr<Node> owned(node);
+  LockedPair pair = LockFirstMatch(predicate);
+  if (pair.current_ == last_) {
+    return false;
+  }
+  pair.previous_lock_.unlock();
+  Link* next = pair.current_->next_node_;
+  std::unique_lock next_lock(next->mutex_);
+  LinkBetween(pair.current_, owned.release(), next);
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+template<typename T>
+void FineGrainedBiDirectionalList<T>::LinkBetween(Link* previous, Node* node,
+                                                  Link* next) {
+  node->previous_node_ = previous;
+  node->next_node_ = next;
+  previous->next_node_ = node;
+  next->previous_node_ = node;
+}
+
+template<typename T>
+void FineGrainedBiDirectionalList<T>::LinkFront(Node* node) {
+  std::unique_lock first_lock(first_->mutex_);
+  Link* next = first_->next_node_;
+  std::unique_lock next_lock(next->mutex_);
+  LinkBetween(first_, node, next);
+  size_.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename T>
+void FineGrainedBiDirectionalList<T>::LinkBack(Node* node) {
+  while (true) {
+    std::unique_lock last_lock(last_->mutex_);
+    Link* previous = last_->previous_node_;
+    std::unique_lock previous_lock(previous->mutex_, std::try_to_lock);
+    if (!previous_lock.owns_lock()) {
+      last_lock.unlock();
+      std::this_thread::yield();
+      continue;
+    }
+    LinkBetween(previous, node, last_);
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+}
+
+// Крючок интрузивного списка. Объект встраивает его полем и может входить
+// в несколько списков сразу, по одному крючку на список. Копия объекта
+// получает пустой крючок и ни в какой список не входит.
+template<typename T>
+struct IntrusiveListHook {
+  IntrusiveListHook() = default;
+  IntrusiveListHook(const IntrusiveListHook&) {}
+  IntrusiveListHook& operator=(const IntrusiveListHook&) { return *this; }
+
+  bool IsLinked() const { return list_ != nullptr; }
+
+  T* next_node_ = nullptr;
+  T* previous_node_ = nullptr;
+  const void* list_ = nullptr;
+};
+
+// Интрузивный список: связывает уже существующие объекты через их крючки
+// и ничего не выделяет. Вставка и удаление по ссылке на объект -- O(1).
+// Список не владеет объектами: Clear и деструктор только отцепляют их.
+template<typename T, IntrusiveListHook<T> T::*Hook>
+class IntrusiveBiDirectionalList {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    T& operator*() const;
+    T* operator->() const;
+
+    Iterator& operator++();
+    const Iterator operator++(int);
+
+    Iterator& operator--();
+    const Iterator operator--(int);
+
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+
+   private:
+    friend class IntrusiveBiDirectionalList;
+
+    const IntrusiveBiDirectionalList* list_;
+    T* node_;
+
+    Iterator(const IntrusiveBiDirectionalList* list, T* node)
+        : list_(list), node_(node) {}
+  };
+
+  class ConstIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const T& operator*() const;
+    const T* operator->() const;
+
+    ConstIterator& operator++();
+    const ConstIterator operator++(int);
+
+    ConstIterator& operator--();
+    const ConstIterator operator--(int);
+
+    bool operator==(const ConstIterator& other) const;
+    bool operator!=(const ConstIterator& other) const;
+
+   private:
+    friend class IntrusiveBiDirectionalList;
+
+    const IntrusiveBiDirectionalList* list_;
+    const T* node_;
+
+    ConstIterator(const IntrusiveBiDirectionalList* list, const T* node)
+        : list_(list), node_(node) {}
+  };
+
+  IntrusiveBiDirectionalList() : first_(nullptr), last_(nullptr), size_(0) {}
+
+  // Крючки помнят свой список, поэтому список нельзя ни копировать, ни
+  // перемещать.
+  IntrusiveBiDirectionalList(const IntrusiveBiDirectionalList&) = delete;
+  IntrusiveBiDirectionalList& operator=(
+      const IntrusiveBiDirectionalList&) = delete;
+
+  ~IntrusiveBiDirectionalList() { Clear(); }
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  void Clear();
+
+  Iterator begin();
+  Iterator end();
+
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  bool Contains(const T& element) const;
+  Iterator IteratorTo(T& element);
+  ConstIterator IteratorTo(const T& element) const;
+
+  void InsertBefore(Iterator position, T& element);
+  void InsertAfter(Iterator position, T& element);
+
+  void PushBack(T& element);
+  void PushFront(T& element);
+
+  void Erase(Iterator position);
+  void Erase(T& element);
+
+  void PopFront();
+  void PopBack();
+
+  Iterator Find(const T& value);
+  ConstIterator Find(const T& value) const;
+
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  Iterator Find(Predicate predicate);
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  ConstIterator Find(Predicate predicate) const;
+
+ protected:
+  T* first_;
+  T* last_;
+  size_t size_;
+
+  static IntrusiveListHook<T>& HookOf(T* element);
+  static const IntrusiveListHook<T>& HookOf(const T* element);
+
+  void LinkBefore(T* position, T* element);
+  void Unlink(T* element);
+};
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+T& IntrusiveBiDirectionalList<T, Hook>::Iterator::operator*() const {
+  return *node_;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+T* IntrusiveBiDirectionalList<T, Hook>::Iterator::operator->() const {
+  return node_;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::Iterator&
+    IntrusiveBiDirectionalList<T, Hook>::Iterator::operator++() {
+  if (node_ == nullptr) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  node_ = HookOf(node_).next_node_;
+  return *this;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+const typename IntrusiveBiDirectionalList<T, Hook>::Iterator
+    IntrusiveBiDirectionalList<T, Hook>::Iterator::operator++(int) {
+  Iterator old_iterator = *this;
+  ++*this;
+  return old_iterator;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::Iterator&
+    IntrusiveBiDirectionalList<T, Hook>::Iterator::operator--() {
+  if (node_ == list_->first_) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  }
+  node_ = node_ == nullptr ? list_->last_ : HookOf(node_).previous_node_;
+  return *this;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+const typename IntrusiveBiDirectionalList<T, Hook>::Iterator
+    IntrusiveBiDirectionalList<T, Hook>::Iterator::operator--(int) {
+  Iterator old_iterator = *this;
+  --*this;
+  return old_iterator;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+bool IntrusiveBiDirectionalList<T, Hook>::Iterator::operator==(
+    const Iterator& other) const {
+  return other.node_ == node_;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+bool IntrusiveBiDirectionalList<T, Hook>::Iterator::operator!=(
+    const Iterator& other) const {
+  return other.node_ != node_;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+const T& IntrusiveBiDirectionalList<T, Hook>::ConstIterator::
+    operator*() const {
+  return *node_;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+const T* IntrusiveBiDirectionalList<T, Hook>::ConstIterator::
+    operator->() const {
+  return node_;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator&
+    IntrusiveBiDirectionalList<T, Hook>::ConstIterator::operator++() {
+  if (node_ == nullptr) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  node_ = HookOf(node_).next_node_;
+  return *this;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+const typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator
+    IntrusiveBiDirectionalList<T, Hook>::ConstIterator::operator++(int) {
+  ConstIterator old_iterator = *this;
+  ++*this;
+  return old_iterator;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator&
+    IntrusiveBiDirectionalList<T, Hook>::ConstIterator::operator--() {
+  if (node_ == list_->first_) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  }
+  node_ = node_ == nullptr ? list_->last_ : HookOf(node_).previous_node_;
+  return *this;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+const typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator
+    IntrusiveBiDirectionalList<T, Hook>::ConstIterator::operator--(int) {
+  ConstIterator old_iterator = *this;
+  --*this;
+  return old_iterator;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+bool IntrusiveBiDirectionalList<T, Hook>::ConstIterator::operator==(
+    const ConstIterator& other) const {
+  return other.node_ == node_;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+bool IntrusiveBiDirectionalList<T, Hook>::ConstIterator::operator!=(
+    const ConstIterator& other) const {
+  return other.node_ != node_;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+bool IntrusiveBiDirectionalList<T, Hook>::IsEmpty() const {
+  return first_ == nullptr;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+size_t IntrusiveBiDirectionalList<T, Hook>::Size() const {
+  return size_;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::Clear() {
+  T* element = first_;
+  while (element != nullptr) {
+    IntrusiveListHook<T>& hook = HookOf(element);
+    element = hook.next_node_;
+    hook.next_node_ = nullptr;
+    hook.previous_node_ = nullptr;
+    hook.list_ = nullptr;
+  }
+  first_ = nullptr;
+  last_ = nullptr;
+  size_ = 0;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::Iterator
+    IntrusiveBiDirectionalList<T, Hook>::begin() {
+  return Iterator(this, first_);
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::Iterator
+    IntrusiveBiDirectionalList<T, Hook>::end() {
+  return Iterator(this, nullptr);
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator
+    IntrusiveBiDirectionalList<T, Hook>::begin() const {
+  return ConstIterator(this, first_);
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator
+    IntrusiveBiDirectionalList<T, Hook>::end() const {
+  return ConstIterator(this, nullptr);
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+bool IntrusiveBiDirectionalList<T, Hook>::Contains(const T& element) const {
+  return HookOf(&element).list_ == this;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::Iterator
+    IntrusiveBiDirectionalList<T, Hook>::IteratorTo(T& element) {
+  if (!Contains(element)) {
+    throw std::runtime_error("Impossible to find element of another list");
+  }
+  return Iterator(this, &element);
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator
+    IntrusiveBiDirectionalList<T, Hook>::IteratorTo(const T& element) const {
+  if (!Contains(element)) {
+    throw std::runtime_error("Impossible to find element of another list");
+  }
+  return ConstIterator(this, &element);
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::InsertBefore(Iterator position,
+                                                       T& element) {
+  if (position != end() && HookOf(position.node_).list_ != this) {
+    throw std::runtime_error("Impossible to insert before element of "
+                             "another list");
+  }
+  LinkBefore(position.node_, &element);
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::InsertAfter(Iterator position,
+                                                      T& element) {
+  if (position == end() && !IsEmpty()) {
+    throw std::runtime_error("Impossible to insert after end");
+  }
+  if (position != end() && HookOf(position.node_).list_ != this) {
+    throw std::runtime_error("Impossible to insert after element of "
+                             "another list");
+  }
+  LinkBefore(position == end() ? nullptr : HookOf(position.node_).next_node_,
+             &element);
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::PushBack(T& element) {
+  LinkBefore(nullptr, &element);
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::PushFront(T& element) {
+  LinkBefore(first_, &element);
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::Erase(Iterator position) {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  if (position == end()) {
+    throw std::runtime_error("Impossible to delete end");
+  }
+  if (HookOf(position.node_).list_ != this) {
+    throw std::runtime_error("Impossible to delete element of another list");
+  }
+  Unlink(position.node_);
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::Erase(T& element) {
+  if (!Contains(element)) {
+    throw std::runtime_error("Impossible to delete element of another list");
+  }
+  Unlink(&element);
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::PopFront() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Unlink(first_);
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::PopBack() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Unlink(last_);
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::Iterator
+    IntrusiveBiDirectionalList<T, Hook>::Find(const T& value) {
+  return Find([&value](const T& element) { return element == value; });
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator
+    IntrusiveBiDirectionalList<T, Hook>::Find(const T& value) const {
+  return Find([&value](const T& element) { return element == value; });
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename IntrusiveBiDirectionalList<T, Hook>::Iterator
+    IntrusiveBiDirectionalList<T, Hook>::Find(Predicate predicate) {
+  for (T* element = first_; element != nullptr;
+       element = HookOf(element).next_node_) {
+    if (predicate(std::as_const(*element))) {
+      return Iterator(this, element);
+    }
+  }
+  return end();
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename IntrusiveBiDirectionalList<T, Hook>::ConstIterator
+    IntrusiveBiDirectionalList<T, Hook>::Find(Predicate predicate) const {
+  for (const T* element = first_; element != nullptr;
+       element = HookOf(element).next_node_) {
+    if (predicate(*element)) {
+      return ConstIterator(this, element);
+    }
+  }
+  return end();
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+IntrusiveListHook<T>& IntrusiveBiDirectionalList<T, Hook>::HookOf(
+    T* element) {
+  return element->*Hook;
+}
+template<typename T, IntrusiveListHook<T> T::*Hook>
+const IntrusiveListHook<T>& IntrusiveBiDirectionalList<T, Hook>::HookOf(
+    const T* element) {
+  return element->*Hook;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::LinkBefore(T* position,
+                                                     T* element) {
+  IntrusiveListHook<T>& hook = HookOf(element);
+  if (hook.IsLinked()) {
+    throw std::runtime_error(
+        "Impossible to insert element that is already in a list");
+  }
+  T* previous = position == nullptr ? last_ : HookOf(position).previous_node_;
+  hook.next_node_ = position;
+  hook.previous_node_ = previous;
+  hook.list_ = this;
+  if (previous == nullptr) {
+    first_ = element;
+  } else {
+    HookOf(previous).next_node_ = element;
+  }
+  if (position == nullptr) {
+    last_ = element;
+  } else {
+    HookOf(position).previous_node_ = element;
+  }
+  ++size_;
+}
+
+template<typename T, IntrusiveListHook<T> T::*Hook>
+void IntrusiveBiDirectionalList<T, Hook>::Unlink(T* element) {
+  IntrusiveListHook<T>& hook = HookOf(element);
+  if (hook.previous_node_ == nullptr) {
+    first_ = hook.next_node_;
+  } else {
+    HookOf(hook.previous_node_).next_node_ = hook.next_node_;
+  }
+  if (hook.next_node_ == nullptr) {
+    last_ = hook.previous_node_;
+  } else {
+    HookOf(hook.next_node_).previous_node_ = hook.previous_node_;
+  }
+  hook.next_node_ = nullptr;
+  hook.previous_node_ = nullptr;
+  hook.list_ = nullptr;
+  --size_;
+}
+
+// LRU-кэш. Порядок использования хранит BiDirectionalList: в начале самая
+// свежая запись, в конце -- кандидат на вытеснение. Хеш-таблица отображает
+// ключ на узел списка, поэтому Get за O(1) перевешивает узел в начало без
+// выделений памяти, а Put вытесняет записи с конца. Ёмкость задаётся числом
+// записей и, при наличии функции веса, суммарным объёмом в байтах.
+template<typename K, typename V, typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>>
+class LruCache : protected BiDirectionalList<std::pair<K, V>> {
+  using Base = BiDirectionalList<std::pair<K, V>>;
+  using typename Base::Node;
+
+ public:
+  using Weigher = std::function<size_t(const K&, const V&)>;
+
+  struct Counters {
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    size_t evictions_ = 0;
+  };
+
+  explicit LruCache(size_t max_entries);
+  LruCache(size_t max_entries, size_t max_bytes, Weigher weigher);
+
+  LruCache(const LruCache& other);
+  LruCache(LruCache&& other) noexcept;
+
+  LruCache& operator=(const LruCache& other);
+  LruCache& operator=(LruCache&& other);
+
+  bool IsEmpty() const;
+  size_t Size() const;
+  size_t Bytes() const;
+
+  void Clear();
+
+  bool Contains(const K& key) const;
+
+  // Возвращает nullptr при промахе. Указатель действителен до следующего
+  // изменения кэша.
+  V* Get(const K& key);
+  const V* Peek(const K& key) const;
+
+  // Запись тяжелее max_bytes вытесняется сразу же.
+  void Put(const K& key, const V& value);
+  void Put(const K& key, V&& value);
+
+  bool Erase(const K& key);
+
+  // Ключи от самого свежего к самому старому.
+  std::vector<K> Keys() const;
+
+  Counters GetCounters() const;
+  void ResetCounters();
+
+ private:
+  std::unordered_map<K, Node*, Hash, KeyEqual> index_;
+  size_t max_entries_;
+  size_t max_bytes_;
+  size_t bytes_;
+  Weigher weigher_;
+  Counters counters_;
+
+  template<typename Value>
+  void Assign(const K& key, Value&& value);
+  void MoveToFront(Node* node);
+  void EvictOverflow();
+  size_t WeightOf(const Node* node) const;
+  void Rebuild();
+};
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCache<K, V, Hash, KeyEqual>::LruCache(size_t max_entries)
+    : LruCache(max_entries, std::numeric_limits<size_t>::max(), nullptr) {}
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCache<K, V, Hash, KeyEqual>::LruCache(size_t max_entries, size_t max_bytes,
+                                         Weigher weigher)
+    : max_entries_(max_entries), max_bytes_(max_bytes), bytes_(0),
+      weigher_(std::move(weigher)) {
+  if (max_entries_ == 0) {
+    throw std::runtime_error("Impossible to create cache with zero capacity");
+  }
+  index_.reserve(std::min<size_t>(max_entries_, 1024));
+}
+
+// Копия списка получает новые узлы, поэтому индекс строится заново.
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCache<K, V, Hash, KeyEqual>::LruCache(const LruCache& other)
+    : Base(other), max_entries_(other.max_entries_),
+      max_bytes_(other.max_bytes_), bytes_(other.bytes_),
+      weigher_(other.weigher_), counters_(other.counters_) {
+  Rebuild();
+}
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCache<K, V, Hash, KeyEqual>::LruCache(LruCache&& other) noexcept
+    : Base(std::move(other)), index_(std::move(other.index_)),
+      max_entries_(other.max_entries_), max_bytes_(other.max_bytes_),
+      bytes_(other.bytes_), weigher_(std::move(other.weigher_)),
+      counters_(other.counters_) {
+  other.index_.clear();
+  other.bytes_ = 0;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCache<K, V, Hash, KeyEqual>&
+    LruCache<K, V, Hash, KeyEqual>::operator=(const LruCache& other) {
+  if (this != &other) {
+    LruCache copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+template<typename K, typename V, typename Hash, typename KeyEqual>
+LruCache<K, V, Hash, KeyEqual>&
+    LruCache<K, V, Hash, KeyEqual>::operator=(LruCache&& other) {
+  if (this != &other) {
+    index_.clear();
+    Base::operator=(std::move(other));
+    index_ = std::move(other.index_);
+    max_entries_ = other.max_entries_;
+    max_bytes_ = other.max_bytes_;
+    bytes_ = other.bytes_;
+    weigher_ = std::move(other.weigher_);
+    counters_ = other.counters_;
+    other.index_.clear();
+    other.bytes_ = 0;
+  }
+  return *this;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+bool LruCache<K, V, Hash, KeyEqual>::IsEmpty() const {
+  return Base::IsEmpty();
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Hash, KeyEqual>::Size() const {
+  return Base::Size();
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Hash, KeyEqual>::Bytes() const {
+  return bytes_;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::Clear() {
+  index_.clear();
+  Base::Clear();
+  bytes_ = 0;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+bool LruCache<K, V, Hash, KeyEqual>::Contains(const K& key) const {
+  return index_.find(key) != index_.end();
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+V* LruCache<K, V, Hash, KeyEqual>::Get(const K& key) {
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    ++counters_.misses_;
+    return nullptr;
+  }
+  ++counters_.hits_;
+  MoveToFront(found->second);
+  return &found->second->value_.second;
+}
+template<typename K, typename V, typename Hash, typename KeyEqual>
+const V* LruCache<K, V, Hash, KeyEqual>::Peek(const K& key) const {
+  auto found = index_.find(key);
+  return found == index_.end() ? nullptr : &found->second->value_.second;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::Put(const K& key, const V& value) {
+  Assign(key, value);
+}
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::Put(const K& key, V&& value) {
+  Assign(key, std::move(value));
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+bool LruCache<K, V, Hash, KeyEqual>::Erase(const K& key) {
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    return false;
+  }
+  Node* node = found->second;
+  index_.erase(found);
+  bytes_ -= WeightOf(node);
+  Base::Erase(node);
+  return true;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+std::vector<K> LruCache<K, V, Hash, KeyEqual>::Keys() const {
+  std::vector<K> keys;
+  keys.reserve(Size());
+  for (Node* node = this->first_; node != nullptr; node = node->next_node_) {
+    keys.push_back(node->value_.first);
+  }
+  return keys;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+typename LruCache<K, V, Hash, KeyEqual>::Counters
+    LruCache<K, V, Hash, KeyEqual>::GetCounters() const {
+  return counters_;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::ResetCounters() {
+  counters_ = Counters();
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+template<typename Value>
+void LruCache<K, V, Hash, KeyEqual>::Assign(const K& key, Value&& value) {
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    Node* node = found->second;
+    bytes_ -= WeightOf(node);
+    node->value_.second = std::forward<Value>(value);
+    bytes_ += WeightOf(node);
+    MoveToFront(node);
+  } else {
+    Node* node = this->CreateNode(std::in_place, key,
+                                  std::forward<Value>(value));
+    try {
+      index_.emplace(key, node);
+    } catch (...) {
+      this->DestroyNode(node);
+      throw;
+    }
+    Base::InsertBefore(this->first_, node);
+    bytes_ += WeightOf(node);
+  }
+  EvictOverflow();
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::MoveToFront(Node* node) {
+  if (node == this->first_) {
+    return;
+  }
+  this->Unlink(node);
+  Base::InsertBefore(this->first_, node);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::EvictOverflow() {
+  while (!IsEmpty() && (Size() > max_entries_ || bytes_ > max_bytes_)) {
+    Node* victim = this->last_;
+    index_.erase(victim->value_.first);
+    bytes_ -= WeightOf(victim);
+    Base::Erase(victim);
+    ++counters_.evictions_;
+  }
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+size_t LruCache<K, V, Hash, KeyEqual>::WeightOf(const Node* node) const {
+  return weigher_ ? weigher_(node->value_.first, node->value_.second) : 0;
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+void LruCache<K, V, Hash, KeyEqual>::Rebuild() {
+  index_.clear();
+  index_.reserve(Size());
+  for (Node* node = this->first_; node != nullptr; node = node->next_node_) {
+    index_.emplace(node->value_.first, node);
+  }
+}
+
+// Список с хеш-индексом по значениям. Индекс хранит указатели на узлы и
+// обновляется при каждой вставке и удалении, поэтому Find(value), Contains
+// и Count работают за ожидаемое O(1); итераторы остаются такими же
+// стабильными, как у BiDirectionalList. Среди равных значений Find
+// возвращает любое. Итераторы только константные: значение, изменённое в
+// обход индекса, осталось бы в корзине старого хеша.
+template<typename T, typename Hash = std::hash<T>,
+    typename KeyEqual = std::equal_to<T>,
+    typename Allocator = std::allocator<T>>
+class IndexedBiDirectionalList : private BiDirectionalList<T, Allocator> {
+  using Base = BiDirectionalList<T, Allocator>;
+  using typename Base::Node;
+
+ public:
+  using typename Base::ConstIterator;
+
+  IndexedBiDirectionalList() = default;
+  explicit IndexedBiDirectionalList(const Allocator& allocator)
+      : Base(allocator) {}
+
+  IndexedBiDirectionalList(const IndexedBiDirectionalList& other);
+  IndexedBiDirectionalList(IndexedBiDirectionalList&& other) noexcept;
+
+  IndexedBiDirectionalList& operator=(const IndexedBiDirectionalList& other);
+  IndexedBiDirectionalList& operator=(IndexedBiDirectionalList&& other);
+
+  using Base::GetAllocator;
+  using Base::IsEmpty;
+  using Base::Size;
+  using Base::CopyTo;
+  using Base::Sort;
+  using Base::Reverse;
+  using Base::CountIf;
+
+  void Clear();
+
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  std::vector<T> AsArray() const &;
+  std::vector<T> AsArray() &&;
+
+  void InsertBefore(ConstIterator position, const T& value);
+  void InsertBefore(ConstIterator position, T&& value);
+
+  void InsertAfter(ConstIterator position, const T& value);
+  void InsertAfter(ConstIterator position, T&& value);
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+
+  void PushFront(const T& value);
+  void PushFront(T&& value);
+
+  template<typename... Args>
+  ConstIterator EmplaceBefore(ConstIterator position, Args&&... args);
+  template<typename... Args>
+  ConstIterator EmplaceAfter(ConstIterator position, Args&&... args);
+
+  template<typename... Args>
+  ConstIterator EmplaceBack(Args&&... args);
+  template<typename... Args>
+  ConstIterator EmplaceFront(Args&&... args);
+
+  void Erase(ConstIterator position);
+
+  void PopFront();
+  void PopBack();
+
+  template<typename Predicate>
+  size_t RemoveIf(Predicate predicate);
+
+  ConstIterator Find(const T& value) const;
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  ConstIterator Find(Predicate predicate) const;
+
+  template<typename Predicate>
+  ConstIterator FindLast(Predicate predicate) const;
+  template<typename Predicate>
+  std::vector<ConstIterator> FindAll(Predicate predicate) const;
+
+  bool Contains(const T& value) const;
+  size_t Count(const T& value) const;
+
+ private:
+  struct NodeHash {
+    using is_transparent = void;
+
+    size_t operator()(const Node* node) const { return hash_(node->value_); }
+    size_t operator()(const T& value) const { return hash_(value); }
+
+    Hash hash_;
+  };
+
+  struct NodeEqual {
+    using is_transparent = void;
+
+    bool operator()(const Node* left, const Node* right) const {
+      return equal_(left->value_, right->value_);
+    }
+    bool operator()(const T& left, const Node* right) const {
+      return equal_(left, right->value_);
+    }
+    bool operator()(const Node* left, const T& right) const {
+      return equal_(left->value_, right);
+    }
+
+    KeyEqual equal_;
+  };
+
+  std::unordered_multiset<Node*, NodeHash, NodeEqual> index_;
+
+  ConstIterator Index(typename Base::Iterator position);
+  void Unindex(Node* node);
+  void Rebuild();
+};
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::
+    IndexedBiDirectionalList(const IndexedBiDirectionalList& other)
+    : Base(other) {
+  Rebuild();
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::
+    IndexedBiDirectionalList(IndexedBiDirectionalList&& other) noexcept
+    : Base(std::move(other)), index_(std::move(other.index_)) {
+  other.index_.clear();
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>&
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::operator=(
+        const IndexedBiDirectionalList& other) {
+  if (this != &other) {
+    index_.clear();
+    Base::operator=(other);
+    Rebuild();
+  }
+  return *this;
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>&
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::operator=(
+        IndexedBiDirectionalList&& other) {
+  if (this != &other) {
+    // Узлы переезжают целиком, только если аллокаторы это позволяют;
+    // иначе элементы перемещаются в новые узлы и индекс строится заново.
+    bool steals_nodes = std::allocator_traits<Allocator>::
+        propagate_on_container_move_assignment::value ||
+        GetAllocator() == other.GetAllocator();
+    index_.clear();
+    Base::operator=(std::move(other));
+    if (steals_nodes) {
+      index_ = std::move(other.index_);
+    } else {
+      Rebuild();
+    }
+    other.index_.clear();
+  }
+  return *this;
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Clear() {
+  index_.clear();
+  Base::Clear();
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::begin() const {
+  return Base::begin();
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::end() const {
+  return Base::end();
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+std::vector<T> IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::
+    AsArray() const & {
+  return Base::AsArray();
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+std::vector<T> IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::
+    AsArray() && {
+  // Базовая версия освобождает узлы, на которые указывает индекс.
+  std::vector<T> values = std::move(*this).Base::AsArray();
+  index_.clear();
+  return values;
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::InsertBefore(
+    ConstIterator position, const T& value) {
+  Index(Base::EmplaceBefore(Base::IteratorOf(position), value));
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::InsertBefore(
+    ConstIterator position, T&& value) {
+  Index(Base::EmplaceBefore(Base::IteratorOf(position), std::move(value)));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::InsertAfter(
+    ConstIterator position, const T& value) {
+  Index(Base::EmplaceAfter(Base::IteratorOf(position), value));
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::InsertAfter(
+    ConstIterator position, T&& value) {
+  Index(Base::EmplaceAfter(Base::IteratorOf(position), std::move(value)));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::PushBack(
+    const T& value) {
+  Index(Base::EmplaceBack(value));
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::PushBack(
+    T&& value) {
+  Index(Base::EmplaceBack(std::move(value)));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::PushFront(
+    const T& value) {
+  Index(Base::EmplaceFront(value));
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::PushFront(
+    T&& value) {
+  Index(Base::EmplaceFront(std::move(value)));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::EmplaceBefore(
+        ConstIterator position, Args&&... args) {
+  return Index(Base::EmplaceBefore(Base::IteratorOf(position),
+                                   std::forward<Args>(args)...));
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::EmplaceAfter(
+        ConstIterator position, Args&&... args) {
+  return Index(Base::EmplaceAfter(Base::IteratorOf(position),
+                                  std::forward<Args>(args)...));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::EmplaceBack(
+        Args&&... args) {
+  return Index(Base::EmplaceBack(std::forward<Args>(args)...));
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::EmplaceFront(
+        Args&&... args) {
+  return Index(Base::EmplaceFront(std::forward<Args>(args)...));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Erase(
+    ConstIterator position) {
+  typename Base::Iterator mutable_position = Base::IteratorOf(position);
+  if (position != end()) {
+    Unindex(Base::NodeOf(mutable_position));
+  }
+  Base::Erase(mutable_position);
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::PopFront() {
+  if (!IsEmpty()) {
+    Unindex(this->first_);
+  }
+  Base::PopFront();
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::PopBack() {
+  if (!IsEmpty()) {
+    Unindex(this->last_);
+  }
+  Base::PopBack();
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename Predicate>
+size_t IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::RemoveIf(
+    Predicate predicate) {
+  size_t removed = 0;
+  Node* node = this->first_;
+  while (node != nullptr) {
+    Node* next = node->next_node_;
+    if (predicate(std::as_const(node->value_))) {
+      Unindex(node);
+      Base::Erase(node);
+      ++removed;
+    }
+    node = next;
+  }
+  return removed;
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Find(
+        const T& value) const {
+  auto found = index_.find(value);
+  return found == index_.end() ? end() : Base::IteratorOf(*found);
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Find(
+        Predicate predicate) const {
+  return Base::Find(std::move(predicate));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename Predicate>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::FindLast(
+        Predicate predicate) const {
+  return Base::FindLast(std::move(predicate));
+}
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename Predicate>
+std::vector<typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::
+    ConstIterator> IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::
+        FindAll(Predicate predicate) const {
+  return Base::FindAll(std::move(predicate));
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+bool IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Contains(
+    const T& value) const {
+  return index_.contains(value);
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+size_t IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Count(
+    const T& value) const {
+  return index_.count(value);
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::ConstIterator
+    IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Index(
+        typename Base::Iterator position) {
+  Node* node = Base::NodeOf(position);
+  try {
+    index_.insert(node);
+  } catch (...) {
+    Base::Erase(position);
+    throw;
+  }
+  return std::as_const(*this).IteratorOf(node);
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Unindex(
+    Node* node) {
+  auto [first, last] = index_.equal_range(node);
+  for (auto entry = first; entry != last; ++entry) {
+    if (*entry == node) {
+      index_.erase(entry);
+      return;
+    }
+  }
+}
+
+template<typename T, typename Hash, typename KeyEqual, typename Allocator>
+void IndexedBiDirectionalList<T, Hash, KeyEqual, Allocator>::Rebuild() {
+  index_.clear();
+  index_.reserve(Size());
+  for (Node* node = this->first_; node != nullptr; node = node->next_node_) {
+    index_.insert(node);
+  }
+}
+
+// Список с доступом по позиции за O(log n). Кроме связей next/previous узлы
+// образуют неявное декартово дерево (treap): порядок обхода дерева совпадает
+// с порядком списка, а каждый узел хранит размер своего поддерева. Вставка и
+// удаление в середине стоят ожидаемые O(log n), обход итераторами -- O(1)
+// на шаг, как у BiDirectionalList.
+template<typename T, typename Allocator = std::allocator<T>>
+class RankedBiDirectionalList {
+ protected:
+  struct Node;
+
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    T& operator*() const;
+    T* operator->() const;
+
+    Iterator& operator++();
+    const Iterator operator++(int);
+
+    Iterator& operator--();
+    const Iterator operator--(int);
+
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+
+   private:
+    friend class RankedBiDirectionalList;
+
+    const RankedBiDirectionalList* list_;
+    Node* node_;
+
+    Iterator(const RankedBiDirectionalList* list, Node* node)
+        : list_(list), node_(node) {}
+  };
+
+  class ConstIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const T& operator*() const;
+    const T* operator->() const;
+
+    ConstIterator& operator++();
+    const ConstIterator operator++(int);
+
+    ConstIterator& operator--();
+    const ConstIterator operator--(int);
+
+    bool operator==(const ConstIterator& other) const;
+    bool operator!=(const ConstIterator& other) const;
+
+   private:
+    friend class RankedBiDirectionalList;
+
+    const RankedBiDirectionalList* list_;
+    const Node* node_;
+
+    ConstIterator(const RankedBiDirectionalList* list, const Node* node)
+        : list_(list), node_(node) {}
+  };
+
+  RankedBiDirectionalList() : RankedBiDirectionalList(Allocator()) {}
+  explicit RankedBiDirectionalList(const Allocator& allocator)
+      : node_allocator_(allocator), first_(nullptr), last_(nullptr),
+        root_(nullptr) {}
+
+  RankedBiDirectionalList(const RankedBiDirectionalList& other);
+  RankedBiDirectionalList(RankedBiDirectionalList&& other) noexcept;
+
+  RankedBiDirectionalList& operator=(const RankedBiDirectionalList& other);
+  RankedBiDirectionalList& operator=(RankedBiDirectionalList&& other) noexcept;
+
+  ~RankedBiDirectionalList() { Clear(); }
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  void Clear();
+
+  Iterator begin();
+  Iterator end();
+
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  std::vector<T> AsArray() const;
+
+  T& At(size_t index);
+  const T& At(size_t index) const;
+
+  // IteratorAt(Size()) -- это end().
+  Iterator IteratorAt(size_t index);
+  ConstIterator IteratorAt(size_t index) const;
+
+  size_t IndexOf(Iterator position) const;
+  size_t IndexOf(ConstIterator position) const;
+
+  Iterator Advance(Iterator position, std::ptrdiff_t distance);
+  ConstIterator Advance(ConstIterator position,
+                        std::ptrdiff_t distance) const;
+
+  void InsertBefore(Iterator position, const T& value);
+  void InsertBefore(Iterator position, T&& value);
+
+  void InsertAfter(Iterator position, const T& value);
+  void InsertAfter(Iterator position, T&& value);
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+
+  void PushFront(const T& value);
+  void PushFront(T&& value);
+
+  void Erase(Iterator position);
+
+  void PopFront();
+  void PopBack();
+
+  Iterator Find(const T& value);
+  ConstIterator Find(const T& value) const;
+
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  Iterator Find(Predicate predicate);
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  ConstIterator Find(Predicate predicate) const;
+
+ protected:
+  struct Node {
+    template<typename... Args>
+    Node(uint32_t priority, Args&&... args);
+
+    T value_;
+    Node* next_node_;
+    Node* previous_node_;
+
+    Node* parent_;
+    Node* left_;
+    Node* right_;
+    size_t subtree_size_;
+    uint32_t priority_;
+  };
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::
+      template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  NodeAllocator node_allocator_;
+  Node* first_;
+  Node* last_;
+  Node* root_;
+  uint32_t random_state_ = 0x9E3779B9u;
+
+  template<typename... Args>
+  Node* CreateNode(Args&&... args);
+  void DestroyNode(Node* node);
+
+  // Вставляет узел перед position (nullptr -- в конец) и в список, и в
+  // дерево, затем поднимает его по приоритету.
+  void LinkBefore(Node* position, Node* node);
+  void Unlink(Node* node);
+
+  Node* NodeAt(size_t index) const;
+  size_t RankOf(const Node* node) const;
+
+  void RotateUp(Node* node);
+  void ReplaceChild(Node* parent, Node* old_child, Node* new_child);
+  static size_t SubtreeSize(const Node* node);
+  static void UpdateSize(Node* node);
+};
+
+template<typename T, typename Allocator>
+template<typename... Args>
+RankedBiDirectionalList<T, Allocator>::Node::Node(uint32_t priority,
+                                                  Args&&... args)
+    : value_(std::forward<Args>(args)...), next_node_(nullptr),
+      previous_node_(nullptr), parent_(nullptr), left_(nullptr),
+      right_(nullptr), subtree_size_(1), priority_(priority) {}
+
+template<typename T, typename Allocator>
+T& RankedBiDirectionalList<T, Allocator>::Iterator::operator*() const {
+  return node_->value_;
+}
+template<typename T, typename Allocator>
+T* RankedBiDirectionalList<T, Allocator>::Iterator::operator->() const {
+  return &node_->value_;
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Iterator&
+    RankedBiDirectionalList<T, Allocator>::Iterator::operator++() {
+  if (node_ == nullptr) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  node_ = node_->next_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::Iterator::operator++(int) {
+  Iterator old_iterator = *this;
+  ++*this;
+  return old_iterator;
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Iterator&
+    RankedBiDirectionalList<T, Allocator>::Iterator::operator--() {
+  if (node_ == list_->first_) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  }
+  node_ = node_ == nullptr ? list_->last_ : node_->previous_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::Iterator::operator--(int) {
+  Iterator old_iterator = *this;
+  --*this;
+  return old_iterator;
+}
+
+template<typename T, typename Allocator>
+bool RankedBiDirectionalList<T, Allocator>::Iterator::operator==(
+    const Iterator& other) const {
+  return other.node_ == node_;
+}
+template<typename T, typename Allocator>
+bool RankedBiDirectionalList<T, Allocator>::Iterator::operator!=(
+    const Iterator& other) const {
+  return other.node_ != node_;
+}
+
+template<typename T, typename Allocator>
+const T& RankedBiDirectionalList<T, Allocator>::ConstIterator::
+    operator*() const {
+  return node_->value_;
+}
+template<typename T, typename Allocator>
+const T* RankedBiDirectionalList<T, Allocator>::ConstIterator::
+    operator->() const {
+  return &node_->value_;
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator&
+    RankedBiDirectionalList<T, Allocator>::ConstIterator::operator++() {
+  if (node_ == nullptr) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  node_ = node_->next_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::ConstIterator::operator++(int) {
+  ConstIterator old_iterator = *this;
+  ++*this;
+  return old_iterator;
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator&
+    RankedBiDirectionalList<T, Allocator>::ConstIterator::operator--() {
+  if (node_ == list_->first_) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  }
+  node_ = node_ == nullptr ? list_->last_ : node_->previous_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::ConstIterator::operator--(int) {
+  ConstIterator old_iterator = *this;
+  --*this;
+  return old_iterator;
+}
+
+template<typename T, typename Allocator>
+bool RankedBiDirectionalList<T, Allocator>::ConstIterator::operator==(
+    const ConstIterator& other) const {
+  return other.node_ == node_;
+}
+template<typename T, typename Allocator>
+bool RankedBiDirectionalList<T, Allocator>::ConstIterator::operator!=(
+    const ConstIterator& other) const {
+  return other.node_ != node_;
+}
+
+template<typename T, typename Allocator>
+RankedBiDirectionalList<T, Allocator>::RankedBiDirectionalList(
+    const RankedBiDirectionalList& other)
+    : RankedBiDirectionalList(NodeAllocatorTraits::
+          select_on_container_copy_construction(other.node_allocator_)) {
+  for (const Node* node = other.first_; node != nullptr;
+       node = node->next_node_) {
+    PushBack(node->value_);
+  }
+}
+template<typename T, typename Allocator>
+RankedBiDirectionalList<T, Allocator>::RankedBiDirectionalList(
+    RankedBiDirectionalList&& other) noexcept
+    : node_allocator_(other.node_allocator_), first_(other.first_),
+      last_(other.last_), root_(other.root_),
+      random_state_(other.random_state_) {
+  other.first_ = other.last_ = other.root_ = nullptr;
+}
+
+template<typename T, typename Allocator>
+RankedBiDirectionalList<T, Allocator>&
+    RankedBiDirectionalList<T, Allocator>::operator=(
+        const RankedBiDirectionalList& other) {
+  if (this != &other) {
+    RankedBiDirectionalList copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+template<typename T, typename Allocator>
+RankedBiDirectionalList<T, Allocator>&
+    RankedBiDirectionalList<T, Allocator>::operator=(
+        RankedBiDirectionalList&& other) noexcept {
+  if (this != &other) {
+    Clear();
+    node_allocator_ = other.node_allocator_;
+    std::swap(first_, other.first_);
+    std::swap(last_, other.last_);
+    std::swap(root_, other.root_);
+  }
+  return *this;
+}
+
+template<typename T, typename Allocator>
+bool RankedBiDirectionalList<T, Allocator>::IsEmpty() const {
+  return root_ == nullptr;
+}
+
+template<typename T, typename Allocator>
+size_t RankedBiDirectionalList<T, Allocator>::Size() const {
+  return SubtreeSize(root_);
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::Clear() {
+  Node* node = first_;
+  while (node != nullptr) {
+    Node* next = node->next_node_;
+    DestroyNode(node);
+    node = next;
+  }
+  first_ = last_ = root_ = nullptr;
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::begin() {
+  return Iterator(this, first_);
+}
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::end() {
+  return Iterator(this, nullptr);
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::begin() const {
+  return ConstIterator(this, first_);
+}
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::end() const {
+  return ConstIterator(this, nullptr);
+}
+
+template<typename T, typename Allocator>
+std::vector<T> RankedBiDirectionalList<T, Allocator>::AsArray() const {
+  std::vector<T> result;
+  result.reserve(Size());
+  for (const Node* node = first_; node != nullptr; node = node->next_node_) {
+    result.push_back(node->value_);
+  }
+  return result;
+}
+
+template<typename T, typename Allocator>
+T& RankedBiDirectionalList<T, Allocator>::At(size_t index) {
+  if (index >= Size()) {
+    throw std::runtime_error("Impossible to access element out of range");
+  }
+  return NodeAt(index)->value_;
+}
+template<typename T, typename Allocator>
+const T& RankedBiDirectionalList<T, Allocator>::At(size_t index) const {
+  if (index >= Size()) {
+    throw std::runtime_error("Impossible to access element out of range");
+  }
+  return NodeAt(index)->value_;
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::IteratorAt(size_t index) {
+  if (index > Size()) {
+    throw std::runtime_error("Impossible to access element out of range");
+  }
+  return Iterator(this, index == Size() ? nullptr : NodeAt(index));
+}
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::IteratorAt(size_t index) const {
+  if (index > Size()) {
+    throw std::runtime_error("Impossible to access element out of range");
+  }
+  return ConstIterator(this, index == Size() ? nullptr : NodeAt(index));
+}
+
+template<typename T, typename Allocator>
+size_t RankedBiDirectionalList<T, Allocator>::IndexOf(
+    Iterator position) const {
+  return position.node_ == nullptr ? Size() : RankOf(position.node_);
+}
+template<typename T, typename Allocator>
+size_t RankedBiDirectionalList<T, Allocator>::IndexOf(
+    ConstIterator position) const {
+  return position.node_ == nullptr ? Size() : RankOf(position.node_);
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::Advance(Iterator position,
+                                                   std::ptrdiff_t distance) {
+  std::ptrdiff_t index =
+      static_cast<std::ptrdiff_t>(IndexOf(position)) + distance;
+  if (index < 0 || index > static_cast<std::ptrdiff_t>(Size())) {
+    throw std::runtime_error("Impossible to advance iterator");
+  }
+  return IteratorAt(index);
+}
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::Advance(
+        ConstIterator position, std::ptrdiff_t distance) const {
+  std::ptrdiff_t index =
+      static_cast<std::ptrdiff_t>(IndexOf(position)) + distance;
+  if (index < 0 || index > static_cast<std::ptrdiff_t>(Size())) {
+    throw std::runtime_error("Impossible to advance iterator");
+  }
+  return IteratorAt(index);
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::InsertBefore(Iterator position,
+                                                         const T& value) {
+  LinkBefore(position.node_, CreateNode(value));
+}
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::InsertBefore(Iterator position,
+                                                         T&& value) {
+  LinkBefore(position.node_, CreateNode(std::move(value)));
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::InsertAfter(Iterator position,
+                                                        const T& value) {
+  if (position == end() && !IsEmpty()) {
+    throw std::runtime_error("Impossible to insert after end");
+  }
+  Node* new_node = CreateNode(value);
+  LinkBefore(position == end() ? nullptr : position.node_->next_node_,
+             new_node);
+}
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::InsertAfter(Iterator position,
+                                                        T&& value) {
+  if (position == end() && !IsEmpty()) {
+    throw std::runtime_error("Impossible to insert after end");
+  }
+  Node* new_node = CreateNode(std::move(value));
+  LinkBefore(position == end() ? nullptr : position.node_->next_node_,
+             new_node);
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::PushBack(const T& value) {
+  LinkBefore(nullptr, CreateNode(value));
+}
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::PushBack(T&& value) {
+  LinkBefore(nullptr, CreateNode(std::move(value)));
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::PushFront(const T& value) {
+  LinkBefore(first_, CreateNode(value));
+}
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::PushFront(T&& value) {
+  LinkBefore(first_, CreateNode(std::move(value)));
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::Erase(Iterator position) {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  if (position == end()) {
+    throw std::runtime_error("Impossible to delete end");
+  }
+  Unlink(position.node_);
+  DestroyNode(position.node_);
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::PopFront() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase(begin());
+}
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::PopBack() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase(--end());
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::Find(const T& value) {
+  return Find([&value](const T& element) { return element == value; });
+}
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::Find(const T& value) const {
+  return Find([&value](const T& element) { return element == value; });
+}
+
+template<typename T, typename Allocator>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename RankedBiDirectionalList<T, Allocator>::Iterator
+    RankedBiDirectionalList<T, Allocator>::Find(Predicate predicate) {
+  for (Node* node = first_; node != nullptr; node = node->next_node_) {
+    if (predicate(std::as_const(node->value_))) {
+      return Iterator(this, node);
+    }
+  }
+  return end();
+}
+template<typename T, typename Allocator>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename RankedBiDirectionalList<T, Allocator>::ConstIterator
+    RankedBiDirectionalList<T, Allocator>::Find(Predicate predicate) const {
+  for (const Node* node = first_; node != nullptr; node = node->next_node_) {
+    if (predicate(node->value_)) {
+      return ConstIterator(this, node);
+    }
+  }
+  return end();
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+typename RankedBiDirectionalList<T, Allocator>::Node*
+    RankedBiDirectionalList<T, Allocator>::CreateNode(Args&&... args) {
+  // xorshift32: приоритетам достаточно дешёвой псевдослучайности.
+  random_state_ ^= random_state_ << 13;
+  random_state_ ^= random_state_ >> 17;
+  random_state_ ^= random_state_ << 5;
+  Node* node = NodeAllocatorTraits::allocate(node_allocator_, 1);
+  try {
+    NodeAllocatorTraits::construct(node_allocator_, node, random_state_,
+                                   std::forward<Args>(args)...);
+  } catch (...) {
+    NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+    throw;
+  }
+  return node;
+}
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::DestroyNode(Node* node) {
+  NodeAllocatorTraits::destroy(node_allocator_, node);
+  NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::LinkBefore(Node* position,
+                                                       Node* node) {
+  Node* previous = position == nullptr ? last_ : position->previous_node_;
+  node->previous_node_ = previous;
+  node->next_node_ = position;
+  if (previous == nullptr) {
+    first_ = node;
+  } else {
+    previous->next_node_ = node;
+  }
+  if (position == nullptr) {
+    last_ = node;
+  } else {
+    position->previous_node_ = node;
+  }
+
+  // В дереве новый узел становится левым ребёнком position либо правым
+  // ребёнком своего предшественника: одно из этих мест всегда свободно.
+  if (root_ == nullptr) {
+    root_ = node;
+    return;
+  }
+  if (position != nullptr && position->left_ == nullptr) {
+    position->left_ = node;
+    node->parent_ = position;
+  } else {
+    previous->right_ = node;
+    node->parent_ = previous;
+  }
+  for (Node* ancestor = node->parent_; ancestor != nullptr;
+       ancestor = ancestor->parent_) {
+    ++ancestor->subtree_size_;
+  }
+  while (node->parent_ != nullptr &&
+         node->parent_->priority_ < node->priority_) {
+    RotateUp(node);
+  }
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::Unlink(Node* node) {
+  if (node->previous_node_ == nullptr) {
+    first_ = node->next_node_;
+  } else {
+    node->previous_node_->next_node_ = node->next_node_;
+  }
+  if (node->next_node_ == nullptr) {
+    last_ = node->previous_node_;
+  } else {
+    node->next_node_->previous_node_ = node->previous_node_;
+  }
+
+  while (node->left_ != nullptr && node->right_ != nullptr) {
+    RotateUp(node->left_->priority_ > node->right_->priority_ ?
+             node->left_ : node->right_);
+  }
+  Node* child = node->left_ != nullptr ? node->left_ : node->right_;
+  Node* parent = node->parent_;
+  if (child != nullptr) {
+    child->parent_ = parent;
+  }
+  ReplaceChild(parent, node, child);
+  for (Node* ancestor = parent; ancestor != nullptr;
+       ancestor = ancestor->parent_) {
+    --ancestor->subtree_size_;
+  }
+}
+
+template<typename T, typename Allocator>
+typename RankedBiDirectionalList<T, Allocator>::Node*
+    RankedBiDirectionalList<T, Allocator>::NodeAt(size_t index) const {
+  Node* node = root_;
+  while (true) {
+    size_t left_size = SubtreeSize(node->left_);
+    if (index < left_size) {
+      node = node->left_;
+    } else if (index == left_size) {
+      return node;
+    } else {
+      index -= left_size + 1;
+      node = node->right_;
+    }
+  }
+}
+
+template<typename T, typename Allocator>
+size_t RankedBiDirectionalList<T, Allocator>::RankOf(const Node* node) const {
+  size_t rank = SubtreeSize(node->left_);
+  for (; node->parent_ != nullptr; node = node->parent_) {
+    if (node->parent_->right_ == node) {
+      rank += SubtreeSize(node->parent_->left_) + 1;
+    }
+  }
+  return rank;
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::RotateUp(Node* node) {
+  Node* parent = node->parent_;
+  Node* grandparent = parent->parent_;
+  if (parent->left_ == node) {
+    parent->left_ = node->right_;
+    if (node->right_ != nullptr) {
+      node->right_->parent_ = parent;
+    }
+    node->right_ = parent;
+  } else {
+    parent->right_ = node->left_;
+    if (node->left_ != nullptr) {
+      node->left_->parent_ = parent;
+    }
+    node->left_ = parent;
+  }
+  parent->parent_ = node;
+  node->parent_ = grandparent;
+  ReplaceChild(grandparent, parent, node);
+  UpdateSize(parent);
+  UpdateSize(node);
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::ReplaceChild(Node* parent,
+                                                         Node* old_child,
+                                                         Node* new_child) {
+  if (parent == nullptr) {
+    root_ = new_child;
+  } else if (parent->left_ == old_child) {
+    parent->left_ = new_child;
+  } else {
+    parent->right_ = new_child;
+  }
+}
+
+template<typename T, typename Allocator>
+size_t RankedBiDirectionalList<T, Allocator>::SubtreeSize(const Node* node) {
+  return node == nullptr ? 0 : node->subtree_size_;
+}
+
+template<typename T, typename Allocator>
+void RankedBiDirectionalList<T, Allocator>::UpdateSize(Node* node) {
+  node->subtree_size_ = SubtreeSize(node->left_) + 1 +
+                        SubtreeSize(node->right_);
+}
+
+// Список с компактными узлами: узлы лежат в блоках по kBlockSize штук и
+// связаны 32-битными индексами вместо указателей. Узел int занимает 12 байт
+// вместо 24, и в кэш-линию помещается вдвое больше узлов. Освобождённые узлы
+// переиспользуются через список свободных, а память блоков возвращается
+// только в Clear() и деструкторе. Интерфейс тот же, что у BiDirectionalList,
+// кроме Splice, Merge и SplitAt: индекс узла имеет смысл только в своём пуле,
+// и перевесить узел в другой список без копирования нельзя. Статистики
+// BIDIRECTIONAL_LIST_STATS тоже нет, она собирается только для
+// BiDirectionalList. Список вмещает не больше 2^32 - 1 элементов.
+template<typename T, typename Allocator = std::allocator<T>>
+class CompactBiDirectionalList {
+  struct Slot;
+
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    T& operator*() const;
+    T* operator->() const;
+
+    Iterator& operator++();
+    const Iterator operator++(int);
+
+    Iterator& operator--();
+    const Iterator operator--(int);
+
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+
+   private:
+    friend class CompactBiDirectionalList;
+
+    const CompactBiDirectionalList* list_;
+    uint32_t index_;
+
+    Iterator(const CompactBiDirectionalList* list, uint32_t index)
+        : list_(list), index_(index) {}
+  };
+
+  class ConstIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    ConstIterator(const Iterator& other)
+        : list_(other.list_), index_(other.index_) {}
+
+    const T& operator*() const;
+    const T* operator->() const;
+
+    ConstIterator& operator++();
+    const ConstIterator operator++(int);
+
+    ConstIterator& operator--();
+    const ConstIterator operator--(int);
+
+    bool operator==(const ConstIterator& other) const;
+    bool operator!=(const ConstIterator& other) const;
+
+   private:
+    friend class CompactBiDirectionalList;
+
+    const CompactBiDirectionalList* list_;
+    uint32_t index_;
+
+    ConstIterator(const CompactBiDirectionalList* list, uint32_t index)
+        : list_(list), index_(index) {}
+  };
+
+  CompactBiDirectionalList() : CompactBiDirectionalList(Allocator()) {}
+  explicit CompactBiDirectionalList(const Allocator& allocator)
+      : slot_allocator_(allocator), blocks_(BlockAllocator(allocator)),
+        first_(kNull), last_(kNull), free_(kNull), used_(0), size_(0) {}
+
+  CompactBiDirectionalList(const CompactBiDirectionalList& other);
+  CompactBiDirectionalList(CompactBiDirectionalList&& other) noexcept;
+
+  CompactBiDirectionalList& operator=(const CompactBiDirectionalList& other);
+  CompactBiDirectionalList& operator=(CompactBiDirectionalList&& other);
+
+  ~CompactBiDirectionalList() { Clear(); }
+
+  Allocator GetAllocator() const;
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  void Clear();
+
+  // Выделяет блоки заранее, чтобы вставка count элементов не обращалась к
+  // аллокатору.
+  void Reserve(size_t count);
+  // Память, занятая блоками узлов, включая свободные ячейки.
+  size_t CapacityBytes() const;
+
+  Iterator begin();
+  Iterator end();
+
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  std::vector<T> AsArray() const &;
+  std::vector<T> AsArray() &&;
+
+  template<typename OutputIt>
+    requires std::output_iterator<OutputIt, const T&>
+  OutputIt CopyTo(OutputIt destination) const;
+  size_t CopyTo(std::span<T> destination) const;
+
+  void InsertBefore(Iterator position, const T& value);
+  void InsertBefore(Iterator position, T&& value);
+
+  void InsertAfter(Iterator position, const T& value);
+  void InsertAfter(Iterator position, T&& value);
+
+  void PushBack(const T& value);
+  void PushBack(T&& value);
+
+  void PushFront(const T& value);
+  void PushFront(T&& value);
+
+  template<typename... Args>
+  Iterator EmplaceBefore(Iterator position, Args&&... args);
+  template<typename... Args>
+  Iterator EmplaceAfter(Iterator position, Args&&... args);
+
+  template<typename... Args>
+  Iterator EmplaceBack(Args&&... args);
+  template<typename... Args>
+  Iterator EmplaceFront(Args&&... args);
+
+  void Erase(Iterator position);
+
+  void PopFront();
+  void PopBack();
+
+  // Восходящее слияние по цепочке индексов, как у BiDirectionalList:
+  // устойчиво, без дополнительной памяти, итераторы остаются верными.
+  void Sort();
+  template<typename Compare>
+  void Sort(Compare compare);
+
+  size_t Unique();
+  template<typename BinaryPredicate>
+  size_t Unique(BinaryPredicate predicate);
+
+  void Reverse();
+
+  Iterator Find(const T& value);
+  ConstIterator Find(const T& value) const;
+
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  Iterator Find(Predicate predicate);
+  template<typename Predicate>
+    requires std::is_invocable_r_v<bool, Predicate&, const T&>
+  ConstIterator Find(Predicate predicate) const;
+
+  template<typename Predicate>
+  Iterator FindLast(Predicate predicate);
+  template<typename Predicate>
+  ConstIterator FindLast(Predicate predicate) const;
+
+  template<typename Predicate>
+  std::vector<Iterator> FindAll(Predicate predicate);
+  template<typename Predicate>
+  std::vector<ConstIterator> FindAll(Predicate predicate) const;
+
+  template<typename Predicate>
+  size_t CountIf(Predicate predicate) const;
+
+  template<typename Predicate>
+  size_t RemoveIf(Predicate predicate);
+
+  // Параллельные алгоритмы с теми же гарантиями, что у BiDirectionalList.
+  template<typename Policy, typename Function>
+  void ForEach(const Policy& policy, Function function);
+  template<typename Policy, typename Function>
+  std::vector<std::invoke_result_t<Function&, const T&>> Transform(
+      const Policy& policy, Function function) const;
+  template<typename Policy, typename U, typename BinaryOperation>
+  U Reduce(const Policy& policy, U init, BinaryOperation operation) const;
+  template<typename Policy, typename Predicate>
+  Iterator FindAny(const Policy& policy, Predicate predicate);
+  template<typename Policy, typename Predicate>
+  ConstIterator FindAny(const Policy& policy, Predicate predicate) const;
+
+  // Формат тот же, что у BiDirectionalList, так что списки можно
+  // сохранять одним классом и загружать другим.
+  void Save(std::ostream& stream) const;
+  void Load(std::istream& stream);
+  void Load(BiDirectionalListReader<T>& reader);
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  void Save(int fd) const;
+  void Load(int fd);
+#endif
+
+ private:
+  static constexpr uint32_t kNull = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t kBlockBits = 12;
+  static constexpr uint32_t kBlockSize = uint32_t(1) << kBlockBits;
+
+  // Значение живёт в объединении, чтобы у свободной ячейки оставались
+  // поля связей для списка свободных.
+  struct Slot {
+    Slot() {}
+    ~Slot() {}
+
+    union {
+      T value_;
+    };
+    uint32_t next_node_;
+    uint32_t previous_node_;
+  };
+
+  using SlotAllocator = typename std::allocator_traits<Allocator>::
+      template rebind_alloc<Slot>;
+  using SlotAllocatorTraits = std::allocator_traits<SlotAllocator>;
+  using BlockAllocator = typename std::allocator_traits<Allocator>::
+      template rebind_alloc<Slot*>;
+
+  SlotAllocator slot_allocator_;
+  std::vector<Slot*, BlockAllocator> blocks_;
+  uint32_t first_;
+  uint32_t last_;
+  uint32_t free_;
+  uint32_t used_;
+  size_t size_;
+
+  Slot& SlotAt(uint32_t index) const;
+
+  template<typename... Args>
+  uint32_t CreateNode(Args&&... args);
+  void DestroyNode(uint32_t index);
+  void AllocateBlock();
+  void ReleaseBlocks();
+
+  void LinkBefore(uint32_t position, uint32_t index);
+  void LinkAfter(uint32_t position, uint32_t index);
+  void Unlink(uint32_t index);
+  void Relink(uint32_t first);
+
+  uint32_t CutChain(uint32_t head, size_t count);
+  // Сливает left и right в конец цепочки *tail, продвигая все три
+  // аргумента, как BiDirectionalList::MergeChains.
+  template<typename Compare>
+  void MergeChains(uint32_t& left, uint32_t& right, uint32_t*& tail,
+                   Compare& compare);
+
+  template<typename Policy, typename SegmentFunction>
+  void RunSegments(const Policy& policy,
+                   SegmentFunction& segment_function) const;
+
+  void Save(ListByteSink& sink) const;
+};
+
+template<typename T, typename Allocator>
+T& CompactBiDirectionalList<T, Allocator>::Iterator::operator*() const {
+  return list_->SlotAt(index_).value_;
+}
+template<typename T, typename Allocator>
+T* CompactBiDirectionalList<T, Allocator>::Iterator::operator->() const {
+  return &list_->SlotAt(index_).value_;
+}
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::Iterator&
+    CompactBiDirectionalList<T, Allocator>::Iterator::operator++() {
+  if (index_ == kNull) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  index_ = list_->SlotAt(index_).next_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::Iterator::operator++(int) {
+  Iterator old = *this;
+  ++*this;
+  return old;
+}
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::Iterator&
+    CompactBiDirectionalList<T, Allocator>::Iterator::operator--() {
+  if (index_ == list_->first_) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  }
+  index_ = index_ == kNull ? list_->last_
+                           : list_->SlotAt(index_).previous_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::Iterator::operator--(int) {
+  Iterator old = *this;
+  --*this;
+  return old;
+}
+
+template<typename T, typename Allocator>
+bool CompactBiDirectionalList<T, Allocator>::Iterator::operator==(
+    const Iterator& other) const {
+  return index_ == other.index_;
+}
+template<typename T, typename Allocator>
+bool CompactBiDirectionalList<T, Allocator>::Iterator::operator!=(
+    const Iterator& other) const {
+  return index_ != other.index_;
+}
+
+template<typename T, typename Allocator>
+const T& CompactBiDirectionalList<T, Allocator>::ConstIterator::
+    operator*() const {
+  return list_->SlotAt(index_).value_;
+}
+template<typename T, typename Allocator>
+const T* CompactBiDirectionalList<T, Allocator>::ConstIterator::
+    operator->() const {
+  return &list_->SlotAt(index_).value_;
+}
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator&
+    CompactBiDirectionalList<T, Allocator>::ConstIterator::operator++() {
+  if (index_ == kNull) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  index_ = list_->SlotAt(index_).next_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::ConstIterator::operator++(int) {
+  ConstIterator old = *this;
+  ++*this;
+  return old;
+}
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator&
+    CompactBiDirectionalList<T, Allocator>::ConstIterator::operator--() {
+  if (index_ == list_->first_) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  }
+  index_ = index_ == kNull ? list_->last_
+                           : list_->SlotAt(index_).previous_node_;
+  return *this;
+}
+template<typename T, typename Allocator>
+const typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::ConstIterator::operator--(int) {
+  ConstIterator old = *this;
+  --*this;
+  return old;
+}
+
+template<typename T, typename Allocator>
+bool CompactBiDirectionalList<T, Allocator>::ConstIterator::operator==(
+    const ConstIterator& other) const {
+  return index_ == other.index_;
+}
+template<typename T, typename Allocator>
+bool CompactBiDirectionalList<T, Allocator>::ConstIterator::operator!=(
+    const ConstIterator& other) const {
+  return index_ != other.index_;
+}
+
+template<typename T, typename Allocator>
+CompactBiDirectionalList<T, Allocator>::CompactBiDirectionalList(
+    const CompactBiDirectionalList& other)
+    : CompactBiDirectionalList(std::allocator_traits<Allocator>::
+          select_on_container_copy_construction(other.GetAllocator())) {
+  try {
+    Reserve(other.size_);
+    for (const T& value : other) {
+      PushBack(value);
+    }
+  } catch (...) {
+    Clear();
+    throw;
+  }
+}
+template<typename T, typename Allocator>
+CompactBiDirectionalList<T, Allocator>::CompactBiDirectionalList(
+    CompactBiDirectionalList&& other) noexcept
+    : slot_allocator_(other.slot_allocator_),
+      blocks_(std::move(other.blocks_)), first_(other.first_),
+      last_(other.last_), free_(other.free_), used_(other.used_),
+      size_(other.size_) {
+  other.blocks_.clear();
+  other.first_ = other.last_ = other.free_ = kNull;
+  other.used_ = 0;
+  other.size_ = 0;
+}
+
+template<typename T, typename Allocator>
+CompactBiDirectionalList<T, Allocator>&
+    CompactBiDirectionalList<T, Allocator>::operator=(
+        const CompactBiDirectionalList& other) {
+  if (this == &other) {
+    return *this;
+  }
+  Clear();
+  Reserve(other.size_);
+  for (const T& value : other) {
+    PushBack(value);
+  }
+  return *this;
+}
+template<typename T, typename Allocator>
+CompactBiDirectionalList<T, Allocator>&
+    CompactBiDirectionalList<T, Allocator>::operator=(
+        CompactBiDirectionalList&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  Clear();
+  if (SlotAllocatorTraits::propagate_on_container_move_assignment::value ||
+      slot_allocator_ == other.slot_allocator_) {
+    if constexpr (SlotAllocatorTraits::
+        propagate_on_container_move_assignment::value) {
+      slot_allocator_ = other.slot_allocator_;
+    }
+    blocks_ = std::move(other.blocks_);
+    first_ = other.first_;
+    last_ = other.last_;
+    free_ = other.free_;
+    used_ = other.used_;
+    size_ = other.size_;
+    other.blocks_.clear();
+    other.first_ = other.last_ = other.free_ = kNull;
+    other.used_ = 0;
+    other.size_ = 0;
+  } else {
+    Reserve(other.size_);
+    for (T& value : other) {
+      PushBack(std::move(value));
+    }
+    other.Clear();
+  }
+  return *this;
+}
+
+template<typename T, typename Allocator>
+Allocator CompactBiDirectionalList<T, Allocator>::GetAllocator() const {
+  return Allocator(slot_allocator_);
+}
+
+template<typename T, typename Allocator>
+bool CompactBiDirectionalList<T, Allocator>::IsEmpty() const {
+  return size_ == 0;
+}
+
+template<typename T, typename Allocator>
+size_t CompactBiDirectionalList<T, Allocator>::Size() const {
+  return size_;
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Clear() {
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    for (uint32_t index = first_; index != kNull;
+         index = SlotAt(index).next_node_) {
+      std::destroy_at(&SlotAt(index).value_);
+    }
+  }
+  ReleaseBlocks();
+  first_ = last_ = free_ = kNull;
+  used_ = 0;
+  size_ = 0;
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Reserve(size_t count) {
+  while (blocks_.size() * size_t(kBlockSize) < count) {
+    AllocateBlock();
+  }
+}
+
+template<typename T, typename Allocator>
+size_t CompactBiDirectionalList<T, Allocator>::CapacityBytes() const {
+  return blocks_.size() * size_t(kBlockSize) * sizeof(Slot) +
+         blocks_.capacity() * sizeof(Slot*);
+}
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::begin() {
+  return Iterator(this, first_);
+}
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::end() {
+  return Iterator(this, kNull);
+}
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::begin() const {
+  return ConstIterator(this, first_);
+}
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::end() const {
+  return ConstIterator(this, kNull);
+}
+
+template<typename T, typename Allocator>
+std::vector<T> CompactBiDirectionalList<T, Allocator>::AsArray() const & {
+  std::vector<T> result;
+  result.reserve(size_);
+  CopyTo(std::back_inserter(result));
+  return result;
+}
+template<typename T, typename Allocator>
+std::vector<T> CompactBiDirectionalList<T, Allocator>::AsArray() && {
+  std::vector<T> result;
+  result.reserve(size_);
+  for (uint32_t index = first_; index != kNull;
+       index = SlotAt(index).next_node_) {
+    result.push_back(std::move(SlotAt(index).value_));
+  }
+  Clear();
+  return result;
+}
+
+template<typename T, typename Allocator>
+template<typename OutputIt>
+  requires std::output_iterator<OutputIt, const T&>
+OutputIt CompactBiDirectionalList<T, Allocator>::CopyTo(
+    OutputIt destination) const {
+  for (uint32_t index = first_; index != kNull;) {
+    const Slot& slot = SlotAt(index);
+    *destination = slot.value_;
+    ++destination;
+    index = slot.next_node_;
+  }
+  return destination;
+}
+template<typename T, typename Allocator>
+size_t CompactBiDirectionalList<T, Allocator>::CopyTo(
+    std::span<T> destination) const {
+  if (destination.size() < size_) {
+    throw std::runtime_error("Impossible to copy list into smaller buffer");
+  }
+  CopyTo(destination.begin());
+  return size_;
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::InsertBefore(Iterator position,
+                                                          const T& value) {
+  EmplaceBefore(position, value);
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::InsertBefore(Iterator position,
+                                                          T&& value) {
+  EmplaceBefore(position, std::move(value));
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::InsertAfter(Iterator position,
+                                                         const T& value) {
+  EmplaceAfter(position, value);
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::InsertAfter(Iterator position,
+                                                         T&& value) {
+  EmplaceAfter(position, std::move(value));
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::PushBack(const T& value) {
+  EmplaceBack(value);
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::PushBack(T&& value) {
+  EmplaceBack(std::move(value));
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::PushFront(const T& value) {
+  EmplaceFront(value);
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::PushFront(T&& value) {
+  EmplaceFront(std::move(value));
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::EmplaceBefore(
+        Iterator position, Args&&... args) {
+  uint32_t index = CreateNode(std::forward<Args>(args)...);
+  LinkBefore(position.index_, index);
+  return Iterator(this, index);
+}
+template<typename T, typename Allocator>
+template<typename... Args>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::EmplaceAfter(
+        Iterator position, Args&&... args) {
+  if (position.index_ == kNull && !IsEmpty()) {
+    throw std::runtime_error("Impossible to insert after end");
+  }
+  uint32_t index = CreateNode(std::forward<Args>(args)...);
+  LinkAfter(position.index_, index);
+  return Iterator(this, index);
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::EmplaceBack(Args&&... args) {
+  return EmplaceBefore(end(), std::forward<Args>(args)...);
+}
+template<typename T, typename Allocator>
+template<typename... Args>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::EmplaceFront(Args&&... args) {
+  return EmplaceBefore(begin(), std::forward<Args>(args)...);
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Erase(Iterator position) {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  if (position.index_ == kNull) {
+    throw std::runtime_error("Impossible to delete end");
+  }
+  Unlink(position.index_);
+  DestroyNode(position.index_);
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::PopFront() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase(begin());
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::PopBack() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase(Iterator(this, last_));
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Sort() {
+  Sort(std::less<T>());
+}
+template<typename T, typename Allocator>
+template<typename Compare>
+void CompactBiDirectionalList<T, Allocator>::Sort(Compare compare) {
+  if (size_ < 2) {
+    return;
+  }
+  // Как и в BiDirectionalList::Sort, на время сортировки цепочка
+  // односвязная, а при исключении из compare куски сшиваются обратно.
+  uint32_t merged = first_;
+  uint32_t* tail = nullptr;
+  uint32_t left = kNull;
+  uint32_t right = kNull;
+  uint32_t rest = kNull;
+  try {
+    for (size_t width = 1; width < size_; width *= 2) {
+      rest = merged;
+      merged = kNull;
+      tail = &merged;
+      while (rest != kNull) {
+        left = rest;
+        right = CutChain(left, width);
+        rest = CutChain(right, width);
+        MergeChains(left, right, tail, compare);
+      }
+    }
+  } catch (...) {
+    for (uint32_t chain : {left, right, rest}) {
+      *tail = chain;
+      while (*tail != kNull) {
+        tail = &SlotAt(*tail).next_node_;
+      }
+    }
+    Relink(merged);
+    throw;
+  }
+  Relink(merged);
+}
+
+template<typename T, typename Allocator>
+size_t CompactBiDirectionalList<T, Allocator>::Unique() {
+  return Unique(std::equal_to<T>());
+}
+template<typename T, typename Allocator>
+template<typename BinaryPredicate>
+size_t CompactBiDirectionalList<T, Allocator>::Unique(
+    BinaryPredicate predicate) {
+  size_t removed = 0;
+  if (first_ == kNull) {
+    return removed;
+  }
+  uint32_t index = first_;
+  while (SlotAt(index).next_node_ != kNull) {
+    uint32_t next = SlotAt(index).next_node_;
+    if (predicate(std::as_const(SlotAt(index).value_),
+                  std::as_const(SlotAt(next).value_))) {
+      Unlink(next);
+      DestroyNode(next);
+      ++removed;
+    } else {
+      index = next;
+    }
+  }
+  return removed;
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Reverse() {
+  for (uint32_t index = first_; index != kNull;) {
+    Slot& slot = SlotAt(index);
+    std::swap(slot.next_node_, slot.previous_node_);
+    index = slot.previous_node_;
+  }
+  std::swap(first_, last_);
+}
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::Find(const T& value) {
+  return Find([&value](const T& element) { return element == value; });
+}
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::Find(const T& value) const {
+  return Find([&value](const T& element) { return element == value; });
+}
+
+template<typename T, typename Allocator>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::Find(Predicate predicate) {
+  return Iterator(this, std::as_const(*this).Find(std::move(predicate))
+                            .index_);
+}
+template<typename T, typename Allocator>
+template<typename Predicate>
+  requires std::is_invocable_r_v<bool, Predicate&, const T&>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::Find(Predicate predicate) const {
+  for (uint32_t index = first_; index != kNull;) {
+    const Slot& slot = SlotAt(index);
+    if (predicate(slot.value_)) {
+      return ConstIterator(this, index);
+    }
+    index = slot.next_node_;
+  }
+  return end();
+}
+
+template<typename T, typename Allocator>
+template<typename Predicate>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::FindLast(Predicate predicate) {
+  return Iterator(this, std::as_const(*this).FindLast(std::move(predicate))
+                            .index_);
+}
+template<typename T, typename Allocator>
+template<typename Predicate>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::FindLast(
+        Predicate predicate) const {
+  for (uint32_t index = last_; index != kNull;) {
+    const Slot& slot = SlotAt(index);
+    if (predicate(slot.value_)) {
+      return ConstIterator(this, index);
+    }
+    index = slot.previous_node_;
+  }
+  return end();
+}
+
+template<typename T, typename Allocator>
+template<typename Predicate>
+std::vector<typename CompactBiDirectionalList<T, Allocator>::Iterator>
+    CompactBiDirectionalList<T, Allocator>::FindAll(Predicate predicate) {
+  std::vector<Iterator> found;
+  for (uint32_t index = first_; index != kNull;) {
+    const Slot& slot = SlotAt(index);
+    if (predicate(slot.value_)) {
+      found.push_back(Iterator(this, index));
+    }
+    index = slot.next_node_;
+  }
+  return found;
+}
+template<typename T, typename Allocator>
+template<typename Predicate>
+std::vector<typename CompactBiDirectionalList<T, Allocator>::ConstIterator>
+    CompactBiDirectionalList<T, Allocator>::FindAll(
+        Predicate predicate) const {
+  std::vector<ConstIterator> found;
+  for (uint32_t index = first_; index != kNull;) {
+    const Slot& slot = SlotAt(index);
+    if (predicate(slot.value_)) {
+      found.push_back(ConstIterator(this, index));
+    }
+    index = slot.next_node_;
+  }
+  return found;
+}
+
+template<typename T, typename Allocator>
+template<typename Predicate>
+size_t CompactBiDirectionalList<T, Allocator>::CountIf(
+    Predicate predicate) const {
+  size_t count = 0;
+  for (uint32_t index = first_; index != kNull;) {
+    const Slot& slot = SlotAt(index);
+    if (predicate(slot.value_)) {
+      ++count;
+    }
+    index = slot.next_node_;
+  }
+  return count;
+}
+
+template<typename T, typename Allocator>
+template<typename Predicate>
+size_t CompactBiDirectionalList<T, Allocator>::RemoveIf(Predicate predicate) {
+  size_t removed = 0;
+  for (uint32_t index = first_; index != kNull;) {
+    uint32_t next = SlotAt(index).next_node_;
+    if (predicate(std::as_const(SlotAt(index).value_))) {
+      Unlink(index);
+      DestroyNode(index);
+      ++removed;
+    }
+    index = next;
+  }
+  return removed;
+}
+
+template<typename T, typename Allocator>
+template<typename Policy, typename Function>
+void CompactBiDirectionalList<T, Allocator>::ForEach(const Policy& policy,
+                                                     Function function) {
+  auto segment_function = [this, &function](size_t, uint32_t index,
+                                            size_t count) {
+    for (; count > 0; --count, index = SlotAt(index).next_node_) {
+      function(SlotAt(index).value_);
+    }
+    return true;
+  };
+  RunSegments(policy, segment_function);
+}
+
+template<typename T, typename Allocator>
+template<typename Policy, typename Function>
+std::vector<std::invoke_result_t<Function&, const T&>>
+    CompactBiDirectionalList<T, Allocator>::Transform(
+        const Policy& policy, Function function) const {
+  using Result = std::invoke_result_t<Function&, const T&>;
+  std::vector<std::vector<Result>> segments(
+      (size_ + std::max<size_t>(policy.grain_, 1) - 1) /
+      std::max<size_t>(policy.grain_, 1));
+  auto segment_function = [&](size_t segment_index, uint32_t index,
+                              size_t count) {
+    std::vector<Result>& segment = segments[segment_index];
+    segment.reserve(count);
+    for (; count > 0; --count, index = SlotAt(index).next_node_) {
+      segment.push_back(function(std::as_const(SlotAt(index).value_)));
+    }
+    return true;
+  };
+  RunSegments(policy, segment_function);
+  std::vector<Result> result;
+  result.reserve(size_);
+  for (std::vector<Result>& segment : segments) {
+    std::move(segment.begin(), segment.end(), std::back_inserter(result));
+  }
+  return result;
+}
+
+template<typename T, typename Allocator>
+template<typename Policy, typename U, typename BinaryOperation>
+U CompactBiDirectionalList<T, Allocator>::Reduce(
+    const Policy& policy, U init, BinaryOperation operation) const {
+  std::vector<std::optional<U>> partials(
+      (size_ + std::max<size_t>(policy.grain_, 1) - 1) /
+      std::max<size_t>(policy.grain_, 1));
+  auto segment_function = [&](size_t segment_index, uint32_t index,
+                              size_t count) {
+    U partial(SlotAt(index).value_);
+    for (index = SlotAt(index).next_node_, --count; count > 0;
+         --count, index = SlotAt(index).next_node_) {
+      partial = operation(std::move(partial), U(SlotAt(index).value_));
+    }
+    partials[segment_index].emplace(std::move(partial));
+    return true;
+  };
+  RunSegments(policy, segment_function);
+  for (std::optional<U>& partial : partials) {
+    init = operation(std::move(init), std::move(*partial));
+  }
+  return init;
+}
+
+template<typename T, typename Allocator>
+template<typename Policy, typename Predicate>
+typename CompactBiDirectionalList<T, Allocator>::Iterator
+    CompactBiDirectionalList<T, Allocator>::FindAny(const Policy& policy,
+                                                    Predicate predicate) {
+  return Iterator(this, std::as_const(*this).FindAny(
+      policy, std::move(predicate)).index_);
+}
+template<typename T, typename Allocator>
+template<typename Policy, typename Predicate>
+typename CompactBiDirectionalList<T, Allocator>::ConstIterator
+    CompactBiDirectionalList<T, Allocator>::FindAny(
+        const Policy& policy, Predicate predicate) const {
+  std::atomic<uint32_t> found(kNull);
+  auto segment_function = [&](size_t, uint32_t index, size_t count) {
+    for (; count > 0; --count, index = SlotAt(index).next_node_) {
+      if (predicate(std::as_const(SlotAt(index).value_))) {
+        found.store(index, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    return found.load(std::memory_order_relaxed) == kNull;
+  };
+  RunSegments(policy, segment_function);
+  return ConstIterator(this, found.load());
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Save(
+    std::ostream& stream) const {
+  ListByteSink sink(stream);
+  Save(sink);
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Load(std::istream& stream) {
+  BiDirectionalListReader<T> reader(stream);
+  Load(reader);
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Load(
+    BiDirectionalListReader<T>& reader) {
+  // Размеру из заголовка не доверяем и заранее ничего не резервируем:
+  // блоки выделяются по мере прихода прочитанных элементов.
+  CompactBiDirectionalList loaded(GetAllocator());
+  while (reader.ReadChunk([&loaded](T&& value) {
+    loaded.PushBack(std::move(value));
+  })) {}
+  *this = std::move(loaded);
+}
+#ifdef BIDIRECTIONAL_LIST_POSIX
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Save(int fd) const {
+  ListByteSink sink(fd);
+  Save(sink);
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Load(int fd) {
+  BiDirectionalListReader<T> reader(fd);
+  Load(reader);
+}
+#endif
+
+template<typename T, typename Allocator>
+typename CompactBiDirectionalList<T, Allocator>::Slot&
+    CompactBiDirectionalList<T, Allocator>::SlotAt(uint32_t index) const {
+  return blocks_[index >> kBlockBits][index & (kBlockSize - 1)];
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+uint32_t CompactBiDirectionalList<T, Allocator>::CreateNode(Args&&... args) {
+  uint32_t index = free_;
+  if (index == kNull) {
+    if (used_ == kNull) {
+      throw std::runtime_error("Impossible to index more than 2^32 - 1 nodes");
+    }
+    if (used_ == blocks_.size() * size_t(kBlockSize)) {
+      AllocateBlock();
+    }
+    index = used_;
+  }
+  Slot& slot = SlotAt(index);
+  std::construct_at(&slot.value_, std::forward<Args>(args)...);
+  if (index == free_) {
+    free_ = slot.next_node_;
+  } else {
+    ++used_;
+  }
+  slot.next_node_ = slot.previous_node_ = kNull;
+  return index;
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::DestroyNode(uint32_t index) {
+  Slot& slot = SlotAt(index);
+  std::destroy_at(&slot.value_);
+  slot.next_node_ = free_;
+  free_ = index;
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::AllocateBlock() {
+  if (blocks_.size() == blocks_.capacity()) {
+    blocks_.reserve(std::max<size_t>(2 * blocks_.size(), 16));
+  }
+  Slot* block = SlotAllocatorTraits::allocate(slot_allocator_, kBlockSize);
+  for (uint32_t i = 0; i < kBlockSize; ++i) {
+    SlotAllocatorTraits::construct(slot_allocator_, block + i);
+  }
+  blocks_.push_back(block);
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::ReleaseBlocks() {
+  for (Slot* block : blocks_) {
+    for (uint32_t i = 0; i < kBlockSize; ++i) {
+      SlotAllocatorTraits::destroy(slot_allocator_, block + i);
+    }
+    SlotAllocatorTraits::deallocate(slot_allocator_, block, kBlockSize);
+  }
+  blocks_.clear();
+  blocks_.shrink_to_fit();
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::LinkBefore(uint32_t position,
+                                                        uint32_t index) {
+  uint32_t previous = position == kNull ? last_
+                                        : SlotAt(position).previous_node_;
+  Slot& slot = SlotAt(index);
+  slot.next_node_ = position;
+  slot.previous_node_ = previous;
+  if (previous == kNull) {
+    first_ = index;
+  } else {
+    SlotAt(previous).next_node_ = index;
+  }
+  if (position == kNull) {
+    last_ = index;
+  } else {
+    SlotAt(position).previous_node_ = index;
+  }
+  ++size_;
+}
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::LinkAfter(uint32_t position,
+                                                       uint32_t index) {
+  LinkBefore(position == kNull ? kNull : SlotAt(position).next_node_, index);
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Unlink(uint32_t index) {
+  Slot& slot = SlotAt(index);
+  if (slot.previous_node_ == kNull) {
+    first_ = slot.next_node_;
+  } else {
+    SlotAt(slot.previous_node_).next_node_ = slot.next_node_;
+  }
+  if (slot.next_node_ == kNull) {
+    last_ = slot.previous_node_;
+  } else {
+    SlotAt(slot.next_node_).previous_node_ = slot.previous_node_;
+  }
+  --size_;
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Relink(uint32_t first) {
+  uint32_t previous = kNull;
+  for (uint32_t index = first; index != kNull;
+       index = SlotAt(index).next_node_) {
+    SlotAt(index).previous_node_ = previous;
+    previous = index;
+  }
+  first_ = first;
+  last_ = previous;
+}
+
+template<typename T, typename Allocator>
+uint32_t CompactBiDirectionalList<T, Allocator>::CutChain(uint32_t head,
+                                                          size_t count) {
+  for (size_t i = 1; head != kNull && i < count; i++) {
+    head = SlotAt(head).next_node_;
+  }
+  if (head == kNull) {
+    return kNull;
+  }
+  uint32_t rest = SlotAt(head).next_node_;
+  SlotAt(head).next_node_ = kNull;
+  return rest;
+}
+template<typename T, typename Allocator>
+template<typename Compare>
+void CompactBiDirectionalList<T, Allocator>::MergeChains(
+    uint32_t& left, uint32_t& right, uint32_t*& tail, Compare& compare) {
+  while (left != kNull && right != kNull) {
+    const Slot& left_slot = SlotAt(left);
+    const Slot& right_slot = SlotAt(right);
+    if (compare(std::as_const(right_slot.value_),
+                std::as_const(left_slot.value_))) {
+      *tail = right;
+      right = right_slot.next_node_;
+    } else {
+      *tail = left;
+      left = left_slot.next_node_;
+    }
+    tail = &SlotAt(*tail).next_node_;
+  }
+  *tail = left != kNull ? left : right;
+  left = right = kNull;
+  while (*tail != kNull) {
+    tail = &SlotAt(*tail).next_node_;
+  }
+}
+
+template<typename T, typename Allocator>
+template<typename Policy, typename SegmentFunction>
+void CompactBiDirectionalList<T, Allocator>::RunSegments(
+    const Policy& policy, SegmentFunction& segment_function) const {
+  size_t grain = std::max<size_t>(policy.grain_, 1);
+  std::vector<uint32_t> starts;
+  starts.reserve((size_ + grain - 1) / grain);
+  size_t position = 0;
+  for (uint32_t index = first_; index != kNull;
+       index = SlotAt(index).next_node_, ++position) {
+    if (position % grain == 0) {
+      starts.push_back(index);
+    }
+  }
+  auto run = [&](size_t segment) {
+    return segment_function(segment, starts[segment],
+                            std::min(grain, size_ - segment * grain));
+  };
+  RunListSegments(policy, starts.size(), run);
+}
+
+template<typename T, typename Allocator>
+void CompactBiDirectionalList<T, Allocator>::Save(ListByteSink& sink) const {
+  SaveList<T>(sink, size_, [this](auto& encode) {
+    for (uint32_t index = first_; index != kNull;) {
+      const Slot& slot = SlotAt(index);
+      encode(slot.value_);
+      index = slot.next_node_;
+    }
+  });
+}
+
+#ifdef BIDIRECTIONAL_LIST_MMAP
+// Список, узлы которого лежат в отображённом в память файле, а связи хранятся
+// смещениями от начала файла (0 -- нет узла). Поэтому сохранённый список
+// открывается за O(1) и сразу доступен для обхода, без пересборки.
+//
+// Надёжно сохраняется только то, что записано вызовом Sync(). У каждого узла
+// два набора связей с номерами поколений; изменения текущего поколения
+// пишутся в набор, не используемый последним сохранённым поколением, а
+// освобождённые узлы не переиспользуются до Sync(). Sync() сбрасывает данные
+// на диск и только затем записывает в заголовок новый корень -- один из двух,
+// с контрольной суммой. При открытии берётся корректный корень старшего
+// поколения; если прошлый процесс завершился с несохранёнными изменениями,
+// они вычищаются проходом по файлу. Значения хранятся побайтово, поэтому T
+// должен быть тривиально копируемым. Изменять элементы через итераторы
+// нельзя, есть только ConstIterator.
+template<typename T>
+class PersistentBiDirectionalList {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "PersistentBiDirectionalList stores values as raw bytes");
+
+ public:
+  class ConstIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const T& operator*() const;
+    const T* operator->() const;
+
+    ConstIterator& operator++();
+    const ConstIterator operator++(int);
+
+    ConstIterator& operator--();
+    const ConstIterator operator--(int);
+
+    bool operator==(const ConstIterator& other) const;
+    bool operator!=(const ConstIterator& other) const;
+
+   private:
+    friend class PersistentBiDirectionalList;
+
+    const PersistentBiDirectionalList* list_;
+    uint64_t offset_;
+
+    ConstIterator(const PersistentBiDirectionalList* list, uint64_t offset)
+        : list_(list), offset_(offset) {}
+  };
+
+  // Открывает файл или создаёт пустой список, если файла нет.
+  explicit PersistentBiDirectionalList(const std::string& path);
+
+  PersistentBiDirectionalList(const PersistentBiDirectionalList&) = delete;
+  PersistentBiDirectionalList& operator=(
+      const PersistentBiDirectionalList&) = delete;
+
+  // Несохранённые изменения будут отброшены при следующем открытии.
+  ~PersistentBiDirectionalList();
+
+  bool IsEmpty() const;
+  size_t Size() const;
+
+  void Clear();
+
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  std::vector<T> AsArray() const;
+
+  void InsertBefore(ConstIterator position, const T& value);
+  void InsertAfter(ConstIterator position, const T& value);
+
+  void PushBack(const T& value);
+  void PushFront(const T& value);
+
+  void Erase(ConstIterator position);
+
+  void PopFront();
+  void PopBack();
+
+  ConstIterator Find(const T& value) const;
+  template<typename Predicate>
+  ConstIterator Find(Predicate predicate) const;
+
+  // Делает текущее состояние сохранённым поколением.
+  void Sync();
+  uint64_t SyncedGeneration() const;
+
+ private:
+  static constexpr uint64_t kMagic = 0x315453494c494442;  // "BDILIST1"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint64_t kDataOffset = 4096;
+  static constexpr uint64_t kInitialFileSize = 1 << 20;
+
+  struct Links {
+    uint64_t generation_;
+    uint64_t next_node_;
+    uint64_t previous_node_;
+  };
+
+  struct Node {
+    Links links_[2];
+    T value_;
+  };
+
+  struct Root {
+    uint64_t generation_;
+    uint64_t first_;
+    uint64_t last_;
+    uint64_t size_;
+    uint64_t free_;
+    uint64_t end_;
+    uint64_t checksum_;
+  };
+
+  struct Header {
+    uint64_t magic_;
+    uint32_t version_;
+    uint32_t node_size_;
+    uint64_t value_size_;
+    // Поколение, которое начал изменять последний открывший файл процесс.
+    // Если оно старше сохранённого, в файле могут остаться его связи.
+    uint64_t open_generation_;
+    Root roots_[2];
+  };
+  static_assert(sizeof(Header) <= kDataOffset);
+
+  int fd_;
+  char* base_;
+  size_t mapped_size_;
+  // Состояние текущего, ещё не сохранённого поколения.
+  Root root_;
+  size_t synced_root_;
+  std::vector<uint64_t> pending_free_;
+  bool dirty_;
+
+  Header* GetHeader() const;
+  Node* NodeAt(uint64_t offset) const;
+
+  const Links& CurrentLinks(uint64_t offset) const;
+  Links& WritableLinks(uint64_t offset);
+  uint64_t Next(uint64_t offset) const;
+  uint64_t Previous(uint64_t offset) const;
+
+  uint64_t CreateNode(const T& value);
+  void LinkBefore(uint64_t position, uint64_t offset);
+  void Unlink(uint64_t offset);
+
+  void MarkDirty();
+  void Map(size_t size);
+  void Unmap();
+  void Grow(size_t size);
+  void Initialize();
+  void Recover();
+  void SyncRange(size_t offset, size_t length);
+
+  static uint64_t Checksum(const Root& root);
+};
+
+template<typename T>
+const T& PersistentBiDirectionalList<T>::ConstIterator::operator*() const {
+  return list_->NodeAt(offset_)->value_;
+}
+template<typename T>
+const T* PersistentBiDirectionalList<T>::ConstIterator::operator->() const {
+  return &list_->NodeAt(offset_)->value_;
+}
+
+template<typename T>
+typename PersistentBiDirectionalList<T>::ConstIterator&
+    PersistentBiDirectionalList<T>::ConstIterator::operator++() {
+  if (offset_ == 0) {
+    throw std::runtime_error("Impossible to increase iterator");
+  }
+  offset_ = list_->Next(offset_);
+  return *this;
+}
+template<typename T>
+const typename PersistentBiDirectionalList<T>::ConstIterator
+    PersistentBiDirectionalList<T>::ConstIterator::operator++(int) {
+  ConstIterator old = *this;
+  ++*this;
+  return old;
+}
+
+template<typename T>
+typename PersistentBiDirectionalList<T>::ConstIterator&
+    PersistentBiDirectionalList<T>::ConstIterator::operator--() {
+  if (offset_ == list_->root_.first_) {
+    throw std::runtime_error("Impossible to reduce iterator");
+  }
+  offset_ = offset_ == 0 ? list_->root_.last_ : list_->Previous(offset_);
+  return *this;
+}
+template<typename T>
+const typename PersistentBiDirectionalList<T>::ConstIterator
+    PersistentBiDirectionalList<T>::ConstIterator::operator--(int) {
+  ConstIterator old = *this;
+  --*this;
+  return old;
+}
+
+template<typename T>
+bool PersistentBiDirectionalList<T>::ConstIterator::operator==(
+    const ConstIterator& other) const {
+  return offset_ == other.offset_;
+}
+template<typename T>
+bool PersistentBiDirectionalList<T>::ConstIterator::operator!=(
+    const ConstIterator& other) const {
+  return offset_ != other.offset_;
+}
+
+template<typename T>
+PersistentBiDirectionalList<T>::PersistentBiDirectionalList(
+    const std::string& path)
+    : fd_(-1), base_(nullptr), mapped_size_(0), root_(), synced_root_(0),
+      dirty_(false) {
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("Impossible to open persistent list file");
+  }
+  try {
+    struct stat file_stat;
+    if (fstat(fd_, &file_stat) != 0) {
+      throw std::runtime_error("Impossible to open persistent list file");
+    }
+    if (file_stat.st_size == 0) {
+      Initialize();
+    } else if (static_cast<uint64_t>(file_stat.st_size) < kDataOffset) {
+      throw std::runtime_error("Impossible to open truncated list file");
+    } else {
+      Map(static_cast<size_t>(file_stat.st_size));
+    }
+
+    Header* header = GetHeader();
+    if (header->magic_ != kMagic || header->version_ != kVersion ||
+        header->node_size_ != sizeof(Node) ||
+        header->value_size_ != sizeof(T)) {
+      throw std::runtime_error("Impossible to open list of another format");
+    }
+    bool valid[2];
+    for (size_t i = 0; i < 2; ++i) {
+      const Root& root = header->roots_[i];
+      valid[i] = root.checksum_ == Checksum(root) && root.generation_ > 0 &&
+                 root.end_ >= kDataOffset && root.end_ <= mapped_size_;
+    }
+    if (!valid[0] && !valid[1]) {
+      throw std::runtime_error("Impossible to open list without valid root");
+    }
+    synced_root_ = !valid[0] || (valid[1] && header->roots_[1].generation_ >
+                                 header->roots_[0].generation_);
+    root_ = header->roots_[synced_root_];
+    if (header->open_generation_ > root_.generation_) {
+      Recover();
+    }
+    ++root_.generation_;
+  } catch (...) {
+    Unmap();
+    close(fd_);
+    throw;
+  }
+}
+
+template<typename T>
+PersistentBiDirectionalList<T>::~PersistentBiDirectionalList() {
+  Unmap();
+  close(fd_);
+}
+
+template<typename T>
+bool PersistentBiDirectionalList<T>::IsEmpty() const {
+  return root_.size_ == 0;
+}
+
+template<typename T>
+size_t PersistentBiDirectionalList<T>::Size() const {
+  return root_.size_;
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Clear() {
+  if (IsEmpty()) {
+    return;
+  }
+  MarkDirty();
+  for (uint64_t offset = root_.first_; offset != 0; offset = Next(offset)) {
+    pending_free_.push_back(offset);
+  }
+  root_.first_ = root_.last_ = 0;
+  root_.size_ = 0;
+}
+
+template<typename T>
+typename PersistentBiDirectionalList<T>::ConstIterator
+    PersistentBiDirectionalList<T>::begin() const {
+  return ConstIterator(this, root_.first_);
+}
+template<typename T>
+typename PersistentBiDirectionalList<T>::ConstIterator
+    PersistentBiDirectionalList<T>::end() const {
+  return ConstIterator(this, 0);
+}
+
+template<typename T>
+std::vector<T> PersistentBiDirectionalList<T>::AsArray() const {
+  std::vector<T> result;
+  result.reserve(Size());
+  for (uint64_t offset = root_.first_; offset != 0; offset = Next(offset)) {
+    result.push_back(NodeAt(offset)->value_);
+  }
+  return result;
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::InsertBefore(ConstIterator position,
+                                                  const T& value) {
+  MarkDirty();
+  LinkBefore(position.offset_, CreateNode(value));
+}
+template<typename T>
+void PersistentBiDirectionalList<T>::InsertAfter(ConstIterator position,
+                                                 const T& value) {
+  if (position.offset_ == 0 && !IsEmpty()) {
+    throw std::runtime_error("Impossible to insert after end");
+  }
+  MarkDirty();
+  uint64_t offset = CreateNode(value);
+  LinkBefore(position.offset_ == 0 ? 0 : Next(position.offset_), offset);
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::PushBack(const T& value) {
+  InsertBefore(end(), value);
+}
+template<typename T>
+void PersistentBiDirectionalList<T>::PushFront(const T& value) {
+  InsertBefore(begin(), value);
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Erase(ConstIterator position) {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  if (position.offset_ == 0) {
+    throw std::runtime_error("Impossible to delete end");
+  }
+  MarkDirty();
+  Unlink(position.offset_);
+  pending_free_.push_back(position.offset_);
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::PopFront() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase(begin());
+}
+template<typename T>
+void PersistentBiDirectionalList<T>::PopBack() {
+  if (IsEmpty()) {
+    throw std::runtime_error("Impossible to delete element from empty list");
+  }
+  Erase(ConstIterator(this, root_.last_));
+}
+
+template<typename T>
+typename PersistentBiDirectionalList<T>::ConstIterator
+    PersistentBiDirectionalList<T>::Find(const T& value) const {
+  return Find([&value](const T& element) { return element == value; });
+}
+template<typename T>
+template<typename Predicate>
+typename PersistentBiDirectionalList<T>::ConstIterator
+    PersistentBiDirectionalList<T>::Find(Predicate predicate) const {
+  for (uint64_t offset = root_.first_; offset != 0; offset = Next(offset)) {
+    if (predicate(std::as_const(NodeAt(offset)->value_))) {
+      return ConstIterator(this, offset);
+    }
+  }
+  return end();
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Sync() {
+  if (!dirty_) {
+    return;
+  }
+  // Узлы, освобождённые в этом поколении, ещё заняты в сохранённом, поэтому
+  // в список свободных они попадают только вместе с новым корнем.
+  for (uint64_t offset : pending_free_) {
+    WritableLinks(offset).next_node_ = root_.free_;
+    root_.free_ = offset;
+  }
+  pending_free_.clear();
+  SyncRange(kDataOffset, mapped_size_ - kDataOffset);
+  if (fdatasync(fd_) != 0) {
+    throw std::runtime_error("Impossible to sync persistent list file");
+  }
+
+  Root root = root_;
+  root.checksum_ = Checksum(root);
+  synced_root_ = 1 - synced_root_;
+  GetHeader()->roots_[synced_root_] = root;
+  SyncRange(0, kDataOffset);
+  ++root_.generation_;
+  dirty_ = false;
+}
+
+template<typename T>
+uint64_t PersistentBiDirectionalList<T>::SyncedGeneration() const {
+  return GetHeader()->roots_[synced_root_].generation_;
+}
+
+template<typename T>
+typename PersistentBiDirectionalList<T>::Header*
+    PersistentBiDirectionalList<T>::GetHeader() const {
+  return reinterpret_cast<Header*>(base_);
+}
+
+template<typename T>
+typename PersistentBiDirectionalList<T>::Node*
+    PersistentBiDirectionalList<T>::NodeAt(uint64_t offset) const {
+  return reinterpret_cast<Node*>(base_ + offset);
+}
+
+// После открытия в файле нет связей поколений старше текущего, поэтому
+// актуален набор со старшим поколением.
+template<typename T>
+const typename PersistentBiDirectionalList<T>::Links&
+    PersistentBiDirectionalList<T>::CurrentLinks(uint64_t offset) const {
+  const Links* links = NodeAt(offset)->links_;
+  return links[links[1].generation_ > links[0].generation_];
+}
+template<typename T>
+typename PersistentBiDirectionalList<T>::Links&
+    PersistentBiDirectionalList<T>::WritableLinks(uint64_t offset) {
+  Links* links = NodeAt(offset)->links_;
+  size_t current = links[1].generation_ > links[0].generation_;
+  if (links[current].generation_ != root_.generation_) {
+    links[1 - current] = links[current];
+    links[1 - current].generation_ = root_.generation_;
+    current = 1 - current;
+  }
+  return links[current];
+}
+
+template<typename T>
+uint64_t PersistentBiDirectionalList<T>::Next(uint64_t offset) const {
+  return CurrentLinks(offset).next_node_;
+}
+template<typename T>
+uint64_t PersistentBiDirectionalList<T>::Previous(uint64_t offset) const {
+  return CurrentLinks(offset).previous_node_;
+}
+
+template<typename T>
+uint64_t PersistentBiDirectionalList<T>::CreateNode(const T& value) {
+  uint64_t offset;
+  if (root_.free_ != 0) {
+    offset = root_.free_;
+    root_.free_ = Next(offset);
+  } else {
+    if (root_.end_ + sizeof(Node) > mapped_size_) {
+      Grow(root_.end_ + sizeof(Node));
+    }
+    offset = root_.end_;
+    root_.end_ += sizeof(Node);
+    std::memset(NodeAt(offset)->links_, 0, sizeof(Node::links_));
+  }
+  std::memcpy(static_cast<void*>(&NodeAt(offset)->value_), &value,
+              sizeof(T));
+  Links& links = WritableLinks(offset);
+  links.next_node_ = links.previous_node_ = 0;
+  return offset;
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::LinkBefore(uint64_t position,
+                                                uint64_t offset) {
+  uint64_t previous = position == 0 ? root_.last_ : Previous(position);
+  Links& links = WritableLinks(offset);
+  links.next_node_ = position;
+  links.previous_node_ = previous;
+  if (previous == 0) {
+    root_.first_ = offset;
+  } else {
+    WritableLinks(previous).next_node_ = offset;
+  }
+  if (position == 0) {
+    root_.last_ = offset;
+  } else {
+    WritableLinks(position).previous_node_ = offset;
+  }
+  ++root_.size_;
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Unlink(uint64_t offset) {
+  Links links = CurrentLinks(offset);
+  if (links.previous_node_ == 0) {
+    root_.first_ = links.next_node_;
+  } else {
+    WritableLinks(links.previous_node_).next_node_ = links.next_node_;
+  }
+  if (links.next_node_ == 0) {
+    root_.last_ = links.previous_node_;
+  } else {
+    WritableLinks(links.next_node_).previous_node_ = links.previous_node_;
+  }
+  --root_.size_;
+}
+
+// Перед первой записью поколения оно отмечается в заголовке, чтобы после
+// сбоя следующий процесс знал, что в файле могут быть несохранённые связи.
+template<typename T>
+void PersistentBiDirectionalList<T>::MarkDirty() {
+  if (dirty_) {
+    return;
+  }
+  GetHeader()->open_generation_ = root_.generation_;
+  SyncRange(0, kDataOffset);
+  dirty_ = true;
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Map(size_t size) {
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       fd_, 0);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("Impossible to map persistent list file");
+  }
+  base_ = static_cast<char*>(address);
+  mapped_size_ = size;
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Unmap() {
+  if (base_ != nullptr) {
+    munmap(base_, mapped_size_);
+    base_ = nullptr;
+    mapped_size_ = 0;
+  }
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Grow(size_t size) {
+  size_t new_size = std::max(mapped_size_ * 2, size);
+  if (ftruncate(fd_, static_cast<off_t>(new_size)) != 0) {
+    throw std::runtime_error("Impossible to grow persistent list file");
+  }
+  Unmap();
+  Map(new_size);
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::Initialize() {
+  if (ftruncate(fd_, static_cast<off_t>(kInitialFileSize)) != 0) {
+    throw std::runtime_error("Impossible to grow persistent list file");
+  }
+  Map(kInitialFileSize);
+  Header* header = GetHeader();
+  header->magic_ = kMagic;
+  header->version_ = kVersion;
+  header->node_size_ = sizeof(Node);
+  header->value_size_ = sizeof(T);
+  header->open_generation_ = 0;
+  Root root{};
+  root.generation_ = 1;
+  root.end_ = kDataOffset;
+  root.checksum_ = Checksum(root);
+  header->roots_[0] = root;
+  header->roots_[1] = Root{};
+  SyncRange(0, kDataOffset);
+}
+
+// Стирает связи поколений, не дошедших до Sync(). Проход по всему файлу
+// нужен только после сбоя или закрытия без Sync().
+template<typename T>
+void PersistentBiDirectionalList<T>::Recover() {
+  for (uint64_t offset = kDataOffset; offset + sizeof(Node) <= root_.end_;
+       offset += sizeof(Node)) {
+    for (Links& links : NodeAt(offset)->links_) {
+      if (links.generation_ > root_.generation_) {
+        links = Links{};
+      }
+    }
+  }
+  SyncRange(kDataOffset, mapped_size_ - kDataOffset);
+  GetHeader()->open_generation_ = root_.generation_;
+  SyncRange(0, kDataOffset);
+}
+
+template<typename T>
+void PersistentBiDirectionalList<T>::SyncRange(size_t offset, size_t length) {
+  // msync принимает только адреса, выровненные по странице.
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t begin = offset / page * page;
+  if (msync(base_ + begin, offset + length - begin, MS_SYNC) != 0) {
+    throw std::runtime_error("Impossible to sync persistent list file");
+  }
+}
+
+template<typename T>
+uint64_t PersistentBiDirectionalList<T>::Checksum(const Root& root) {
+  // FNV-1a по всем полям корня, кроме самой суммы.
+  const uint64_t fields[] = {root.generation_, root.first_, root.last_,
+                             root.size_, root.free_, root.end_};
+  uint64_t hash = 14695981039346656037ull;
+  for (uint64_t field : fields) {
+    for (int byte = 0; byte < 8; ++byte) {
+      hash ^= (field >> (8 * byte)) & 0xff;
+      hash *= 1099511628211ull;
+    }
+  }
+  return hash;
+}
+#endif
+
+#endif // BIDIRECTIONAL_LIST_H_
@@ -0,0 +1,1422 @@
+// Микробенчмарки BiDirectionalList и контейнеров на его основе.
+//
+// bidirectional_list_bench [--suite core|features|all] [--max-size N]
+//                          [--repetitions N] [--filter подстрока]
+//                          [--footprint-size N]
+//
+// Набор core сравнивает BiDirectionalList с std::list, std::deque и
+// std::vector на размерах от 10 до --max-size (по умолчанию 10M) для int,
+// std::string и 64-байтной структуры. Набор features замеряет отдельные
+// возможности: пул узлов, проверяемые итераторы, сортировку, конкурентные
+// контейнеры, LRU-кэш, индексы, SIMD и параллельные алгоритмы. Замер
+// Footprint строит списки из --footprint-size (по умолчанию 100M) элементов
+// и печатает занятую ими память на элемент.
+//
+// Для каждого замера печатаются ns/op, выделения памяти на операцию и
+// промахи кэша на операцию (n/a, если perf_event_open недоступен). Для Find,
+// AsArray, Clear и Iterate операцией считается один элемент. Из нескольких
+// повторов берётся лучший.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <fstream>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "BiDirectionalList.h"
+
+#if __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BIDIRECTIONAL_LIST_PERF_COUNTERS
+#endif
+
+//-----------------------------------------------------------------------------
+// Подсчёт выделений памяти через замену глобальных operator new/delete.
+
+static std::atomic<size_t> allocation_count(0);
+static std::atomic<size_t> allocated_bytes(0);
+
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  size_t align = static_cast<size_t>(alignment);
+  size_t rounded = (std::max<size_t>(size, 1) + align - 1) / align * align;
+  if (void* pointer = std::aligned_alloc(align, rounded)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+// Память под operator new выделяется malloc, поэтому delete освобождает её
+// через free. GCC видит free в паре с new и ошибочно предупреждает о
+// несовпадении функций выделения и освобождения.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+//-----------------------------------------------------------------------------
+
+// Счётчик промахов кэша последнего уровня для процесса и всех потоков,
+// созданных после Start().
+class CacheMissCounter {
+ public:
+  CacheMissCounter();
+  ~CacheMissCounter();
+
+  CacheMissCounter(const CacheMissCounter&) = delete;
+  CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+  bool IsAvailable() const { return fd_ >= 0; }
+
+  void Start();
+  uint64_t Stop();
+
+ private:
+  int fd_ = -1;
+};
+
+CacheMissCounter::CacheMissCounter() {
+#ifdef BIDIRECTIONAL_LIST_PERF_COUNTERS
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+  attributes.disabled = 1;
+  attributes.inherit = 1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1,
+                                 0));
+#endif
+}
+
+CacheMissCounter::~CacheMissCounter() {
+#ifdef BIDIRECTIONAL_LIST_PERF_COUNTERS
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+#endif
+}
+
+void CacheMissCounter::Start() {
+#ifdef BIDIRECTIONAL_LIST_PERF_COUNTERS
+  if (fd_ >= 0) {
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+uint64_t CacheMissCounter::Stop() {
+  uint64_t count = 0;
+#ifdef BIDIRECTIONAL_LIST_PERF_COUNTERS
+  if (fd_ >= 0) {
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+      count = 0;
+    }
+  }
+#endif
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+
+struct BenchmarkOptions {
+  std::string suite_ = "all";
+  size_t max_size_ = 10'000'000;
+  int repetitions_ = 3;
+  std::string filter_;
+  size_t footprint_size_ = 100'000'000;
+};
+
+// Запускает замеры и печатает строку результата на каждый.
+class BenchmarkRunner {
+ public:
+  explicit BenchmarkRunner(BenchmarkOptions options)
+      : options_(std::move(options)) {}
+
+  const BenchmarkOptions& Options() const { return options_; }
+
+  bool IsSelected(const std::string& name) const {
+    return options_.filter_.empty() ||
+           name.find(options_.filter_) != std::string::npos;
+  }
+
+  // prepare() выполняется вне замера и возвращает замеряемое действие,
+  // которое совершает operations операций. Состояние, захваченное этим
+  // действием, разрушается тоже вне замера. Возвращает лучшее время на
+  // операцию в наносекундах, 0 -- если замер отфильтрован.
+  template<typename Prepare>
+  double Measure(const std::string& name, const std::string& variant,
+               size_t size, size_t operations, Prepare prepare);
+
+  void Skip(const std::string& name, const std::string& variant,
+            size_t size, const std::string& reason);
+
+  // Печатает произвольное значение вместо времени, например байты на
+  // элемент.
+  void Report(const std::string& name, const std::string& variant,
+              size_t size, double value, const std::string& unit);
+
+  void PrintHeader() const;
+
+ private:
+  BenchmarkOptions options_;
+  CacheMissCounter cache_misses_;
+
+  void PrintLabel(const std::string& name, const std::string& variant,
+                  size_t size) const;
+};
+
+template<typename Prepare>
+double BenchmarkRunner::Measure(const std::string& name,
+                                const std::string& variant, size_t size,
+                                size_t operations, Prepare prepare) {
+  if (!IsSelected(name + " " + variant)) {
+    return 0;
+  }
+  operations = std::max<size_t>(operations, 1);
+  int repetitions = size >= 1'000'000 ? 1 : options_.repetitions_;
+  double best_ns = std::numeric_limits<double>::max();
+  size_t best_allocations = 0;
+  uint64_t best_misses = 0;
+  for (int repetition = 0; repetition < repetitions; repetition++) {
+    auto body = prepare();
+    size_t allocations_before = allocation_count.load();
+    cache_misses_.Start();
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto finish = std::chrono::steady_clock::now();
+    uint64_t misses = cache_misses_.Stop();
+    size_t allocations = allocation_count.load() - allocations_before;
+    double ns = std::chrono::duration<double, std::nano>(finish - start)
+        .count();
+    if (ns < best_ns) {
+      best_ns = ns;
+      best_allocations = allocations;
+      best_misses = misses;
+    }
+  }
+  PrintLabel(name, variant, size);
+  std::cout << std::setw(12) << best_ns / operations << " ns/op"
+            << std::setw(10)
+            << static_cast<double>(best_allocations) / operations
+            << " allocs/op";
+  if (cache_misses_.IsAvailable()) {
+    std::cout << std::setw(10)
+              << static_cast<double>(best_misses) / operations;
+  } else {
+    std::cout << std::setw(10) << "n/a";
+  }
+  std::cout << " misses/op" << std::endl;
+  return best_ns / operations;
+}
+
+void BenchmarkRunner::Skip(const std::string& name,
+                           const std::string& variant, size_t size,
+                           const std::string& reason) {
+  if (!IsSelected(name + " " + variant)) {
+    return;
+  }
+  PrintLabel(name, variant, size);
+  std::cout << "  skipped: " << reason << std::endl;
+}
+
+void BenchmarkRunner::Report(const std::string& name,
+                             const std::string& variant, size_t size,
+                             double value, const std::string& unit) {
+  if (!IsSelected(name + " " + variant)) {
+    return;
+  }
+  PrintLabel(name, variant, size);
+  std::cout << std::setw(12) << value << " " << unit << std::endl;
+}
+
+void BenchmarkRunner::PrintHeader() const {
+  std::cout << std::left << std::setw(24) << "benchmark" << std::setw(46)
+            << "variant" << std::right << std::setw(10) << "size"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+}
+
+void BenchmarkRunner::PrintLabel(const std::string& name,
+                                 const std::string& variant,
+                                 size_t size) const {
+  std::cout << std::left << std::setw(24) << name << std::setw(46) << variant
+            << std::right << std::setw(10) << size;
+}
+
+// Не даёт компилятору выбросить вычисление, результат которого не нужен.
+template<typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//-----------------------------------------------------------------------------
+// Типы элементов.
+
+struct Payload64 {
+  bool operator==(const Payload64& other) const {
+    return values_[0] == other.values_[0];
+  }
+  bool operator<(const Payload64& other) const {
+    return values_[0] < other.values_[0];
+  }
+
+  int64_t values_[8];
+};
+static_assert(sizeof(Payload64) == 64);
+
+template<typename T>
+T MakeValue(size_t index);
+template<>
+int MakeValue<int>(size_t index) {
+  return static_cast<int>(index);
+}
+template<>
+std::string MakeValue<std::string>(size_t index) {
+  // Длиннее буфера малых строк, чтобы строка жила в куче.
+  std::string value = std::to_string(index);
+  return std::string(24 - std::min<size_t>(value.size(), 24), '#') + value;
+}
+template<>
+Payload64 MakeValue<Payload64>(size_t index) {
+  Payload64 value;
+  for (int64_t& field : value.values_) {
+    field = static_cast<int64_t>(index);
+  }
+  return value;
+}
+
+template<typename T>
+const char* TypeName();
+template<>
+const char* TypeName<int>() {
+  return "int";
+}
+template<>
+const char* TypeName<double>() {
+  return "double";
+}
+template<>
+const char* TypeName<std::string>() {
+  return "string";
+}
+template<>
+const char* TypeName<Payload64>() {
+  return "payload64";
+}
+
+int64_t Checksum(int value) {
+  return value;
+}
+int64_t Checksum(const std::string& value) {
+  return static_cast<int64_t>(value.size()) + value.back();
+}
+int64_t Checksum(const Payload64& value) {
+  return value.values_[7];
+}
+
+//-----------------------------------------------------------------------------
+// Единый интерфейс к сравниваемым контейнерам.
+
+template<typename Container>
+struct ContainerOps;
+
+template<typename T>
+struct ContainerOps<BiDirectionalList<T>> {
+  using Container = BiDirectionalList<T>;
+  using Iterator = typename Container::Iterator;
+  static constexpr const char* kName = "BiDirectionalList";
+  static constexpr bool kCheapFront = true;
+  static constexpr bool kCheapMiddle = true;
+
+  static void PushBack(Container& container, T value) {
+    container.PushBack(std::move(value));
+  }
+  static void PushFront(Container& container, T value) {
+    container.PushFront(std::move(value));
+  }
+  static Iterator Middle(Container& container) {
+    Iterator iterator = container.begin();
+    for (size_t i = 0; i < container.Size() / 2; i++) {
+      ++iterator;
+    }
+    return iterator;
+  }
+  static Iterator InsertBefore(Container& container, Iterator position,
+                               T value) {
+    container.InsertBefore(position, std::move(value));
+    return position;
+  }
+  static Iterator Erase(Container& container, Iterator position) {
+    Iterator next = position;
+    ++next;
+    container.Erase(position);
+    return next;
+  }
+  static bool Contains(Container& container, const T& value) {
+    return container.Find(value) != container.end();
+  }
+  static size_t AsArray(const Container& container) {
+    return container.AsArray().size();
+  }
+  static void Clear(Container& container) {
+    container.Clear();
+  }
+};
+
+template<typename T>
+struct ContainerOps<CompactBiDirectionalList<T>> {
+  using Container = CompactBiDirectionalList<T>;
+  using Iterator = typename Container::Iterator;
+  static constexpr const char* kName = "CompactBiDirectionalList";
+  static constexpr bool kCheapFront = true;
+  static constexpr bool kCheapMiddle = true;
+
+  static void PushBack(Container& container, T value) {
+    container.PushBack(std::move(value));
+  }
+  static void PushFront(Container& container, T value) {
+    container.PushFront(std::move(value));
+  }
+  static Iterator Middle(Container& container) {
+    Iterator iterator = container.begin();
+    for (size_t i = 0; i < container.Size() / 2; i++) {
+      ++iterator;
+    }
+    return iterator;
+  }
+  static Iterator InsertBefore(Container& container, Iterator position,
+                               T value) {
+    container.InsertBefore(position, std::move(value));
+    return position;
+  }
+  static Iterator Erase(Container& container, Iterator position) {
+    Iterator next = position;
+    ++next;
+    container.Erase(position);
+    return next;
+  }
+  static bool Contains(Container& container, const T& value) {
+    return container.Find(value) != container.end();
+  }
+  static size_t AsArray(const Container& container) {
+    return container.AsArray().size();
+  }
+  static void Clear(Container& container) {
+    container.Clear();
+  }
+};
+
+template<typename T, typename StdContainer>
+struct StdContainerOps {
+  using Container = StdContainer;
+  using Iterator = typename Container::iterator;
+
+  static void PushBack(Container& container, T value) {
+    container.push_back(std::move(value));
+  }
+  static void PushFront(Container& container, T value) {
+    container.insert(container.begin(), std::move(value));
+  }
+  static Iterator Middle(Container& container) {
+    return std::next(container.begin(), container.size() / 2);
+  }
+  static Iterator InsertBefore(Container& container, Iterator position,
+                               T value) {
+    Iterator inserted = container.insert(position, std::move(value));
+    return std::next(inserted);
+  }
+  static Iterator Erase(Container& container, Iterator position) {
+    return container.erase(position);
+  }
+  static bool Contains(Container& container, const T& value) {
+    return std::find(container.begin(), container.end(), value) !=
+           container.end();
+  }
+  static size_t AsArray(const Container& container) {
+    return std::vector<T>(container.begin(), container.end()).size();
+  }
+  static void Clear(Container& container) {
+    container.clear();
+  }
+};
+
+template<typename T>
+struct ContainerOps<std::list<T>> : StdContainerOps<T, std::list<T>> {
+  static constexpr const char* kName = "std::list";
+  static constexpr bool kCheapFront = true;
+  static constexpr bool kCheapMiddle = true;
+};
+template<typename T>
+struct ContainerOps<std::deque<T>> : StdContainerOps<T, std::deque<T>> {
+  static constexpr const char* kName = "std::deque";
+  static constexpr bool kCheapFront = true;
+  static constexpr bool kCheapMiddle = false;
+};
+template<typename T>
+struct ContainerOps<std::vector<T>> : StdContainerOps<T, std::vector<T>> {
+  static constexpr const char* kName = "std::vector";
+  static constexpr bool kCheapFront = false;
+  static constexpr bool kCheapMiddle = false;
+};
+
+// Операции, стоящие O(n) на элемент, на больших размерах заняли бы часы.
+const size_t kMaxLinearOperationSize = 100'000;
+const size_t kMaxMiddleOperations = 10'000;
+
+template<typename Container>
+std::shared_ptr<Container> Build(size_t size) {
+  using Ops = ContainerOps<Container>;
+  using T = std::decay_t<decltype(*std::declval<Container&>().begin())>;
+  auto container = std::make_shared<Container>();
+  for (size_t i = 0; i < size; i++) {
+    Ops::PushBack(*container, MakeValue<T>(i));
+  }
+  return container;
+}
+
+template<typename Container, typename T>
+void RunCoreBenchmarks(BenchmarkRunner& runner, size_t size) {
+  using Ops = ContainerOps<Container>;
+  std::string variant = std::string(Ops::kName) + "<" + TypeName<T>() + ">";
+
+  runner.Measure("PushBack", variant, size, size, [size]() {
+    auto container = std::make_shared<Container>();
+    return [container, size]() {
+      for (size_t i = 0; i < size; i++) {
+        Ops::PushBack(*container, MakeValue<T>(i));
+      }
+    };
+  });
+
+  if (Ops::kCheapFront || size <= kMaxLinearOperationSize) {
+    runner.Measure("PushFront", variant, size, size, [size]() {
+      auto container = std::make_shared<Container>();
+      return [container, size]() {
+        for (size_t i = 0; i < size; i++) {
+          Ops::PushFront(*container, MakeValue<T>(i));
+        }
+      };
+    });
+  } else {
+    runner.Skip("PushFront", variant, size, "O(n) per operation");
+  }
+
+  size_t middle_operations = std::min(size, kMaxMiddleOperations);
+  if (Ops::kCheapMiddle || size <= kMaxLinearOperationSize) {
+    runner.Measure("InsertBefore", variant, size, middle_operations,
+                   [size, middle_operations]() {
+      auto container = Build<Container>(size);
+      return [container, middle_operations]() {
+        auto position = Ops::Middle(*container);
+        for (size_t i = 0; i < middle_operations; i++) {
+          position = Ops::InsertBefore(*container, position, MakeValue<T>(i));
+        }
+      };
+    });
+    runner.Measure("Erase", variant, size, middle_operations / 2,
+                   [size, middle_operations]() {
+      auto container = Build<Container>(size);
+      return [container, middle_operations]() {
+        auto position = Ops::Middle(*container);
+        for (size_t i = 0; i < middle_operations / 2; i++) {
+          position = Ops::Erase(*container, position);
+        }
+      };
+    });
+  } else {
+    runner.Skip("InsertBefore", variant, size, "O(n) per operation");
+    runner.Skip("Erase", variant, size, "O(n) per operation");
+  }
+
+  auto built = Build<Container>(size);
+  runner.Measure("Find", variant, size, size, [built, size]() {
+    return [built, size]() {
+      DoNotOptimize(Ops::Contains(*built, MakeValue<T>(size + 1)));
+    };
+  });
+  runner.Measure("AsArray", variant, size, size, [built]() {
+    return [built]() { DoNotOptimize(Ops::AsArray(*built)); };
+  });
+  runner.Measure("Iterate", variant, size, size, [built]() {
+    return [built]() {
+      int64_t checksum = 0;
+      for (const T& value : *built) {
+        checksum += Checksum(value);
+      }
+      DoNotOptimize(checksum);
+    };
+  });
+  built.reset();
+
+  runner.Measure("Clear", variant, size, size, [size]() {
+    auto container = Build<Container>(size);
+    return [container]() { Ops::Clear(*container); };
+  });
+}
+
+template<typename T>
+void RunCoreBenchmarksForType(BenchmarkRunner& runner, size_t size) {
+  RunCoreBenchmarks<BiDirectionalList<T>, T>(runner, size);
+  RunCoreBenchmarks<std::list<T>, T>(runner, size);
+  RunCoreBenchmarks<std::deque<T>, T>(runner, size);
+  RunCoreBenchmarks<std::vector<T>, T>(runner, size);
+}
+
+void RunCoreSuite(BenchmarkRunner& runner) {
+  for (size_t size = 10; size <= runner.Options().max_size_; size *= 10) {
+    RunCoreBenchmarksForType<int>(runner, size);
+    RunCoreBenchmarksForType<std::string>(runner, size);
+    RunCoreBenchmarksForType<Payload64>(runner, size);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Отдельные возможности.
+
+void RunAllocatorBenchmarks(BenchmarkRunner& runner, size_t size) {
+  runner.Measure("NodeAllocation", "std::allocator<int>", size, size,
+                 [size]() {
+    auto list = std::make_shared<BiDirectionalList<int>>();
+    return [list, size]() {
+      for (size_t i = 0; i < size; i++) {
+        list->PushBack(static_cast<int>(i));
+      }
+    };
+  });
+  runner.Measure("NodeAllocation", "PoolAllocator<int>", size, size,
+                 [size]() {
+    auto list =
+        std::make_shared<BiDirectionalList<int, PoolAllocator<int>>>();
+    return [list, size]() {
+      for (size_t i = 0; i < size; i++) {
+        list->PushBack(static_cast<int>(i));
+      }
+    };
+  });
+
+  runner.Measure("Teardown", "std::allocator<int>", size, size, [size]() {
+    auto list = std::make_shared<BiDirectionalList<int>>();
+    for (size_t i = 0; i < size; i++) {
+      list->PushBack(static_cast<int>(i));
+    }
+    return [list]() { list->Clear(); };
+  });
+  runner.Measure("Teardown", "PoolAllocator<int>", size, size, [size]() {
+    auto list =
+        std::make_shared<BiDirectionalList<int, PoolAllocator<int>>>();
+    for (size_t i = 0; i < size; i++) {
+      list->PushBack(static_cast<int>(i));
+    }
+    return [list]() { list->Clear(); };
+  });
+
+  runner.Measure("Copy", "std::allocator<string>", size, size, [size]() {
+    auto source = Build<BiDirectionalList<std::string>>(size);
+    return [source]() {
+      BiDirectionalList<std::string> copy(*source);
+      DoNotOptimize(copy.Size());
+    };
+  });
+  runner.Measure("Copy", "PoolAllocator<string>", size, size, [size]() {
+    auto source = std::make_shared<BiDirectionalList<std::string,
+        PoolAllocator<std::string>>>();
+    for (size_t i = 0; i < size; i++) {
+      source->PushBack(MakeValue<std::string>(i));
+    }
+    return [source]() {
+      BiDirectionalList<std::string, PoolAllocator<std::string>> copy(
+          *source);
+      DoNotOptimize(copy.Size());
+    };
+  });
+}
+
+void RunTraversalBenchmarks(BenchmarkRunner& runner, size_t size) {
+  auto list = Build<BiDirectionalList<int>>(size);
+  int absent = -1;
+  runner.Measure("FindPredicate", "template lambda", size, size, [&]() {
+    return [list, absent]() {
+      DoNotOptimize(list->Find([absent](const int& value) {
+        return value == absent;
+      }) == list->end());
+    };
+  });
+  runner.Measure("FindPredicate", "std::function", size, size, [&]() {
+    return [list, absent]() {
+      std::function<bool(const int&)> predicate = [absent](const int& value) {
+        return value == absent;
+      };
+      DoNotOptimize(list->Find(predicate) == list->end());
+    };
+  });
+
+  auto unchecked = std::make_shared<BiDirectionalList<int, std::allocator<int>,
+                                                      UncheckedIterators>>();
+  for (size_t i = 0; i < size; i++) {
+    unchecked->PushBack(static_cast<int>(i));
+  }
+  runner.Measure("Iterate", "CheckedIterators", size, size, [&]() {
+    return [list]() {
+      int64_t sum = 0;
+      for (int value : *list) {
+        sum += value;
+      }
+      DoNotOptimize(sum);
+    };
+  });
+  runner.Measure("Iterate", "UncheckedIterators", size, size, [&]() {
+    return [unchecked]() {
+      int64_t sum = 0;
+      for (int value : *unchecked) {
+        sum += value;
+      }
+      DoNotOptimize(sum);
+    };
+  });
+
+  auto unrolled = std::make_shared<UnrolledBiDirectionalList<int>>();
+  for (size_t i = 0; i < size; i++) {
+    unrolled->PushBack(static_cast<int>(i));
+  }
+  runner.Measure("Iterate", "UnrolledBiDirectionalList", size, size, [&]() {
+    return [unrolled]() {
+      int64_t sum = 0;
+      for (int value : *unrolled) {
+        sum += value;
+      }
+      DoNotOptimize(sum);
+    };
+  });
+  runner.Measure("Find", "BiDirectionalList<int>", size, size, [&]() {
+    return [list, absent]() { DoNotOptimize(list->Find(absent)); };
+  });
+  runner.Measure("Find", "UnrolledBiDirectionalList (SIMD)", size, size,
+                 [&]() {
+    return [unrolled, absent]() { DoNotOptimize(unrolled->Find(absent)); };
+  });
+  auto snapshot = std::make_shared<std::vector<int>>(list->AsArray());
+  auto doubles = std::make_shared<std::vector<double>>(snapshot->begin(),
+                                                       snapshot->end());
+  runner.Measure("Find", "std::find on snapshot", size, size, [&]() {
+    return [snapshot, absent]() {
+      DoNotOptimize(std::find(snapshot->begin(), snapshot->end(), absent));
+    };
+  });
+  runner.Measure("Find", "SimdScan on snapshot", size, size, [&]() {
+    return [snapshot, absent]() {
+      DoNotOptimize(SimdScan::Find<int>(*snapshot, absent));
+    };
+  });
+  runner.Measure("Sum", "std::accumulate<double>", size, size, [&]() {
+    return [doubles]() {
+      DoNotOptimize(std::accumulate(doubles->begin(), doubles->end(), 0.0));
+    };
+  });
+  runner.Measure("Sum", "SimdScan<double>", size, size, [&]() {
+    return [doubles]() { DoNotOptimize(SimdScan::Sum<double>(*doubles)); };
+  });
+}
+
+void RunSortBenchmarks(BenchmarkRunner& runner, size_t size) {
+  std::mt19937 random(42);
+  std::vector<int> values(size);
+  for (int& value : values) {
+    value = static_cast<int>(random());
+  }
+  runner.Measure("Sort", "BiDirectionalList<int>", size, size, [&]() {
+    auto list = std::make_shared<BiDirectionalList<int>>();
+    for (int value : values) {
+      list->PushBack(value);
+    }
+    return [list]() { list->Sort(); };
+  });
+  runner.Measure("Sort", "std::list<int>", size, size, [&]() {
+    auto list = std::make_shared<std::list<int>>(values.begin(),
+                                                 values.end());
+    return [list]() { list->sort(); };
+  });
+  runner.Measure("Sort", "AsArray + std::sort + rebuild", size, size, [&]() {
+    auto list = std::make_shared<BiDirectionalList<int>>();
+    for (int value : values) {
+      list->PushBack(value);
+    }
+    return [list]() {
+      std::vector<int> array = list->AsArray();
+      std::sort(array.begin(), array.end());
+      BiDirectionalList<int> sorted;
+      for (int value : array) {
+        sorted.PushBack(value);
+      }
+      *list = std::move(sorted);
+    };
+  });
+}
+
+void RunPositionalBenchmarks(BenchmarkRunner& runner, size_t size) {
+  const size_t kLookups = 1000;
+  std::vector<size_t> positions(kLookups);
+  std::mt19937_64 random(7);
+  for (size_t& position : positions) {
+    position = random() % size;
+  }
+  auto ranked = std::make_shared<RankedBiDirectionalList<int>>();
+  auto list = Build<BiDirectionalList<int>>(size);
+  for (size_t i = 0; i < size; i++) {
+    ranked->PushBack(static_cast<int>(i));
+  }
+  runner.Measure("At", "RankedBiDirectionalList", size, kLookups, [&]() {
+    return [ranked, positions]() {
+      int64_t sum = 0;
+      for (size_t position : positions) {
+        sum += ranked->At(position);
+      }
+      DoNotOptimize(sum);
+    };
+  });
+  if (size <= 1'000'000) {
+    runner.Measure("At", "BiDirectionalList linear steps", size, kLookups,
+                   [&]() {
+      return [list, positions]() {
+        int64_t sum = 0;
+        for (size_t position : positions) {
+          auto iterator = list->begin();
+          for (size_t i = 0; i < position; i++) {
+            ++iterator;
+          }
+          sum += *iterator;
+        }
+        DoNotOptimize(sum);
+      };
+    });
+  } else {
+    runner.Skip("At", "BiDirectionalList linear steps", size,
+                "O(n) per operation");
+  }
+
+  auto indexed = std::make_shared<IndexedBiDirectionalList<int>>();
+  for (size_t i = 0; i < size; i++) {
+    indexed->PushBack(static_cast<int>(i));
+  }
+  runner.Measure("FindValue", "IndexedBiDirectionalList", size, kLookups,
+                 [&]() {
+    return [indexed, positions]() {
+      for (size_t position : positions) {
+        DoNotOptimize(indexed->Find(static_cast<int>(position)));
+      }
+    };
+  });
+  if (size <= 1'000'000) {
+    runner.Measure("FindValue", "BiDirectionalList linear scan", size,
+                   kLookups, [&]() {
+      return [list, positions]() {
+        for (size_t position : positions) {
+          DoNotOptimize(list->Find(static_cast<int>(position)));
+        }
+      };
+    });
+  } else {
+    runner.Skip("FindValue", "BiDirectionalList linear scan", size,
+                "O(n) per operation");
+  }
+}
+
+// Генератор ключей с распределением Ципфа (s = 0.99), как в трассах кэшей.
+class ZipfGenerator {
+ public:
+  ZipfGenerator(size_t keys, double exponent, uint64_t seed)
+      : cumulative_(keys), random_(seed) {
+    double sum = 0;
+    for (size_t i = 0; i < keys; i++) {
+      sum += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+      cumulative_[i] = sum;
+    }
+    for (double& value : cumulative_) {
+      value /= sum;
+    }
+  }
+
+  size_t Next() {
+    double sample = std::uniform_real_distribution<double>(0, 1)(random_);
+    return std::lower_bound(cumulative_.begin(), cumulative_.end(), sample) -
+           cumulative_.begin();
+  }
+
+ private:
+  std::vector<double> cumulative_;
+  std::mt19937_64 random_;
+};
+
+void RunLruBenchmarks(BenchmarkRunner& runner, size_t size) {
+  const size_t kKeys = std::max<size_t>(size, 100);
+  ZipfGenerator generator(kKeys, 0.99, 2024);
+  std::vector<size_t> trace(size);
+  for (size_t& key : trace) {
+    key = generator.Next();
+  }
+  for (size_t capacity : {kKeys / 100 + 1, kKeys / 10 + 1}) {
+    std::string variant = "LruCache zipf, capacity " +
+                          std::to_string(capacity);
+    auto hit_rate = std::make_shared<double>(0);
+    runner.Measure("LruGetPut", variant, size, size, [&, capacity]() {
+      auto cache = std::make_shared<LruCache<size_t, int64_t>>(capacity);
+      return [cache, &trace, hit_rate]() {
+        for (size_t key : trace) {
+          if (cache->Get(key) == nullptr) {
+            cache->Put(key, static_cast<int64_t>(key));
+          }
+        }
+        auto counters = cache->GetCounters();
+        *hit_rate = static_cast<double>(counters.hits_) /
+                    (counters.hits_ + counters.misses_);
+      };
+    });
+    if (runner.IsSelected("LruGetPut " + variant)) {
+      std::cout << "    hit rate " << *hit_rate * 100 << "%" << std::endl;
+    }
+  }
+}
+
+void RunConcurrentBenchmarks(BenchmarkRunner& runner, size_t size) {
+  size_t operations = std::min<size_t>(size, 200'000);
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    auto run_deque = [threads, operations](auto& push, auto& pop) {
+      std::vector<std::thread> workers;
+      for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+          for (size_t i = 0; i < operations / threads; i++) {
+            if ((i + t) % 2 == 0) {
+              push(static_cast<int>(i));
+            } else {
+              pop();
+            }
+          }
+        });
+      }
+      for (std::thread& worker : workers) {
+        worker.join();
+      }
+    };
+    runner.Measure("MpmcDeque", "ConcurrentDeque, " +
+                   std::to_string(threads) + " threads", threads,
+                   operations, [&]() {
+      return [run_deque]() {
+        ConcurrentDeque<int> deque;
+        auto push = [&deque](int value) { deque.PushBack(value); };
+        auto pop = [&deque]() { DoNotOptimize(deque.PopFront()); };
+        run_deque(push, pop);
+      };
+    });
+    runner.Measure("MpmcDeque", "std::deque + std::mutex, " +
+                   std::to_string(threads) + " threads", threads,
+                   operations, [&]() {
+      return [run_deque]() {
+        std::deque<int> deque;
+        std::mutex mutex;
+        auto push = [&](int value) {
+          std::lock_guard lock(mutex);
+          deque.push_back(value);
+        };
+        auto pop = [&]() {
+          std::lock_guard lock(mutex);
+          if (!deque.empty()) {
+            deque.pop_front();
+          }
+        };
+        run_deque(push, pop);
+      };
+    });
+  }
+
+  int list_size = static_cast<int>(std::min<size_t>(size, 10'000));
+  for (size_t threads : {2, 4, 8, 16}) {
+    auto run_list = [threads, operations, list_size](auto& insert,
+                                                     auto& erase,
+                                                     auto& find) {
+      std::vector<std::thread> workers;
+      for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+          for (size_t i = 0; i < operations / threads; i++) {
+            int key = static_cast<int>((i * 7919 + t * 104729) % list_size);
+            switch (i % 4) {
+              case 0:
+                insert(key);
+                break;
+              case 1:
+                erase(key);
+                break;
+              default:
+                find(key);
+            }
+          }
+        });
+      }
+      for (std::thread& worker : workers) {
+        worker.join();
+      }
+    };
+    runner.Measure("Contention", "FineGrainedBiDirectionalList, " +
+                   std::to_string(threads) + " threads", threads,
+                   operations, [&]() {
+      auto list = std::make_shared<FineGrainedBiDirectionalList<int>>();
+      for (int i = 0; i < list_size; i += 2) {
+        list->PushBack(i);
+      }
+      return [list, run_list]() {
+        auto insert = [&](int key) {
+          list->InsertBefore([key](int value) { return value >= key; }, key);
+        };
+        auto erase = [&](int key) { list->Erase(key); };
+        auto find = [&](int key) { DoNotOptimize(list->Contains(key)); };
+        run_list(insert, erase, find);
+      };
+    });
+    runner.Measure("Contention", "std::list + std::mutex, " +
+                   std::to_string(threads) + " threads", threads,
+                   operations, [&]() {
+      auto list = std::make_shared<std::list<int>>();
+      for (int i = 0; i < list_size; i += 2) {
+        list->push_back(i);
+      }
+      return [list, run_list]() {
+        std::mutex mutex;
+        auto insert = [&](int key) {
+          std::lock_guard lock(mutex);
+          auto position = std::find_if(list->begin(), list->end(),
+                                       [key](int value) {
+            return value >= key;
+          });
+          if (position != list->end()) {
+            list->insert(position, key);
+          }
+        };
+        auto erase = [&](int key) {
+          std::lock_guard lock(mutex);
+          auto position = std::find(list->begin(), list->end(), key);
+          if (position != list->end()) {
+            list->erase(position);
+          }
+        };
+        auto find = [&](int key) {
+          std::lock_guard lock(mutex);
+          DoNotOptimize(std::find(list->begin(), list->end(), key));
+        };
+        run_list(insert, erase, find);
+      };
+    });
+  }
+}
+
+// Планировщик с перехватом задач на WorkStealingDeque: задача fib(n)
+// порождает fib(n - 1) и fib(n - 2), листья суммируются в общий счётчик.
+int64_t RunFibonacci(size_t threads, int n) {
+  const int kSerialCutoff = 12;
+  std::vector<std::unique_ptr<WorkStealingDeque<int>>> deques;
+  for (size_t t = 0; t < threads; t++) {
+    deques.push_back(std::make_unique<WorkStealingDeque<int>>());
+  }
+  std::atomic<int64_t> result(0);
+  std::atomic<int64_t> pending(1);
+  deques[0]->PushBack(n);
+  std::function<int64_t(int)> serial = [&serial](int k) -> int64_t {
+    return k < 2 ? k : serial(k - 1) + serial(k - 2);
+  };
+  auto worker = [&](size_t self) {
+    uint32_t victim_state = static_cast<uint32_t>(self) * 2654435761u + 1;
+    while (pending.load(std::memory_order_acquire) > 0) {
+      std::optional<int> task = deques[self]->PopBack();
+      if (!task) {
+        victim_state = victim_state * 1664525u + 1013904223u;
+        task = deques[(victim_state >> 8) % threads]->Steal();
+        if (!task) {
+          std::this_thread::yield();
+          continue;
+        }
+      }
+      if (*task < kSerialCutoff) {
+        result.fetch_add(serial(*task), std::memory_order_relaxed);
+      } else {
+        pending.fetch_add(2, std::memory_order_relaxed);
+        deques[self]->PushBack(*task - 1);
+        deques[self]->PushBack(*task - 2);
+      }
+      pending.fetch_sub(1, std::memory_order_release);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; t++) {
+    workers.emplace_back(worker, t);
+  }
+  worker(0);
+  for (std::thread& thread : workers) {
+    thread.join();
+  }
+  return result.load();
+}
+
+void RunSchedulerBenchmarks(BenchmarkRunner& runner, int n) {
+  int64_t expected = 0;
+  for (int64_t previous = 1, i = 0; i < n; i++) {
+    expected += previous;
+    previous = expected - previous;
+  }
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    runner.Measure("ForkJoinFib", "WorkStealingDeque fib(" +
+                   std::to_string(n) + "), " + std::to_string(threads) +
+                   " threads", threads, 1, [&]() {
+      return [threads, n, expected]() {
+        if (RunFibonacci(threads, n) != expected) {
+          throw std::runtime_error("Impossible result of Fibonacci number");
+        }
+      };
+    });
+  }
+}
+
+void RunParallelBenchmarks(BenchmarkRunner& runner, size_t size) {
+  auto list = Build<BiDirectionalList<int>>(size);
+  // Заметная работа на элемент, чтобы масштабирование не упиралось в
+  // пропускную способность памяти.
+  auto expensive = [](int64_t accumulator, int64_t value) {
+    double x = static_cast<double>(value);
+    for (int i = 0; i < 20; i++) {
+      x = std::sqrt(x + i);
+    }
+    return accumulator + static_cast<int64_t>(x);
+  };
+  runner.Measure("Reduce", "SequencedPolicy", size, size, [&]() {
+    return [list, expensive]() {
+      DoNotOptimize(list->Reduce(SequencedPolicy{}, int64_t(0), expensive));
+    };
+  });
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    runner.Measure("Reduce", "ParallelPolicy, " + std::to_string(threads) +
+                   " threads", size, size, [&, threads]() {
+      return [list, expensive, threads]() {
+        DoNotOptimize(list->Reduce(ParallelPolicy{threads}, int64_t(0),
+                                   expensive));
+      };
+    });
+  }
+}
+
+#ifdef BIDIRECTIONAL_LIST_POSIX
+// Пропускная способность Save/Load через файловый дескриптор (файл в
+// страничном кэше) против контрольной точки через AsArray() и поэлементную
+// запись в поток. Операция -- один байт данных.
+template<typename T>
+void RunSerializationBenchmarks(BenchmarkRunner& runner, size_t size) {
+  std::string path = "/tmp/bidirectional_list_bench_" +
+                     std::to_string(getpid()) + ".bin";
+  auto list = std::make_shared<BiDirectionalList<T>>();
+  for (size_t i = 0; i < size; i++) {
+    list->PushBack(static_cast<T>(i));
+  }
+  size_t bytes = size * sizeof(T);
+  std::string type = TypeName<T>();
+  auto report = [](double ns_per_byte) {
+    if (ns_per_byte > 0) {
+      std::cout << "    " << 1 / ns_per_byte << " GB/s" << std::endl;
+    }
+  };
+
+  report(runner.Measure("Save", "BiDirectionalList<" + type + "> fd", size,
+                        bytes, [&]() {
+    return [list, path]() {
+      int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      list->Save(fd);
+      close(fd);
+    };
+  }));
+  report(runner.Measure("Save", "AsArray + element writes <" + type + ">",
+                        size, bytes, [&]() {
+    return [list, path]() {
+      std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+      for (const T& value : list->AsArray()) {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+      }
+    };
+  }));
+  {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    list->Save(fd);
+    close(fd);
+  }
+  report(runner.Measure("Load", "BiDirectionalList<" + type + "> fd", size,
+                        bytes, [&]() {
+    return [path]() {
+      BiDirectionalList<T> loaded;
+      int fd = open(path.c_str(), O_RDONLY);
+      loaded.Load(fd);
+      close(fd);
+      DoNotOptimize(loaded.Size());
+    };
+  }));
+  report(runner.Measure("Load", "BiDirectionalList<" + type +
+                        ", PoolAllocator> fd", size, bytes, [&]() {
+    return [path]() {
+      BiDirectionalList<T, PoolAllocator<T>> loaded;
+      int fd = open(path.c_str(), O_RDONLY);
+      loaded.Load(fd);
+      close(fd);
+      DoNotOptimize(loaded.Size());
+    };
+  }));
+  report(runner.Measure("Load", "BiDirectionalListReader<" + type + "> fd",
+                        size, bytes, [&]() {
+    return [path]() {
+      int fd = open(path.c_str(), O_RDONLY);
+      BiDirectionalListReader<T> reader(fd);
+      std::vector<T> chunk;
+      T sum = 0;
+      while (reader.ReadChunk(chunk)) {
+        sum = std::accumulate(chunk.begin(), chunk.end(), sum);
+      }
+      close(fd);
+      DoNotOptimize(sum);
+    };
+  }));
+  std::remove(path.c_str());
+}
+#endif
+
+#ifdef BIDIRECTIONAL_LIST_MMAP
+// Холодный старт: пересборка списка через PushBack против открытия
+// сохранённого PersistentBiDirectionalList.
+void RunPersistentBenchmarks(BenchmarkRunner& runner, size_t size) {
+  std::string path = "/tmp/bidirectional_list_bench_" +
+                     std::to_string(getpid()) + ".bdl";
+  std::remove(path.c_str());
+  {
+    PersistentBiDirectionalList<int> list(path);
+    for (size_t i = 0; i < size; i++) {
+      list.PushBack(static_cast<int>(i));
+    }
+    list.Sync();
+  }
+  runner.Measure("ColdStart", "BiDirectionalList rebuild", size, size, [&]() {
+    return [size]() {
+      BiDirectionalList<int> list;
+      for (size_t i = 0; i < size; i++) {
+        list.PushBack(static_cast<int>(i));
+      }
+      DoNotOptimize(list.Size());
+    };
+  });
+  runner.Measure("ColdStart", "PersistentBiDirectionalList open", size, size,
+                 [&]() {
+    return [&path]() {
+      PersistentBiDirectionalList<int> list(path);
+      DoNotOptimize(list.Size());
+    };
+  });
+  runner.Measure("ColdStart", "PersistentBiDirectionalList open+iterate",
+                 size, size, [&]() {
+    return [&path]() {
+      PersistentBiDirectionalList<int> list(path);
+      int64_t sum = 0;
+      for (int value : list) {
+        sum += value;
+      }
+      DoNotOptimize(sum);
+    };
+  });
+  runner.Measure("PushBack", "PersistentBiDirectionalList + Sync", size,
+                 size, [&]() {
+    std::remove(path.c_str());
+    return [&path, size]() {
+      PersistentBiDirectionalList<int> list(path);
+      for (size_t i = 0; i < size; i++) {
+        list.PushBack(static_cast<int>(i));
+      }
+      list.Sync();
+    };
+  });
+  std::remove(path.c_str());
+}
+#endif
+
+// Сравнение с BiDirectionalList на тех же операциях, что и в наборе core.
+void RunCompactBenchmarks(BenchmarkRunner& runner, size_t size) {
+  RunCoreBenchmarks<CompactBiDirectionalList<int>, int>(runner, size);
+  RunCoreBenchmarks<CompactBiDirectionalList<std::string>, std::string>(
+      runner, size);
+}
+
+// Значение вида "Key:   123 kB" из файла в /proc, в байтах; 0, если его
+// прочитать не удалось.
+size_t ReadProcBytes(const char* path, const std::string& key) {
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.size() > key.size() && line.compare(0, key.size(), key) == 0 &&
+        line[key.size()] == ':') {
+      return std::stoull(line.substr(key.size() + 1)) * 1024;
+    }
+  }
+  return 0;
+}
+
+template<typename Container>
+void MeasureFootprint(BenchmarkRunner& runner, size_t size) {
+  using Ops = ContainerOps<Container>;
+  std::string variant = std::string(Ops::kName) + "<int>";
+  if (!runner.IsSelected("Footprint " + variant)) {
+    return;
+  }
+#ifdef __GLIBC__
+  // Возвращает системе кучу предыдущего замера, иначе новый список займёт
+  // её, не увеличив RSS.
+  malloc_trim(0);
+#endif
+  // Память оценивается по небольшому списку, а полуторный запас покрывает
+  // заголовки malloc, чтобы большой замер не закончился нехваткой памяти.
+  const size_t kSample = 1 << 16;
+  size_t before = allocated_bytes.load();
+  {
+    Container sample;
+    for (size_t i = 0; i < kSample; i++) {
+      Ops::PushBack(sample, static_cast<int>(i));
+    }
+  }
+  double estimate = 1.5 * (allocated_bytes.load() - before) / kSample * size;
+  size_t available = ReadProcBytes("/proc/meminfo", "MemAvailable");
+  if (available != 0 && estimate > available) {
+    runner.Skip("Footprint", variant, size,
+                "needs about " + std::to_string(size_t(estimate) >> 20) +
+                " MB, " + std::to_string(available >> 20) +
+                " MB available");
+    return;
+  }
+
+  size_t resident_before = ReadProcBytes("/proc/self/status", "VmRSS");
+  before = allocated_bytes.load();
+  auto container = std::make_unique<Container>();
+  for (size_t i = 0; i < size; i++) {
+    Ops::PushBack(*container, static_cast<int>(i));
+  }
+  size_t allocated = allocated_bytes.load() - before;
+  size_t resident = ReadProcBytes("/proc/self/status", "VmRSS");
+  runner.Report("Footprint", variant + " allocated", size,
+                static_cast<double>(allocated) / size, "bytes/elem");
+  if (resident != 0) {
+    resident -= std::min(resident, resident_before);
+    runner.Report("Footprint", variant + " resident", size,
+                  static_cast<double>(resident) / size, "bytes/elem");
+  }
+}
+
+// Память на элемент для списков по указателям и по 32-битным индексам.
+// Списки строятся по одному, чтобы каждый замер видел всю свободную память.
+void RunFootprintBenchmarks(BenchmarkRunner& runner, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  MeasureFootprint<BiDirectionalList<int>>(runner, size);
+  MeasureFootprint<std::list<int>>(runner, size);
+  MeasureFootprint<CompactBiDirectionalList<int>>(runner, size);
+}
+
+void RunFeatureSuite(BenchmarkRunner& runner) {
+  size_t size = std::min<size_t>(runner.Options().max_size_, 10'000'000);
+  size_t medium = std::min<size_t>(size, 1'000'000);
+  RunAllocatorBenchmarks(runner, size);
+  RunTraversalBenchmarks(runner, medium);
+  RunSortBenchmarks(runner, size);
+  RunPositionalBenchmarks(runner, medium);
+  RunLruBenchmarks(runner, medium);
+  RunConcurrentBenchmarks(runner, medium);
+  RunSchedulerBenchmarks(runner, size >= 1'000'000 ? 32 : 20);
+  RunParallelBenchmarks(runner, size);
+#ifdef BIDIRECTIONAL_LIST_POSIX
+  RunSerializationBenchmarks<int>(runner, size);
+  RunSerializationBenchmarks<double>(runner, size);
+#endif
+#ifdef BIDIRECTIONAL_LIST_MMAP
+  RunPersistentBenchmarks(runner, size);
+#endif
+  RunCompactBenchmarks(runner, medium);
+  RunFootprintBenchmarks(runner, runner.Options().footprint_size_);
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    bool has_value = i + 1 < argc;
+    if (argument == "--suite" && has_value) {
+      options.suite_ = argv[++i];
+    } else if (argument == "--max-size" && has_value) {
+      options.max_size_ = std::stoull(argv[++i]);
+    } else if (argument == "--repetitions" && has_value) {
+      options.repetitions_ = std::max(1, std::stoi(argv[++i]));
+    } else if (argument == "--filter" && has_value) {
+      options.filter_ = argv[++i];
+    } else if (argument == "--footprint-size" && has_value) {
+      options.footprint_size_ = std::stoull(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--suite core|features|all] [--max-size N]"
+                << " [--repetitions N] [--filter substring]"
+                << " [--footprint-size N]" << std::endl;
+      return 1;
+    }
+  }
+
+  BenchmarkRunner runner(options);
+  runner.PrintHeader();
+  if (options.suite_ == "core" || options.suite_ == "all") {
+    RunCoreSuite(runner);
+  }
+  if (options.suite_ == "features" || options.suite_ == "all") {
+    RunFeatureSuite(runner);
+  }
+  return 0;
+}
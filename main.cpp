@@ -1,13 +1,18 @@
-#include <iterator>
+// Тесты построены на assert, поэтому NDEBUG для них снимается даже в
+// сборке Release.
+#undef NDEBUG
+
 #include <iostream>
-#include <vector>
-#include <functional>
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <list>
-#include <chrono>
-#include <exception>
+#include <deque>
 #include <string>
-#include <algorithm>
+#include <sstream>
+#include <numeric>
+
+#include "BiDirectionalList.h"
 
 //Напишите реализацию для класса BiDirectionalList и тесты к нему.
 //
@@ -16,499 +21,107 @@
 //
 //-----------------------------------------------------------------------------
 
-template<typename T>
-class BiDirectionalList {
- protected:
-  struct Node;
-
- public:
-  class Iterator : public std::iterator<std::bidirectional_iterator_tag, T> {
-   public:
-    T& operator*() const;
-    T* operator->() const;
-
-    Iterator& operator++();
-    const Iterator operator++(int);
-
-    Iterator& operator--();
-    const Iterator operator--(int);
-
-    bool operator==(const Iterator& other) const;
-    bool operator!=(const Iterator& other) const;
-
-   private:
-    friend class BiDirectionalList;
-
-    const BiDirectionalList* const list_;
-    Node* node_;
-
-    Iterator(const BiDirectionalList* const list, Node* node) : list_(list),
-                                                                node_(node) {}
-  };
-
-  class ConstIterator :
-      public std::iterator<std::bidirectional_iterator_tag, T> {
-   public:
-    const T& operator*() const;
-    const T* operator->() const;
-
-    ConstIterator& operator++();
-    const ConstIterator operator++(int);
-
-    ConstIterator& operator--();
-    const ConstIterator operator--(int);
-
-    bool operator==(const ConstIterator& other) const;
-    bool operator!=(const ConstIterator& other) const;
-
-   private:
-    friend class BiDirectionalList;
-
-    const BiDirectionalList* const list_;
-    const Node* node_;
-
-    ConstIterator(const BiDirectionalList* const list, Node* node)
-        : list_(list), node_(node) {}
-  };
-
-  BiDirectionalList() : first_(nullptr), last_(nullptr) {}
-
-  ~BiDirectionalList() { Clear(); }
-
-  bool IsEmpty() const;
-
-  void Clear();
-
-  Iterator begin();
-  Iterator end();
-
-  ConstIterator begin() const;
-  ConstIterator end() const;
-
-  std::vector<T> AsArray() const;
-
-  void InsertBefore(Iterator position, const T& value);
-  void InsertBefore(Iterator position, T&& value);
-
-  void InsertAfter(Iterator position, const T& value);
-  void InsertAfter(Iterator position, T&& value);
-
-  void PushBack(const T& value);
-  void PushBack(T&& value);
-
-  void PushFront(const T& value);
-  void PushFront(T&& value);
-
-  void Erase(Iterator position);
-
-  void PopFront();
-  void PopBack();
-
-  Iterator Find(const T& value);
-  ConstIterator Find(const T& value) const;
-
-  Iterator Find(std::function<bool(const T&)> predicate);
-  ConstIterator Find(std::function<bool(const T&)> predicate) const;
-
- protected:
-  struct Node {
-    explicit Node(const T& value);
-    explicit Node(T&& value);
-
-    T value_;
-    Node* next_node_;
-    Node* previous_node_;
-  };
-
-  Node* first_;
-  Node* last_;
-
-  void InsertBefore(Node* existing_node, Node* new_node);
-  void InsertAfter(Node* existing_node, Node* new_node);
-  void Erase(Node* node);
-};
-
-template<typename T>
-BiDirectionalList<T>::Node::Node(const T& value) : value_(value),
-                                                   previous_node_(nullptr),
-                                                   next_node_(nullptr) {}
-template<typename T>
-BiDirectionalList<T>::Node::Node(T&& value) : value_(value),
-                                              previous_node_(nullptr),
-                                              next_node_(nullptr) {
-  value = T();
-}
-
-template<typename T>
-T& BiDirectionalList<T>::Iterator::operator*() const {
-  return node_->value_;
-}
-template<typename T>
-T* BiDirectionalList<T>::Iterator::operator->() const {
-  return &node_->value_;
-}
-
-template<typename T>
-typename BiDirectionalList<T>::Iterator& BiDirectionalList<T>::
-    Iterator::operator++() {
-  if (node_ == nullptr) {
-    throw std::runtime_error("Impossible to increase iterator");
-  }
-  node_ = node_->next_node_;
-  return *this;
-}
-template<typename T>
-const typename BiDirectionalList<T>::Iterator BiDirectionalList<T>::
-    Iterator::operator++(int) {
-  if (node_ == nullptr) {
-    throw std::runtime_error("Impossible to increase iterator");
-  }
-  auto new_node = node_;
-  node_ = node_->next_node_;
-  Iterator new_iterator(list_, new_node);
-  return new_iterator;
-}
-
-template<typename T>
-typename BiDirectionalList<T>::Iterator& BiDirectionalList<T>::
-    Iterator::operator--() {
-  if (node_ == list_->first_) {
-    throw std::runtime_error("Impossible to reduce iterator");
-  } else if (node_ == nullptr) {
-    node_ = list_->last_;
-  } else {
-    node_ = node_->previous_node_;
-  }
-  return *this;
-}
-template<typename T>
-const typename BiDirectionalList<T>::Iterator BiDirectionalList<T>::
-    Iterator::operator--(int) {
-  if (node_ == list_->first_) {
-    throw std::runtime_error("Impossible to reduce iterator");
-  }
-  auto new_node = node_;
-  if (node_ == nullptr) {
-    node_ = list_->last_;
-  } else {
-    node_ = node_->previous_node_;
-  }
-  Iterator new_iterator(list_, new_node);
-  return new_iterator;
-}
-
-template<typename T>
-bool BiDirectionalList<T>::Iterator::operator==
-  (const BiDirectionalList::Iterator& other) const {
-  return other.node_ == node_;
-}
-template<typename T>
-bool BiDirectionalList<T>::Iterator::operator!=
-  (const BiDirectionalList::Iterator& other) const {
-  return other.node_ != node_;
-}
-
-template<typename T>
-const T& BiDirectionalList<T>::ConstIterator::operator*() const {
-  return node_->value_;
-}
-template<typename T>
-const T* BiDirectionalList<T>::ConstIterator::operator->() const {
-  return &node_->value_;
-}
-
-template<typename T>
-typename BiDirectionalList<T>::ConstIterator& BiDirectionalList<T>::
-    ConstIterator::operator++() {
-  if (node_ == nullptr) {
-    throw std::runtime_error("Impossible to increase iterator");
-  }
-  node_ = node_->next_node_;
-  return *this;
-}
-template<typename T>
-const typename BiDirectionalList<T>::ConstIterator BiDirectionalList<T>::
-    ConstIterator::operator++(int) {
-  if (node_ == nullptr) {
-    throw std::runtime_error("Impossible to increase iterator");
-  }
-  auto new_node = node_;
-  node_ = node_->next_node_;
-  ConstIterator new_iterator(list_, new_node);
-  return new_iterator;
-}
-
-template<typename T>
-typename BiDirectionalList<T>::ConstIterator& BiDirectionalList<T>::
-    ConstIterator::operator--() {
-  if (node_ == list_->first_) {
-    throw std::runtime_error("Impossible to reduce iterator");
-  }
-  if (node_ == nullptr) {
-    node_ = list_->last_;
-  } else {
-    node_ = node_->previous_node_;
-  }
-  return *this;
-}
-template<typename T>
-const typename BiDirectionalList<T>::ConstIterator BiDirectionalList<T>::
-    ConstIterator::operator--(int) {
-  if (node_ == list_->first_) {
-    throw std::runtime_error("Impossible to reduce iterator");
-  }
-  auto new_node = node_;
-  if (node_ == nullptr) {
-    node_ = list_->last_;
-  } else {
-    node_ = node_->previous_node_;
-  }
-  ConstIterator new_iterator(list_, new_node);
-  return new_iterator;
-}
-
-template<typename T>
-bool BiDirectionalList<T>::ConstIterator::operator==
-  (const BiDirectionalList::ConstIterator& other) const {
-  return other.node_ == node_;
-}
-template<typename T>
-bool BiDirectionalList<T>::ConstIterator::operator!=
-  (const BiDirectionalList::ConstIterator& other) const {
-  return other.node_ != node_;
-}
-
-template<typename T>
-bool BiDirectionalList<T>::IsEmpty() const {
-  return last_ == first_ && last_ == nullptr;
-}
+// Для тестирования группы закомментируйте или удалите строчку
+// "#define SKIP_XXXXX" для соответствующей группы тестов.
+//
+// #define SKIP_Actions_with_iterators
+// #define SKIP_PushFront
+// #define SKIP_PushBack
+// #define SKIP_PopBack
+// #define SKIP_PopFront
+// #define SKIP_Find
+// #define SKIP_Find_with_predicate
+// #define SKIP_Insert
+// #define SKIP_Erase
+// #define SKIP_Combo_vombo
+// #define SKIP_Exception
+// #define SKIP_Allocator
+// #define SKIP_Move_semantics
+// #define SKIP_Size
+// #define SKIP_Clear
+// #define SKIP_Template_predicates
+// #define SKIP_Unrolled
+// #define SKIP_Copy_and_move
+// #define SKIP_Splice
+// #define SKIP_Sort
+// #define SKIP_Export
+// #define SKIP_Iterator_policy
+// #define SKIP_Concurrent_deque
+// #define SKIP_Work_stealing
+// #define SKIP_Fine_grained
+// #define SKIP_Intrusive
+// #define SKIP_Lru_cache
+// #define SKIP_Indexed
+// #define SKIP_Ranked
+// #define SKIP_Simd
+// #define SKIP_Parallel
+// #define SKIP_Stats
+// #define SKIP_Persistent
+// #define SKIP_Serialization
+// #define SKIP_Compact
+//
+//===========================================================
 
-template<typename T>
-void BiDirectionalList<T>::Clear() {
-  while (!IsEmpty()) {
-    Erase(last_);
+BiDirectionalList<std::string> MakeStringList(int count) {
+  BiDirectionalList<std::string> result;
+  for (int i = 0; i < count; i++) {
+    result.PushBack(std::to_string(i));
   }
+  return result;
 }
 
-template<typename T>
-typename BiDirectionalList<T>::Iterator BiDirectionalList<T>::begin() {
-  return BiDirectionalList::Iterator(this, first_);
-}
-template<typename T>
-typename BiDirectionalList<T>::Iterator BiDirectionalList<T>::end() {
-  return BiDirectionalList::Iterator(this, nullptr);
-}
+struct Timer {
+  explicit Timer(int deadline) : deadline_(deadline) {}
 
-template<typename T>
-typename BiDirectionalList<T>::ConstIterator BiDirectionalList<T>::
-    begin() const {
-  return BiDirectionalList::ConstIterator(this, first_);
-}
-template<typename T>
-typename BiDirectionalList<T>::ConstIterator BiDirectionalList<T>::
-    end() const {
-  return BiDirectionalList::ConstIterator(this, nullptr);
-}
-
-template<typename T>
-std::vector<T> BiDirectionalList<T>::AsArray() const {
-  std::vector<T> new_vector;
-  for (auto i = begin(); i != end(); ++i) {
-    new_vector.push_back(*i);
+  bool operator==(const Timer& other) const {
+    return deadline_ == other.deadline_;
   }
-  return new_vector;
-}
-
-template<typename T>
-void BiDirectionalList<T>::InsertBefore(BiDirectionalList::Iterator position,
-                                        const T& value) {
-  Node* new_node = new Node(value);
-  InsertBefore(position.node_, new_node);
-}
-template<typename T>
-void BiDirectionalList<T>::InsertBefore(BiDirectionalList::Iterator position,
-                                        T&& value) {
-  Node* new_node = new Node(std::move(value));
-  InsertBefore(position.node_, new_node);
-}
 
-template<typename T>
-void BiDirectionalList<T>::InsertAfter(BiDirectionalList::Iterator position,
-                                       const T& value) {
-  Node* new_node = new Node(value);
-  InsertAfter(position.node_, new_node);
-}
-template<typename T>
-void BiDirectionalList<T>::InsertAfter(BiDirectionalList::Iterator position,
-                                       T&& value) {
-  Node* new_node = new Node(std::move(value));
-  InsertAfter(position.node_, new_node);
-}
-
-template<typename T>
-void BiDirectionalList<T>::PushBack(const T& value) {
-  Node* new_node = new Node(value);
-  InsertAfter(last_, new_node);
-}
-template<typename T>
-void BiDirectionalList<T>::PushBack(T&& value) {
-  Node* new_node = new Node(std::move(value));
-  InsertAfter(last_, new_node);
-}
+  int deadline_;
+  IntrusiveListHook<Timer> by_deadline_;
+  IntrusiveListHook<Timer> expired_;
+};
 
-template<typename T>
-void BiDirectionalList<T>::PushFront(const T& value) {
-  Node* new_node = new Node(value);
-  InsertBefore(first_, new_node);
-}
-template<typename T>
-void BiDirectionalList<T>::PushFront(T&& value) {
-  Node* new_node = new Node(std::move(value));
-  InsertBefore(first_, new_node);
-}
+struct CopyCounter {
+  static inline int copies = 0;
+  static inline int moves = 0;
 
-template<typename T>
-void BiDirectionalList<T>::Erase(BiDirectionalList::Iterator position) {
-  if (IsEmpty()) {
-    throw std::runtime_error("Impossible to delete element from empty list");
+  CopyCounter() = default;
+  CopyCounter(int first, std::string second)
+      : first_(first), second_(std::move(second)) {}
+  CopyCounter(const CopyCounter& other)
+      : first_(other.first_), second_(other.second_) {
+    ++copies;
   }
-  if (position == end()) {
-    throw std::runtime_error("Impossible to delete end");
+  CopyCounter(CopyCounter&& other) noexcept
+      : first_(other.first_), second_(std::move(other.second_)) {
+    ++moves;
   }
-  Erase(position.node_);
-}
+  CopyCounter& operator=(const CopyCounter& other) = default;
+  CopyCounter& operator=(CopyCounter&& other) = default;
 
-template<typename T>
-void BiDirectionalList<T>::PopFront() {
-  if (IsEmpty()) {
-    throw std::runtime_error("Impossible to delete element from empty list");
-  }
-  Erase(begin().node_);
-}
-template<typename T>
-void BiDirectionalList<T>::PopBack() {
-  if (IsEmpty()) {
-    throw std::runtime_error("Impossible to delete element from empty list");
-  }
-  Erase((--end()).node_);
-}
+  int first_ = 0;
+  std::string second_;
+};
 
-template<typename T>
-typename BiDirectionalList<T>::Iterator BiDirectionalList<T>::
-Find(const T& value) {
-  for (Iterator i = begin(); i != end(); ++i) {
-    if (*i == value) {
-      return i;
-    }
-  }
-  return end();
-}
-template<typename T>
-typename BiDirectionalList<T>::ConstIterator BiDirectionalList<T>::
-Find(const T& value) const {
-  for (ConstIterator i = begin(); i != end(); ++i) {
-    if (*i == value) {
-      return i;
-    }
-  }
-  return end();
-}
+// Копирование бросает исключение, когда copies_left доходит до нуля;
+// отрицательное значение снимает ограничение.
+struct ThrowingCopy {
+  static inline int copies_left = -1;
 
-template<typename T>
-typename BiDirectionalList<T>::Iterator BiDirectionalList<T>::
-Find(std::function<bool(const T&)> predicate) {
-  for (Iterator i = begin(); i != end(); ++i) {
-    if (predicate(*i)) {
-      return i;
+  explicit ThrowingCopy(int value) : value_(value) {}
+  ThrowingCopy(const ThrowingCopy& other) : value_(other.value_) {
+    if (copies_left == 0) {
+      throw std::runtime_error("copy failed");
     }
+    --copies_left;
   }
-  return end();
-}
-template<typename T>
-typename BiDirectionalList<T>::ConstIterator BiDirectionalList<T>::
-Find(std::function<bool(const T&)> predicate) const {
-  for (ConstIterator i = begin(); i != end(); ++i) {
-    if (predicate(*i)) {
-      return i;
-    }
-  }
-  return end();
-}
-
-template<typename T>
-void BiDirectionalList<T>::InsertBefore(BiDirectionalList::Node* existing_node,
-                                        BiDirectionalList::Node* new_node) {
-  if (first_ == nullptr) {
-    first_ = last_ = new_node;
-  } else if (existing_node == first_) {
-    new_node->next_node_ = existing_node;
-    existing_node->previous_node_ = new_node;
-    first_ = new_node;
-  } else {
-    Node* existing_previous_node = existing_node->previous_node_;
-    existing_node->previous_node_ = new_node;
-    new_node->previous_node_ = existing_previous_node;
-    existing_previous_node->next_node_ = new_node;
-    new_node->next_node_ = existing_node;
-  }
-}
-template<typename T>
-void BiDirectionalList<T>::InsertAfter(BiDirectionalList::Node* existing_node,
-                                       BiDirectionalList::Node* new_node) {
-  if (IsEmpty()) {
-    first_ = last_ = new_node;
-  } else if (existing_node == last_) {
-    existing_node->next_node_ = new_node;
-    new_node->previous_node_ = existing_node;
-    last_ = new_node;
-  } else {
-    Node* existing_next_node = existing_node->next_node_;
-    existing_node->next_node_ = new_node;
-    new_node->next_node_ = existing_next_node;
-    existing_next_node->previous_node_ = new_node;
-    new_node->previous_node_ = existing_node;
-  }
-}
-template<typename T>
-void BiDirectionalList<T>::Erase(BiDirectionalList::Node* node) {
-  if (node->next_node_ == nullptr && node->previous_node_ == nullptr) {
-    delete node;
-    first_ = last_ = nullptr;
-  } else if (node->next_node_ == nullptr) {
-    Node* prev = node->previous_node_;
-    delete node;
-    last_ = prev;
-    last_->next_node_ = nullptr;
-  } else if (node->previous_node_ == nullptr) {
-    Node* next = node->next_node_;
-    delete node;
-    first_ = next;
-    first_->previous_node_ = nullptr;
-  } else {
-    Node* prev = node->previous_node_;
-    Node* next = node->next_node_;
-    prev->next_node_ = next;
-    next->previous_node_ = prev;
-    delete node;
-  }
-}
+  ThrowingCopy(ThrowingCopy&& other) noexcept = default;
+  ThrowingCopy& operator=(const ThrowingCopy& other) = default;
+  ThrowingCopy& operator=(ThrowingCopy&& other) noexcept = default;
 
-// Для тестирования группы закомментируйте или удалите строчку
-// "#define SKIP_XXXXX" для соответствующей группы тестов.
-//
-// #define SKIP_Actions_with_iterators
-// #define SKIP_PushFront
-// #define SKIP_PushBack
-// #define SKIP_PopBack
-// #define SKIP_PopFront
-// #define SKIP_Find
-// #define SKIP_Find_with_predicate
-// #define SKIP_Insert
-// #define SKIP_Erase
-// #define SKIP_Combo_vombo
-// #define SKIP_Exception
-//
-//===========================================================
+  int value_;
+};
 
 int main() {
   int const COUNT = 15;
@@ -856,5 +469,1939 @@ int main() {
   std::cout << "[SKIPPED] Exception" << std::endl;
 #endif // SKIP_Exception
 
+#ifndef SKIP_Allocator
+  {
+    PoolAllocator<int> allocator;
+    BiDirectionalList<int, PoolAllocator<int>> my_list(allocator);
+    std::list<int> true_list;
+    assert(my_list.GetAllocator() == allocator);
+    for (int round = 0; round < 3; round++) {
+      for (int i = 0; i < COUNT * 10; i++) {
+        int temp = rand();
+        if (temp % 2 == 0) {
+          my_list.PushBack(temp);
+          true_list.push_back(temp);
+        } else {
+          my_list.PushFront(temp);
+          true_list.push_front(temp);
+        }
+      }
+      for (int i = 0; i < COUNT * 5; i++) {
+        my_list.PopFront();
+        true_list.pop_front();
+        my_list.PopBack();
+        true_list.pop_back();
+      }
+      assert(std::vector<int>(true_list.begin(), true_list.end()) ==
+          my_list.AsArray());
+    }
+
+    // В установившемся режиме вставки и удаления обходятся без кучи: узлы
+    // берутся из списка свободных ячеек.
+    size_t blocks = allocator.BlockCount();
+    assert(blocks > 0);
+    for (int round = 0; round < 100; round++) {
+      for (int i = 0; i < COUNT * 5; i++) {
+        my_list.PushBack(i);
+        my_list.EmplaceFront(i);
+      }
+      for (int i = 0; i < COUNT * 5; i++) {
+        my_list.Erase(my_list.begin());
+        my_list.PopBack();
+      }
+    }
+    assert(allocator.BlockCount() == blocks);
+    my_list.Clear();
+    assert(my_list.IsEmpty());
+    BiDirectionalList<std::string, PoolAllocator<std::string>> strings;
+    for (int i = 0; i < COUNT; i++) {
+      strings.PushBack(std::string(100, 'a' + i));
+    }
+    strings.Erase(strings.Find(std::string(100, 'a' + 3)));
+    assert(strings.AsArray().size() == COUNT - 1);
+    std::cout << "[PASS] Allocator" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Allocator" << std::endl;
+#endif // SKIP_Allocator
+
+#ifndef SKIP_Move_semantics
+  {
+    BiDirectionalList<CopyCounter> my_list;
+    CopyCounter::copies = CopyCounter::moves = 0;
+    for (int i = 0; i < COUNT; i++) {
+      my_list.PushBack(CopyCounter(i, std::string(50, 'x')));
+      my_list.PushFront(CopyCounter(-i, "front"));
+    }
+    my_list.InsertBefore(my_list.begin(), CopyCounter(100, "before"));
+    my_list.InsertAfter(my_list.begin(), CopyCounter(101, "after"));
+    assert(CopyCounter::copies == 0);
+    assert(CopyCounter::moves == 2 * COUNT + 2);
+    CopyCounter::moves = 0;
+    auto iter = my_list.EmplaceBack(7, "emplaced");
+    assert(iter->first_ == 7 && iter->second_ == "emplaced");
+    assert(my_list.EmplaceFront(8, "front")->first_ == 8);
+    auto iter2 = my_list.EmplaceBefore(iter, 9, "before");
+    assert((++iter2)->first_ == 7);
+    auto iter3 = my_list.EmplaceAfter(my_list.begin(), 10, "after");
+    assert((--iter3)->first_ == 8);
+    auto iter4 = my_list.EmplaceBefore(my_list.end(), 11, "at end");
+    assert(iter4->first_ == 11 && (--my_list.end())->first_ == 11);
+    my_list.InsertBefore(my_list.end(), CopyCounter(12, "at end"));
+    assert((--my_list.end())->first_ == 12);
+    bool exception_catched = false;
+    try {
+      my_list.EmplaceAfter(my_list.end(), 13, "after end");
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    assert(CopyCounter::copies == 0 && CopyCounter::moves == 1);
+    std::string moved_from(1000, 'm');
+    BiDirectionalList<std::string> strings;
+    strings.PushBack(std::move(moved_from));
+    assert(*strings.begin() == std::string(1000, 'm'));
+    std::cout << "[PASS] Move semantics" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Move semantics" << std::endl;
+#endif // SKIP_Move_semantics
+
+#ifndef SKIP_Size
+  {
+    BiDirectionalList<int> my_list;
+    assert(my_list.Size() == 0);
+    for (int i = 0; i < COUNT; i++) {
+      my_list.PushBack(i);
+      my_list.PushFront(i);
+      assert(my_list.Size() == static_cast<size_t>(2 * i + 2));
+    }
+    my_list.InsertBefore(my_list.Find(3), 100);
+    my_list.InsertAfter(my_list.Find(3), 101);
+    my_list.EmplaceBack(102);
+    assert(my_list.Size() == 2 * COUNT + 3);
+    my_list.Erase(my_list.Find(100));
+    my_list.PopBack();
+    my_list.PopFront();
+    assert(my_list.Size() == 2 * COUNT);
+    assert(my_list.Size() == my_list.AsArray().size());
+    my_list.Clear();
+    assert(my_list.Size() == 0);
+    std::cout << "[PASS] Size" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Size" << std::endl;
+#endif // SKIP_Size
+
+#ifndef SKIP_Clear
+  {
+    BiDirectionalList<int, PoolAllocator<int>> pooled_list;
+    BiDirectionalList<std::string, PoolAllocator<std::string>> strings;
+    BiDirectionalList<int> my_list;
+    for (int round = 0; round < 3; round++) {
+      for (int i = 0; i < COUNT * 100; i++) {
+        pooled_list.PushBack(i);
+        strings.PushFront(std::string(40, 'a' + i % 26));
+        my_list.PushBack(i);
+      }
+      assert(pooled_list.Size() == COUNT * 100);
+      pooled_list.Clear();
+      strings.Clear();
+      my_list.Clear();
+      assert(pooled_list.IsEmpty() && pooled_list.Size() == 0);
+      assert(strings.IsEmpty() && strings.Size() == 0);
+      assert(my_list.IsEmpty() && my_list.Size() == 0);
+      assert(pooled_list.begin() == pooled_list.end());
+    }
+    PoolAllocator<int> shared_allocator;
+    BiDirectionalList<int, PoolAllocator<int>> first_list(shared_allocator);
+    BiDirectionalList<int, PoolAllocator<int>> second_list(shared_allocator);
+    for (int i = 0; i < COUNT; i++) {
+      first_list.PushBack(i);
+      second_list.PushBack(i);
+    }
+    first_list.Clear();
+    std::vector<int> checker(COUNT);
+    std::iota(checker.begin(), checker.end(), 0);
+    assert(checker == second_list.AsArray());
+    std::cout << "[PASS] Clear" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Clear" << std::endl;
+#endif // SKIP_Clear
+
+#ifndef SKIP_Template_predicates
+  {
+    BiDirectionalList<int> my_list;
+    for (int i = 0; i < COUNT; i++) {
+      my_list.PushBack(i % 5);
+    }
+    auto is_three = [](const int& value) {
+      return value == 3;
+    };
+    auto is_negative = [](const int& value) {
+      return value < 0;
+    };
+    std::function<bool(const int&)> is_four = [](const int& value) {
+      return value == 4;
+    };
+    BiDirectionalList<int>::Iterator first = my_list.Find(is_three);
+    BiDirectionalList<int>::Iterator last = my_list.FindLast(is_three);
+    assert(*first == 3 && *last == 3 && first != last);
+    assert(++last == my_list.end() || *last == 4);
+    assert(*my_list.Find(is_four) == 4);
+    assert(my_list.Find(is_negative) == my_list.end());
+    assert(my_list.FindLast(is_negative) == my_list.end());
+    std::vector<BiDirectionalList<int>::Iterator> all_threes =
+        my_list.FindAll(is_three);
+    assert(all_threes.size() == COUNT / 5);
+    for (const auto& iter : all_threes) {
+      assert(*iter == 3);
+    }
+    const BiDirectionalList<int>& const_list = my_list;
+    assert(*const_list.Find(is_three) == 3);
+    assert(const_list.FindAll(is_negative).empty());
+    assert(const_list.CountIf(is_three) == COUNT / 5);
+    assert(const_list.CountIf(is_four) == COUNT / 5);
+    assert(my_list.RemoveIf(is_three) == COUNT / 5);
+    assert(my_list.CountIf(is_three) == 0);
+    assert(my_list.Size() == COUNT - COUNT / 5);
+    assert(my_list.RemoveIf([](const int&) { return true; }) ==
+        COUNT - COUNT / 5);
+    assert(my_list.IsEmpty());
+    std::cout << "[PASS] Template predicates" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Template predicates" << std::endl;
+#endif // SKIP_Template_predicates
+
+#ifndef SKIP_Unrolled
+  {
+    UnrolledBiDirectionalList<int, 4> my_list;
+    std::list<int> true_list;
+    assert(my_list.IsEmpty());
+    for (int i = 0; i < COUNT * 20; i++) {
+      int temp = rand();
+      switch (temp % 6) {
+        case 0:
+          my_list.PushBack(temp);
+          true_list.push_back(temp);
+          break;
+        case 1:
+          my_list.PushFront(temp);
+          true_list.push_front(temp);
+          break;
+        case 2: {
+          auto iter = my_list.begin();
+          auto true_iter = true_list.begin();
+          for (int j = 0; j < temp % (COUNT + 1) && iter != my_list.end();
+               j++) {
+            ++iter;
+            ++true_iter;
+          }
+          assert(*my_list.InsertBefore(iter, temp) == temp);
+          true_list.insert(true_iter, temp);
+          break;
+        }
+        case 3:
+          if (!true_list.empty()) {
+            auto iter = my_list.InsertAfter(--my_list.end(), temp);
+            assert(*iter == temp && ++iter == my_list.end());
+            true_list.push_back(temp);
+          }
+          break;
+        case 4:
+          if (!true_list.empty()) {
+            int value = *std::next(true_list.begin(),
+                                   temp % true_list.size());
+            auto iter = my_list.Erase(my_list.Find(value));
+            auto true_iter = true_list.erase(
+                std::find(true_list.begin(), true_list.end(), value));
+            assert(true_iter == true_list.end() ? iter == my_list.end()
+                                                : *iter == *true_iter);
+          }
+          break;
+        default:
+          if (!true_list.empty()) {
+            my_list.PopBack();
+            true_list.pop_back();
+          }
+      }
+      assert(my_list.Size() == true_list.size());
+      assert(std::vector<int>(true_list.begin(), true_list.end()) ==
+          my_list.AsArray());
+    }
+    std::vector<int> backwards;
+    for (auto iter = my_list.end(); iter != my_list.begin();) {
+      backwards.push_back(*--iter);
+    }
+    assert(std::equal(backwards.begin(), backwards.end(),
+                      true_list.rbegin(), true_list.rend()));
+    const UnrolledBiDirectionalList<int, 4>& const_list = my_list;
+    if (!true_list.empty()) {
+      assert(*const_list.Find(true_list.back()) == true_list.back());
+    }
+    assert(const_list.Find([](const int& value) { return value < 0; }) ==
+        const_list.end());
+    while (!my_list.IsEmpty()) {
+      my_list.PopFront();
+    }
+    try {
+      my_list.PopFront();
+    } catch (std::runtime_error &ex) {
+      assert(static_cast<std::string>(ex.what()) ==
+          "Impossible to delete element from empty list");
+    }
+    UnrolledBiDirectionalList<std::string> strings;
+    for (int i = 0; i < COUNT * 10; i++) {
+      strings.PushBack(std::string(30, 'a' + i % 26));
+    }
+    assert(strings.Find(std::string(30, 'c')) != strings.end());
+    strings.Clear();
+    assert(strings.IsEmpty() && strings.begin() == strings.end());
+    std::cout << "[PASS] Unrolled" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Unrolled" << std::endl;
+#endif // SKIP_Unrolled
+
+#ifndef SKIP_Copy_and_move
+  {
+    BiDirectionalList<int, PoolAllocator<int>> my_list;
+    std::vector<int> checker;
+    for (int i = 0; i < COUNT; i++) {
+      int temp = rand();
+      my_list.PushBack(temp);
+      checker.push_back(temp);
+    }
+    BiDirectionalList<int, PoolAllocator<int>> copy(my_list);
+    assert(copy.AsArray() == checker && copy.Size() == my_list.Size());
+    copy.PopFront();
+    assert(my_list.AsArray() == checker);
+    BiDirectionalList<int, PoolAllocator<int>> moved(std::move(copy));
+    assert(copy.IsEmpty() && copy.Size() == 0);
+    assert(moved.Size() == COUNT - 1);
+    assert(moved.AsArray() ==
+        std::vector<int>(checker.begin() + 1, checker.end()));
+    copy.PushBack(1);
+    assert(copy.AsArray() == std::vector<int>{1});
+    moved = my_list;
+    assert(moved.AsArray() == checker);
+    BiDirectionalList<int, PoolAllocator<int>> longer;
+    for (int i = 0; i < 2 * COUNT; i++) {
+      longer.PushBack(i);
+    }
+    longer = my_list;
+    assert(longer.AsArray() == checker && longer.Size() == COUNT);
+    assert(*--longer.end() == checker.back());
+    copy = longer;
+    assert(copy.AsArray() == checker && copy.Size() == COUNT);
+    longer = std::move(copy);
+    assert(longer.AsArray() == checker && copy.IsEmpty());
+    longer = longer;
+    assert(longer.AsArray() == checker);
+
+    std::vector<BiDirectionalList<std::string>> lists;
+    for (int i = 0; i < COUNT; i++) {
+      lists.push_back(MakeStringList(i));
+    }
+    for (int i = 0; i < COUNT; i++) {
+      assert(lists[i].Size() == static_cast<size_t>(i));
+    }
+    BiDirectionalList<std::string> strings = lists.back();
+    strings = MakeStringList(3);
+    assert(strings.AsArray() == (std::vector<std::string>{"0", "1", "2"}));
+    std::cout << "[PASS] Copy and move" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Copy and move" << std::endl;
+#endif // SKIP_Copy_and_move
+
+#ifndef SKIP_Splice
+  {
+    PoolAllocator<int> allocator;
+    BiDirectionalList<int, PoolAllocator<int>> first_list(allocator);
+    BiDirectionalList<int, PoolAllocator<int>> second_list(allocator);
+    for (int i = 0; i < 5; i++) {
+      first_list.PushBack(i);
+      second_list.PushBack(i + 10);
+    }
+    first_list.Splice(first_list.Find(2), second_list);
+    std::vector<int> checker = {0, 1, 10, 11, 12, 13, 14, 2, 3, 4};
+    assert(first_list.AsArray() == checker && second_list.IsEmpty());
+    assert(first_list.Size() == 10 && second_list.Size() == 0);
+    second_list.Splice(second_list.end(), first_list, first_list.Find(12));
+    second_list.Splice(second_list.begin(), first_list, first_list.begin());
+    second_list.Splice(second_list.end(), first_list, --first_list.end());
+    checker = {1, 10, 11, 13, 14, 2, 3};
+    assert(first_list.AsArray() == checker && first_list.Size() == 7);
+    assert(second_list.AsArray() == (std::vector<int>{0, 12, 4}));
+    assert(second_list.Size() == 3);
+    second_list.Splice(second_list.Find(12), first_list, first_list.Find(10),
+                       first_list.Find(2));
+    assert(first_list.AsArray() == (std::vector<int>{1, 2, 3}));
+    assert(second_list.AsArray() == (std::vector<int>{0, 10, 11, 13, 14, 12,
+                                                      4}));
+    assert(first_list.Size() == 3 && second_list.Size() == 7);
+    second_list.Splice(second_list.begin(), second_list,
+                       second_list.Find(13), second_list.end());
+    assert(second_list.AsArray() == (std::vector<int>{13, 14, 12, 4, 0, 10,
+                                                      11}));
+    second_list.Splice(second_list.end(), second_list, second_list.begin());
+    assert(second_list.AsArray() == (std::vector<int>{14, 12, 4, 0, 10, 11,
+                                                      13}));
+    assert(*--second_list.end() == 13 && second_list.Size() == 7);
+
+    BiDirectionalList<int, PoolAllocator<int>> tail =
+        second_list.SplitAt(second_list.Find(0));
+    assert(second_list.AsArray() == (std::vector<int>{14, 12, 4}));
+    assert(tail.AsArray() == (std::vector<int>{0, 10, 11, 13}));
+    assert(second_list.Size() == 3 && tail.Size() == 4);
+    assert(second_list.SplitAt(second_list.end()).IsEmpty());
+    BiDirectionalList<int, PoolAllocator<int>> whole =
+        tail.SplitAt(tail.begin());
+    assert(tail.IsEmpty() && whole.Size() == 4);
+
+    BiDirectionalList<int, PoolAllocator<int>> merged(allocator);
+    BiDirectionalList<int, PoolAllocator<int>> other(allocator);
+    for (int i = 0; i < COUNT; i++) {
+      merged.PushBack(i * 2);
+      other.PushBack(i * 3);
+    }
+    merged.Merge(other);
+    checker.clear();
+    for (int i = 0; i < COUNT; i++) {
+      checker.push_back(i * 2);
+      checker.push_back(i * 3);
+    }
+    std::sort(checker.begin(), checker.end());
+    assert(merged.AsArray() == checker && other.IsEmpty());
+    assert(merged.Size() == 2 * COUNT && *--merged.end() == checker.back());
+    other.PushBack(100);
+    merged.Merge(other, [](const int& left, const int& right) {
+      return left > right;
+    });
+    assert(*merged.begin() == 100);
+
+    // Исключение из сравнения оставляет оба списка с верными размерами.
+    for (int throw_at : {1, 4, COUNT}) {
+      BiDirectionalList<int, PoolAllocator<int>> left(allocator);
+      BiDirectionalList<int, PoolAllocator<int>> right(allocator);
+      for (int i = 0; i < COUNT; i++) {
+        left.PushBack(i * 2 + 1);
+        right.PushBack(i * 2);
+      }
+      int calls = 0;
+      bool exception_catched = false;
+      try {
+        left.Merge(right, [&calls, throw_at](int first, int second) {
+          if (++calls == throw_at) {
+            throw std::runtime_error("comparison failed");
+          }
+          return first < second;
+        });
+      } catch (const std::runtime_error&) {
+        exception_catched = true;
+      }
+      assert(exception_catched);
+      assert(left.Size() == static_cast<size_t>(
+          std::distance(left.begin(), left.end())));
+      assert(right.Size() == static_cast<size_t>(
+          std::distance(right.begin(), right.end())));
+      assert(left.Size() + right.Size() == 2 * COUNT);
+      assert(left.AsArray().size() == left.Size());
+      std::vector<int> merged_values = left.AsArray();
+      assert(std::is_sorted(merged_values.begin(), merged_values.end()));
+    }
+
+    BiDirectionalList<int, PoolAllocator<int>> foreign;
+    foreign.PushBack(1);
+    try {
+      merged.Splice(merged.end(), foreign);
+    } catch (std::runtime_error &ex) {
+      assert(static_cast<std::string>(ex.what()) ==
+          "Impossible to move nodes between lists with different allocators");
+    }
+    try {
+      merged.Splice(merged.end(), merged, merged.end());
+    } catch (std::runtime_error &ex) {
+      assert(static_cast<std::string>(ex.what()) ==
+          "Impossible to splice end");
+    }
+    std::cout << "[PASS] Splice" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Splice" << std::endl;
+#endif // SKIP_Splice
+
+#ifndef SKIP_Sort
+  {
+    for (int count : {0, 1, 2, 3, COUNT, COUNT * 33 + 7}) {
+      BiDirectionalList<std::pair<int, int>> my_list;
+      std::vector<std::pair<int, int>> checker;
+      for (int i = 0; i < count; i++) {
+        std::pair<int, int> temp(rand() % 10, i);
+        my_list.PushBack(temp);
+        checker.push_back(temp);
+      }
+      BiDirectionalList<std::pair<int, int>>::Iterator first =
+          my_list.begin();
+      auto by_key = [](const std::pair<int, int>& left,
+                       const std::pair<int, int>& right) {
+        return left.first < right.first;
+      };
+      my_list.Sort(by_key);
+      std::stable_sort(checker.begin(), checker.end(), by_key);
+      assert(checker == my_list.AsArray());
+      assert(my_list.Size() == static_cast<size_t>(count));
+      std::vector<std::pair<int, int>> backwards;
+      for (auto iter = my_list.end(); iter != my_list.begin();) {
+        backwards.push_back(*--iter);
+      }
+      assert(std::equal(backwards.rbegin(), backwards.rend(),
+                        checker.begin(), checker.end()));
+      if (count > 0) {
+        assert(std::find(checker.begin(), checker.end(), *first) !=
+            checker.end());
+      }
+    }
+    BiDirectionalList<int> my_list;
+    std::vector<int> checker;
+    for (int i = 0; i < COUNT * 10; i++) {
+      int temp = rand() % COUNT;
+      my_list.PushFront(temp);
+      checker.push_back(temp);
+    }
+    my_list.Sort();
+    std::sort(checker.begin(), checker.end());
+    assert(checker == my_list.AsArray());
+    size_t removed = my_list.Unique();
+    checker.erase(std::unique(checker.begin(), checker.end()), checker.end());
+    assert(checker == my_list.AsArray());
+    assert(removed == COUNT * 10 - checker.size());
+    assert(my_list.Size() == checker.size());
+    my_list.Reverse();
+    std::reverse(checker.begin(), checker.end());
+    assert(checker == my_list.AsArray());
+    assert(*my_list.begin() == checker.front());
+    assert(*--my_list.end() == checker.back());
+    my_list.Sort(std::greater<int>());
+    assert(checker == my_list.AsArray());
+    assert(my_list.Unique([](const int&, const int&) { return true; }) ==
+        checker.size() - 1);
+    assert(my_list.Size() == 1 && *my_list.begin() == checker.front());
+
+    // Исключение из сравнения оставляет в списке все элементы.
+    for (int throw_at : {1, 60, 150, 400}) {
+      BiDirectionalList<int> partial;
+      for (int i = 0; i < 100; i++) {
+        partial.PushBack(rand() % COUNT);
+      }
+      std::vector<int> elements = partial.AsArray();
+      int calls = 0;
+      bool exception_catched = false;
+      try {
+        partial.Sort([&calls, throw_at](int left, int right) {
+          if (++calls == throw_at) {
+            throw std::runtime_error("comparison failed");
+          }
+          return left < right;
+        });
+      } catch (const std::runtime_error&) {
+        exception_catched = true;
+      }
+      assert(exception_catched);
+      std::vector<int> after = partial.AsArray();
+      std::vector<int> backwards;
+      for (auto iter = partial.end(); iter != partial.begin();) {
+        backwards.push_back(*--iter);
+      }
+      assert(partial.Size() == elements.size());
+      assert(std::equal(backwards.rbegin(), backwards.rend(), after.begin(),
+                        after.end()));
+      std::sort(elements.begin(), elements.end());
+      std::sort(after.begin(), after.end());
+      assert(after == elements);
+    }
+    std::cout << "[PASS] Sort" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Sort" << std::endl;
+#endif // SKIP_Sort
+
+#ifndef SKIP_Export
+  {
+    BiDirectionalList<int> my_list;
+    std::vector<int> checker;
+    for (int i = 0; i < COUNT; i++) {
+      int temp = rand();
+      my_list.PushBack(temp);
+      checker.push_back(temp);
+    }
+    assert(my_list.AsArray().capacity() == COUNT);
+    std::vector<int> buffer(COUNT + 5, -1);
+    assert(my_list.CopyTo(std::span<int>(buffer)) == COUNT);
+    assert(std::equal(checker.begin(), checker.end(), buffer.begin()));
+    assert(buffer[COUNT] == -1);
+    int raw_buffer[COUNT];
+    assert(my_list.CopyTo(raw_buffer) == raw_buffer + COUNT);
+    assert(std::equal(checker.begin(), checker.end(), raw_buffer));
+    std::vector<int> small_buffer(COUNT - 1);
+    try {
+      my_list.CopyTo(std::span<int>(small_buffer));
+    } catch (std::runtime_error &ex) {
+      assert(static_cast<std::string>(ex.what()) ==
+          "Impossible to copy list into smaller buffer");
+    }
+    assert(std::move(my_list).AsArray() == checker);
+    assert(my_list.IsEmpty());
+    BiDirectionalList<CopyCounter> counters;
+    for (int i = 0; i < COUNT; i++) {
+      counters.EmplaceBack(i, std::string(40, 'c'));
+    }
+    CopyCounter::copies = 0;
+    std::vector<CopyCounter> exported = std::move(counters).AsArray();
+    assert(CopyCounter::copies == 0 && exported.size() == COUNT);
+    assert(exported.back().second_ == std::string(40, 'c'));
+    std::cout << "[PASS] Export" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Export" << std::endl;
+#endif // SKIP_Export
+
+#ifndef SKIP_Iterator_policy
+  {
+    using UncheckedList =
+        BiDirectionalList<int, std::allocator<int>, UncheckedIterators>;
+    static_assert(std::is_trivially_copyable_v<UncheckedList::Iterator>);
+    static_assert(std::is_trivially_copyable_v<UncheckedList::ConstIterator>);
+    static_assert(std::is_trivially_copyable_v<BiDirectionalList<int>::
+        Iterator>);
+    UncheckedList my_list;
+    std::list<int> true_list;
+    for (int i = 0; i < COUNT; i++) {
+      int temp = rand();
+      my_list.PushBack(temp);
+      true_list.push_back(temp);
+    }
+    assert(std::equal(my_list.begin(), my_list.end(), true_list.begin(),
+                      true_list.end()));
+    const UncheckedList& const_list = my_list;
+    assert(std::equal(const_list.begin(), const_list.end(),
+                      true_list.begin(), true_list.end()));
+    UncheckedList::Iterator iter = my_list.end();
+    auto true_iter = true_list.end();
+    for (int i = 0; i < COUNT; i++) {
+      --iter;
+      --true_iter;
+      assert(*iter == *true_iter);
+    }
+    assert(iter == my_list.begin());
+    iter = my_list.Find(true_list.back());
+    assert(iter++ != my_list.end() && iter == my_list.end());
+    --iter;
+    assert(*iter == true_list.back());
+    long long sum = 0;
+    for (int value : my_list) {
+      sum += value;
+    }
+    assert(sum == std::accumulate(true_list.begin(), true_list.end(), 0LL));
+    my_list.PopBack();
+    my_list.PopFront();
+    assert(my_list.Size() == COUNT - 2);
+    std::cout << "[PASS] Iterator policy" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Iterator policy" << std::endl;
+#endif // SKIP_Iterator_policy
+
+#ifndef SKIP_Concurrent_deque
+  {
+    ConcurrentDeque<int> deque;
+    std::deque<int> true_deque;
+    assert(deque.IsEmpty() && !deque.PopBack() && !deque.PopFront());
+    for (int i = 0; i < COUNT * 20; i++) {
+      int temp = rand();
+      switch (temp % 4) {
+        case 0:
+          deque.PushBack(temp);
+          true_deque.push_back(temp);
+          break;
+        case 1:
+          deque.PushFront(temp);
+          true_deque.push_front(temp);
+          break;
+        case 2:
+          if (true_deque.empty()) {
+            assert(!deque.PopBack());
+          } else {
+            assert(deque.PopBack() == true_deque.back());
+            true_deque.pop_back();
+          }
+          break;
+        default:
+          if (true_deque.empty()) {
+            assert(!deque.PopFront());
+          } else {
+            assert(deque.PopFront() == true_deque.front());
+            true_deque.pop_front();
+          }
+      }
+    }
+    while (!true_deque.empty()) {
+      assert(deque.PopFront() == true_deque.front());
+      true_deque.pop_front();
+    }
+    assert(deque.IsEmpty());
+
+    // По потоку на ядро, но не меньше двух, чтобы потоки соперничали.
+    const int kThreads = static_cast<int>(
+        std::max(2u, std::thread::hardware_concurrency()));
+    const int kOperations = COUNT * 2000;
+    ConcurrentDeque<std::string> shared;
+    std::atomic<long long> pushed_sum(0);
+    std::atomic<long long> popped_sum(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([&, t]() {
+        long long local_pushed = 0;
+        long long local_popped = 0;
+        for (int i = 0; i < kOperations; i++) {
+          int value = t * kOperations + i;
+          switch ((i + t) % 4) {
+            case 0:
+              shared.PushBack(std::to_string(value));
+              local_pushed += value;
+              break;
+            case 1:
+              shared.PushFront(std::to_string(value));
+              local_pushed += value;
+              break;
+            case 2:
+              if (auto popped = shared.PopBack()) {
+                local_popped += std::stoll(*popped);
+              }
+              break;
+            default:
+              if (auto popped = shared.PopFront()) {
+                local_popped += std::stoll(*popped);
+              }
+          }
+        }
+        pushed_sum += local_pushed;
+        popped_sum += local_popped;
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    while (auto popped = shared.PopBack()) {
+      popped_sum += std::stoll(*popped);
+    }
+    assert(pushed_sum == popped_sum);
+    assert(shared.IsEmpty());
+    for (int i = 0; i < COUNT; i++) {
+      shared.PushBack(std::string(40, 'z'));
+    }
+    std::cout << "[PASS] Concurrent deque" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Concurrent deque" << std::endl;
+#endif // SKIP_Concurrent_deque
+
+#ifndef SKIP_Work_stealing
+  {
+    WorkStealingDeque<std::string> deque(2);
+    assert(deque.IsEmpty());
+    assert(!deque.PopBack().has_value());
+    assert(!deque.Steal().has_value());
+    for (int i = 0; i < COUNT; i++) {
+      deque.PushBack(std::to_string(i));
+    }
+    assert(deque.Size() == COUNT);
+    assert(deque.Steal() == "0");
+    assert(deque.PopBack() == std::to_string(COUNT - 1));
+    assert(deque.Size() == COUNT - 2);
+    for (int i = COUNT - 2; i >= 1; i--) {
+      assert(deque.PopBack() == std::to_string(i));
+    }
+    assert(deque.IsEmpty());
+    assert(!deque.PopBack().has_value());
+
+    WorkStealingDeque<int> numbers(2);
+    for (int i = 0; i < COUNT; i++) {
+      numbers.PushBack(i);
+    }
+    assert(numbers.Steal() == 0 && numbers.Steal() == 1);
+    assert(numbers.PopBack() == COUNT - 1);
+    assert(numbers.Size() == COUNT - 3);
+
+    const int kThieves = 3;
+    const int kTasks = COUNT * 2000;
+    WorkStealingDeque<int> tasks;
+    std::vector<std::atomic<int>> taken(kTasks);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < kThieves; t++) {
+      thieves.emplace_back([&]() {
+        while (!done.load()) {
+          if (auto task = tasks.Steal()) {
+            taken[*task]++;
+          }
+        }
+      });
+    }
+    for (int i = 0; i < kTasks; i++) {
+      tasks.PushBack(i);
+      if (i % 3 == 0) {
+        if (auto task = tasks.PopBack()) {
+          taken[*task]++;
+        }
+      }
+    }
+    while (auto task = tasks.PopBack()) {
+      taken[*task]++;
+    }
+    done = true;
+    for (auto& thief : thieves) {
+      thief.join();
+    }
+    assert(std::all_of(taken.begin(), taken.end(),
+                       [](const std::atomic<int>& count) {
+                         return count.load() == 1;
+                       }));
+
+    WorkStealingDeque<std::string> leftover;
+    for (int i = 0; i < COUNT; i++) {
+      leftover.PushBack(std::string(40, 'w'));
+    }
+    std::cout << "[PASS] Work stealing" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Work stealing" << std::endl;
+#endif // SKIP_Work_stealing
+
+#ifndef SKIP_Fine_grained
+  {
+    FineGrainedBiDirectionalList<std::string> list;
+    assert(list.IsEmpty());
+    assert(!list.PopBack().has_value());
+    assert(!list.PopFront().has_value());
+    for (int i = 0; i < COUNT; i++) {
+      list.PushBack(std::to_string(i));
+    }
+    list.PushFront("front");
+    assert(list.Size() == COUNT + 1);
+    assert(list.Contains("7"));
+    assert(!list.Contains("-1"));
+    assert(list.Find([](const std::string& value) {
+      return value.size() == 2;
+    }) == "10");
+    assert(list.InsertBefore([](const std::string& value) {
+      return value == "0";
+    }, "before"));
+    assert(list.InsertAfter([](const std::string& value) {
+      return value == std::to_string(COUNT - 1);
+    }, "after"));
+    assert(!list.InsertAfter([](const std::string&) { return false; }, "x"));
+    assert(list.Erase("5"));
+    assert(!list.Erase("5"));
+    std::vector<std::string> expected{"front", "before"};
+    for (int i = 0; i < COUNT; i++) {
+      if (i != 5) {
+        expected.push_back(std::to_string(i));
+      }
+    }
+    expected.push_back("after");
+    assert(list.AsArray() == expected);
+    assert(list.PopFront() == "front");
+    assert(list.PopBack() == "after");
+    assert(list.Size() == expected.size() - 2);
+
+    const int kThreads = 4;
+    const int kOperations = COUNT * 200;
+    FineGrainedBiDirectionalList<int> shared;
+    std::atomic<long long> pushed_sum(0);
+    std::atomic<long long> popped_sum(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([&, t]() {
+        long long local_pushed = 0;
+        long long local_popped = 0;
+        for (int i = 0; i < kOperations; i++) {
+          int value = t * kOperations + i;
+          switch ((i + t) % 6) {
+            case 0:
+              shared.PushBack(value);
+              local_pushed += value;
+              break;
+            case 1:
+              shared.PushFront(value);
+              local_pushed += value;
+              break;
+            case 2:
+              if (shared.InsertBefore([t](int element) {
+                return element % kThreads == t;
+              }, value)) {
+                local_pushed += value;
+              }
+              break;
+            case 3:
+              if (auto popped = shared.PopBack()) {
+                local_popped += *popped;
+              }
+              break;
+            case 4:
+              if (auto popped = shared.PopFront()) {
+                local_popped += *popped;
+              }
+              break;
+            default:
+              if (auto found = shared.Find([t](int element) {
+                return element % kThreads == (t + 1) % kThreads;
+              })) {
+                if (shared.Erase(*found)) {
+                  local_popped += *found;
+                }
+              }
+          }
+        }
+        pushed_sum += local_pushed;
+        popped_sum += local_popped;
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (int value : shared.AsArray()) {
+      popped_sum += value;
+    }
+    assert(pushed_sum == popped_sum);
+    size_t remaining = shared.Size();
+    assert(shared.AsArray().size() == remaining);
+    while (shared.PopFront()) {
+      remaining--;
+    }
+    assert(remaining == 0 && shared.IsEmpty());
+    std::cout << "[PASS] Fine grained" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Fine grained" << std::endl;
+#endif // SKIP_Fine_grained
+
+#ifndef SKIP_Intrusive
+  {
+    std::deque<Timer> arena;
+    for (int i = 0; i < COUNT; i++) {
+      arena.emplace_back(i);
+    }
+    IntrusiveBiDirectionalList<Timer, &Timer::by_deadline_> timers;
+    IntrusiveBiDirectionalList<Timer, &Timer::expired_> expired;
+    assert(timers.IsEmpty());
+    for (Timer& timer : arena) {
+      timers.PushBack(timer);
+    }
+    assert(timers.Size() == COUNT);
+    assert(&*timers.begin() == &arena.front());
+    assert(&*--timers.end() == &arena.back());
+
+    timers.Erase(arena[3]);
+    assert(!timers.Contains(arena[3]));
+    assert(timers.Find(Timer(3)) == timers.end());
+    assert(timers.Find(Timer(4)) == timers.IteratorTo(arena[4]));
+    timers.InsertBefore(timers.IteratorTo(arena[0]), arena[3]);
+    assert(timers.begin()->deadline_ == 3);
+    timers.Erase(timers.begin());
+    timers.InsertAfter(timers.IteratorTo(arena[2]), arena[3]);
+
+    for (Timer& timer : arena) {
+      if (timer.deadline_ % 2 == 0) {
+        expired.PushFront(timer);
+      }
+    }
+    assert(expired.Size() == (COUNT + 1) / 2);
+    assert(timers.Size() == COUNT);
+    assert(expired.Find([](const Timer& timer) {
+      return timer.deadline_ == 4;
+    })->by_deadline_.IsLinked());
+
+    bool exception_catched = false;
+    try {
+      timers.PushBack(arena[5]);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    exception_catched = false;
+    try {
+      expired.Erase(arena[1]);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+
+    // Итератор другого списка того же типа не портит ни один из списков.
+    IntrusiveBiDirectionalList<Timer, &Timer::expired_> other_expired;
+    Timer stranger(100);
+    other_expired.PushBack(stranger);
+    Timer newcomer(101);
+    for (int attempt = 0; attempt < 3; attempt++) {
+      exception_catched = false;
+      try {
+        if (attempt == 0) {
+          expired.Erase(other_expired.begin());
+        } else if (attempt == 1) {
+          expired.InsertBefore(other_expired.begin(), newcomer);
+        } else {
+          expired.InsertAfter(other_expired.begin(), newcomer);
+        }
+      } catch (const std::runtime_error&) {
+        exception_catched = true;
+      }
+      assert(exception_catched);
+    }
+    assert(other_expired.Size() == 1 && stranger.expired_.IsLinked());
+    assert(expired.Size() == (COUNT + 1) / 2);
+    assert(!newcomer.expired_.IsLinked());
+    other_expired.Clear();
+
+    int expected = 0;
+    for (const Timer& timer : std::as_const(timers)) {
+      assert(timer.deadline_ == expected++);
+    }
+    timers.PopFront();
+    timers.PopBack();
+    assert(!arena.front().by_deadline_.IsLinked());
+    assert(!arena.back().by_deadline_.IsLinked());
+    assert(timers.Size() == COUNT - 2);
+
+    Timer copy = arena[4];
+    assert(!copy.by_deadline_.IsLinked() && !copy.expired_.IsLinked());
+    timers.Clear();
+    assert(timers.IsEmpty());
+    assert(!arena[4].by_deadline_.IsLinked());
+    assert(arena[4].expired_.IsLinked());
+    std::cout << "[PASS] Intrusive" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Intrusive" << std::endl;
+#endif // SKIP_Intrusive
+
+#ifndef SKIP_Lru_cache
+  {
+    LruCache<int, std::string> cache(3);
+    assert(cache.IsEmpty());
+    assert(cache.Get(1) == nullptr);
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    cache.Put(3, "three");
+    assert((cache.Keys() == std::vector<int>{3, 2, 1}));
+    assert(*cache.Get(1) == "one");
+    assert((cache.Keys() == std::vector<int>{1, 3, 2}));
+    cache.Put(4, "four");
+    assert(!cache.Contains(2));
+    assert((cache.Keys() == std::vector<int>{4, 1, 3}));
+    cache.Put(3, "THREE");
+    assert(*cache.Peek(3) == "THREE");
+    assert((cache.Keys() == std::vector<int>{3, 4, 1}));
+    assert(cache.Erase(4));
+    assert(!cache.Erase(4));
+    assert(cache.Size() == 2);
+    auto counters = cache.GetCounters();
+    assert(counters.hits_ == 1);
+    assert(counters.misses_ == 1);
+    assert(counters.evictions_ == 1);
+    cache.ResetCounters();
+    assert(cache.GetCounters().hits_ == 0);
+
+    std::string* stable = cache.Get(1);
+    for (int i = 0; i < COUNT; i++) {
+      cache.Get(i % 2 == 0 ? 1 : 3);
+    }
+    assert(stable == cache.Get(1));
+
+    bool exception_catched = false;
+
+    // Копия живёт своими узлами и переживает оригинал.
+    auto* original = new LruCache<int, std::string>(cache);
+    LruCache<int, std::string> copy(*original);
+    original->Put(5, "five");
+    delete original;
+    assert(*copy.Get(3) == "THREE");
+    assert((copy.Keys() == std::vector<int>{3, 1}));
+    copy.Put(6, "six");
+    copy.Put(7, "seven");
+    assert(!copy.Contains(1) && copy.Size() == 3);
+    cache = copy;
+    assert(cache.Keys() == copy.Keys());
+    LruCache<int, std::string> moved(std::move(copy));
+    assert(copy.IsEmpty() && !copy.Contains(6));
+    assert(*moved.Get(6) == "six");
+    assert(*cache.Get(7) == "seven");
+
+    // Неудачное копирующее присваивание оставляет кэш прежним.
+    LruCache<int, ThrowingCopy> target(4);
+    LruCache<int, ThrowingCopy> source(4);
+    for (int i = 0; i < 4; i++) {
+      if (i < 2) {
+        target.Put(i, ThrowingCopy(i));
+      }
+      source.Put(i + 10, ThrowingCopy(i + 10));
+    }
+    ThrowingCopy::copies_left = 1;
+    exception_catched = false;
+    try {
+      target = source;
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    ThrowingCopy::copies_left = -1;
+    assert(exception_catched);
+    assert((target.Keys() == std::vector<int>{1, 0}));
+    for (int i = 0; i < 2; i++) {
+      assert(target.Get(i) != nullptr && target.Get(i)->value_ == i);
+    }
+    target.Put(0, ThrowingCopy(100));
+    assert(target.Size() == 2 && target.Get(0)->value_ == 100);
+
+    LruCache<std::string, std::string> by_bytes(
+        100, 10, [](const std::string& key, const std::string& value) {
+          return key.size() + value.size();
+        });
+    by_bytes.Put("a", "1234");
+    by_bytes.Put("b", "1234");
+    assert(by_bytes.Bytes() == 10);
+    by_bytes.Put("c", "1");
+    assert(!by_bytes.Contains("a"));
+    assert(by_bytes.Bytes() == 7);
+    by_bytes.Put("huge", "0123456789");
+    assert(!by_bytes.Contains("huge"));
+    assert(by_bytes.GetCounters().evictions_ == 4);
+    assert(by_bytes.IsEmpty());
+    by_bytes.Clear();
+    assert(by_bytes.IsEmpty() && by_bytes.Bytes() == 0);
+
+    exception_catched = false;
+    try {
+      LruCache<int, int> empty(0);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    std::cout << "[PASS] Lru cache" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Lru cache" << std::endl;
+#endif // SKIP_Lru_cache
+
+#ifndef SKIP_Indexed
+  {
+    IndexedBiDirectionalList<std::string> list;
+    std::list<std::string> true_list;
+    for (int i = 0; i < COUNT; i++) {
+      list.PushBack(std::to_string(i % 5));
+      true_list.push_back(std::to_string(i % 5));
+    }
+    list.PushFront("front");
+    true_list.push_front("front");
+    assert(list.Count("3") == 3);
+    assert(list.Contains("front"));
+    assert(!list.Contains("7"));
+    assert(list.Find("7") == list.end());
+
+    for (int i = 0; i < 5; i++) {
+      auto iter = list.Find(std::to_string(i));
+      assert(*iter == std::to_string(i));
+      list.InsertBefore(iter, "before" + std::to_string(i));
+      list.InsertAfter(iter, "after" + std::to_string(i));
+      list.Erase(iter);
+      auto true_iter = std::find(true_list.begin(), true_list.end(),
+                                 std::to_string(i));
+      true_list.erase(true_iter);
+    }
+    assert(list.Size() == true_list.size() + 10);
+    for (int i = 0; i < 5; i++) {
+      assert(list.Count(std::to_string(i)) ==
+             static_cast<size_t>(std::count(true_list.begin(),
+                                            true_list.end(),
+                                            std::to_string(i))));
+      assert(list.Contains("before" + std::to_string(i)));
+      assert(*++list.Find("before" + std::to_string(i)) ==
+             "after" + std::to_string(i));
+    }
+
+    assert(list.RemoveIf([](const std::string& value) {
+      return value.size() > 1 && value != "front";
+    }) == 10);
+    assert(!list.Contains("after2"));
+    list.PopFront();
+    assert(!list.Contains("front"));
+    true_list.pop_front();
+    std::vector<std::string> values = list.AsArray();
+    std::vector<std::string> true_values(true_list.begin(), true_list.end());
+    std::sort(values.begin(), values.end());
+    std::sort(true_values.begin(), true_values.end());
+    assert(values == true_values);
+
+    IndexedBiDirectionalList<std::string> copy = list;
+    list.Clear();
+    assert(!list.Contains("4"));
+    assert(copy.Count("4") == 2);
+    IndexedBiDirectionalList<std::string> moved = std::move(copy);
+    assert(moved.Count("4") == 2);
+    copy = moved;
+    moved.PopBack();
+    assert(copy.Count("4") == 2 && moved.Count("4") == 1);
+    list = std::move(moved);
+    assert(list.Count("4") == 1 && *list.Find("4") == "4");
+
+    static_assert(std::is_same_v<decltype(*list.begin()),
+                                 const std::string&>);
+    static_assert(std::is_same_v<decltype(*list.Find("4")),
+                                 const std::string&>);
+    auto last = list.FindLast([](const std::string& value) {
+      return value == "4";
+    });
+    assert(last == list.Find("4"));
+    auto all = list.FindAll([](const std::string& value) {
+      return value.size() == 1;
+    });
+    static_assert(std::is_same_v<decltype(*all.front()), const std::string&>);
+    assert(all.size() == list.Size());
+    assert(*list.EmplaceAfter(last, 2, 'x') == "xx");
+    assert(list.Contains("xx") && *++list.Find("4") == "xx");
+    list.Erase(list.Find("xx"));
+    assert(!list.Contains("xx") && list.Size() == all.size());
+
+    std::vector<std::string> moved_values = std::move(list).AsArray();
+    assert(std::count(moved_values.begin(), moved_values.end(), "4") == 1);
+    assert(list.IsEmpty() && !list.Contains("4") && list.Count("4") == 0);
+    list.PushBack("4");
+    assert(list.Count("4") == 1 && list.Size() == 1);
+    std::cout << "[PASS] Indexed" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Indexed" << std::endl;
+#endif // SKIP_Indexed
+
+#ifndef SKIP_Ranked
+  {
+    RankedBiDirectionalList<std::string> list;
+    std::vector<std::string> true_list;
+    uint32_t seed = 12345;
+    auto next_random = [&seed]() {
+      seed = seed * 1103515245 + 12345;
+      return seed >> 8;
+    };
+    for (int i = 0; i < COUNT * 100; i++) {
+      size_t index = next_random() % (true_list.size() + 1);
+      std::string value = std::to_string(i);
+      if (next_random() % 4 == 0 && !true_list.empty()) {
+        index = index % true_list.size();
+        list.Erase(list.IteratorAt(index));
+        true_list.erase(true_list.begin() + index);
+      } else if (index < true_list.size() && next_random() % 2 == 0) {
+        list.InsertAfter(list.IteratorAt(index), value);
+        true_list.insert(true_list.begin() + index + 1, value);
+      } else {
+        list.InsertBefore(list.IteratorAt(index), value);
+        true_list.insert(true_list.begin() + index, value);
+      }
+    }
+    assert(list.Size() == true_list.size());
+    assert(list.AsArray() == true_list);
+    for (size_t i = 0; i < true_list.size(); i++) {
+      assert(list.At(i) == true_list[i]);
+      assert(list.IndexOf(list.IteratorAt(i)) == i);
+    }
+    assert(list.IteratorAt(list.Size()) == list.end());
+    assert(list.IndexOf(list.end()) == list.Size());
+
+    auto iter = list.begin();
+    iter = list.Advance(iter, 10);
+    assert(*iter == true_list[10]);
+    iter = list.Advance(iter, -3);
+    assert(*iter == true_list[7]);
+    assert(list.Advance(iter, list.Size() - 7) == list.end());
+    assert(*--list.end() == true_list.back());
+
+    list.PushFront("front");
+    list.PushBack("back");
+    assert(list.At(0) == "front" && list.At(list.Size() - 1) == "back");
+    assert(list.IndexOf(list.Find("back")) == list.Size() - 1);
+    list.PopFront();
+    list.PopBack();
+    assert(list.AsArray() == true_list);
+
+    const RankedBiDirectionalList<std::string> copy = list;
+    assert(copy.At(5) == true_list[5]);
+    assert(copy.IndexOf(copy.Find(true_list[20])) == 20);
+    assert(*copy.Advance(copy.begin(), 3) == true_list[3]);
+
+    int exception_count = 0;
+    std::vector<std::function<void()>> errors = {
+        [&]() { list.At(list.Size()); },
+        [&]() { list.IteratorAt(list.Size() + 1); },
+        [&]() { list.Advance(list.begin(), -1); },
+        [&]() { list.Advance(list.end(), 1); },
+        [&]() { list.Erase(list.end()); }
+    };
+    for (auto& error : errors) {
+      try {
+        error();
+      } catch (const std::runtime_error&) {
+        exception_count++;
+      }
+    }
+    assert(exception_count == 5);
+    list.Clear();
+    assert(list.IsEmpty() && list.Size() == 0);
+    std::cout << "[PASS] Ranked" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Ranked" << std::endl;
+#endif // SKIP_Ranked
+
+#ifndef SKIP_Simd
+  {
+    uint32_t seed = 777;
+    auto next_random = [&seed]() {
+      seed = seed * 1103515245 + 12345;
+      return static_cast<int>(seed >> 8) % 1000 - 500;
+    };
+    for (size_t size = 0; size < 70; size++) {
+      std::vector<int> ints(size);
+      std::vector<double> doubles(size);
+      std::vector<float> floats(size);
+      for (size_t i = 0; i < size; i++) {
+        ints[i] = next_random() % 20;
+        doubles[i] = ints[i] * 0.5;
+        floats[i] = static_cast<float>(ints[i]);
+      }
+      for (int needle = -20; needle < 20; needle++) {
+        size_t true_index = std::find(ints.begin(), ints.end(), needle) -
+                            ints.begin();
+        assert(SimdScan::Find<int>(ints, needle) == true_index);
+        assert(SimdScan::Find<double>(doubles, needle * 0.5) == true_index);
+        assert(SimdScan::Find<float>(floats, needle) == true_index);
+        size_t true_count = std::count(ints.begin(), ints.end(), needle);
+        assert(SimdScan::Count<int>(ints, needle) == true_count);
+        assert(SimdScan::Count<double>(doubles, needle * 0.5) == true_count);
+      }
+      if (size == 0) {
+        continue;
+      }
+      int true_min = *std::min_element(ints.begin(), ints.end());
+      int true_max = *std::max_element(ints.begin(), ints.end());
+      assert(SimdScan::Min<int>(ints) == true_min);
+      assert(SimdScan::Max<int>(ints) == true_max);
+      assert(SimdScan::Min<double>(doubles) == true_min * 0.5);
+      assert(SimdScan::Max<double>(doubles) == true_max * 0.5);
+      assert(SimdScan::Min<float>(floats) == true_min);
+      int64_t true_sum = std::accumulate(ints.begin(), ints.end(), int64_t(0));
+      assert(SimdScan::Sum<int>(ints) == true_sum);
+      assert(SimdScan::Sum<double>(doubles) == true_sum * 0.5);
+    }
+    std::vector<int> large(COUNT, std::numeric_limits<int>::max());
+    assert(SimdScan::Sum<int>(large) ==
+           int64_t(COUNT) * std::numeric_limits<int>::max());
+
+    UnrolledBiDirectionalList<int> list;
+    std::list<int> true_list;
+    for (int i = 0; i < COUNT * 20; i++) {
+      int value = next_random();
+      list.PushBack(value);
+      true_list.push_back(value);
+    }
+    for (int needle = -500; needle < 500; needle += 7) {
+      auto true_iter = std::find(true_list.begin(), true_list.end(), needle);
+      auto iter = list.Find(needle);
+      assert((true_iter == true_list.end()) == (iter == list.end()));
+      if (iter != list.end()) {
+        assert(std::distance(list.begin(), iter) ==
+               std::distance(true_list.begin(), true_iter));
+      }
+      assert(list.Count(needle) == static_cast<size_t>(
+          std::count(true_list.begin(), true_list.end(), needle)));
+    }
+    assert(list.Min() == *std::min_element(true_list.begin(),
+                                           true_list.end()));
+    assert(list.Max() == *std::max_element(true_list.begin(),
+                                           true_list.end()));
+    assert(list.Sum() == std::accumulate(true_list.begin(), true_list.end(),
+                                         int64_t(0)));
+    assert(SimdScan::Sum<int>(list.AsArray()) == list.Sum());
+
+    static_assert(std::is_same_v<SimdScan::SumType<float>, double>);
+    static_assert(std::is_same_v<SimdScan::SumType<long double>,
+                                 long double>);
+    static_assert(std::is_same_v<SimdScan::SumType<uint32_t>, int64_t>);
+    std::vector<uint64_t> unsigned_values = {uint64_t(1) << 63,
+                                            uint64_t(1) << 62, 5};
+    assert(SimdScan::Sum<uint64_t>(unsigned_values) ==
+           (uint64_t(1) << 63) + (uint64_t(1) << 62) + 5);
+    UnrolledBiDirectionalList<long double> precise;
+    precise.PushBack(1.0L);
+    precise.PushBack(std::numeric_limits<long double>::epsilon());
+    assert(precise.Sum() ==
+           1.0L + std::numeric_limits<long double>::epsilon());
+
+    bool exception_catched = false;
+    try {
+      UnrolledBiDirectionalList<double>().Min();
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    std::cout << "[PASS] Simd" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Simd" << std::endl;
+#endif // SKIP_Simd
+
+#ifndef SKIP_Parallel
+  {
+    BiDirectionalList<int> list;
+    const int kSize = COUNT * 1000;
+    for (int i = 0; i < kSize; i++) {
+      list.PushBack(i);
+    }
+    ParallelPolicy parallel{4, 100};
+    SequencedPolicy sequenced{100};
+
+    list.ForEach(parallel, [](int& value) { value *= 2; });
+    assert(list.Size() == kSize && *--list.end() == 2 * (kSize - 1));
+
+    std::vector<std::string> strings = list.Transform(parallel, [](int value) {
+      return std::to_string(value / 2);
+    });
+    assert(strings.size() == kSize);
+    for (int i = 0; i < kSize; i++) {
+      assert(strings[i] == std::to_string(i));
+    }
+
+    auto sum = [](int64_t left, int64_t right) { return left + right; };
+    int64_t true_sum = int64_t(kSize) * (kSize - 1);
+    assert(list.Reduce(parallel, int64_t(0), sum) == true_sum);
+    assert(list.Reduce(sequenced, int64_t(0), sum) == true_sum);
+
+    BiDirectionalList<double> doubles;
+    for (int i = 0; i < kSize; i++) {
+      doubles.PushBack(1.0 / (i + 1));
+    }
+    auto add = [](double left, double right) { return left + right; };
+    double reference = doubles.Reduce(SequencedPolicy{64}, 0.0, add);
+    for (size_t threads = 1; threads <= 8; threads++) {
+      assert(doubles.Reduce(ParallelPolicy{threads, 64}, 0.0, add) ==
+             reference);
+    }
+
+    BiDirectionalList<std::string> words = MakeStringList(COUNT * 10);
+    auto concatenate = [](std::string left, std::string right) {
+      return left + "," + right;
+    };
+    assert(words.Reduce(ParallelPolicy{3, 7}, std::string("start"),
+                        concatenate) ==
+           words.Reduce(SequencedPolicy{7}, std::string("start"),
+                        concatenate));
+
+    auto found = list.FindAny(parallel, [](int value) {
+      return value % 1000 == 998;
+    });
+    assert(found != list.end() && *found % 1000 == 998);
+    assert(list.FindAny(parallel, [](int value) { return value < 0; }) ==
+           list.end());
+    assert(*list.FindAny(sequenced, [](int value) { return value > 10; }) ==
+           12);
+    const BiDirectionalList<int>& const_list = list;
+    assert(*const_list.FindAny(parallel, [](int value) {
+      return value == 2 * (kSize - 1);
+    }) == 2 * (kSize - 1));
+
+    bool exception_catched = false;
+    try {
+      list.ForEach(parallel, [](int& value) {
+        if (value == 2 * 5000) {
+          throw std::runtime_error("Impossible value");
+        }
+      });
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+
+    BiDirectionalList<int> empty;
+    assert(empty.Reduce(parallel, 5, std::plus<int>()) == 5);
+    assert(empty.Transform(parallel, [](int value) {
+      return value;
+    }).empty());
+    std::cout << "[PASS] Parallel" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Parallel" << std::endl;
+#endif // SKIP_Parallel
+
+#if !defined(SKIP_Stats) && defined(BIDIRECTIONAL_LIST_STATS)
+  {
+    BiDirectionalList<int> list;
+    std::vector<BiDirectionalListStats> dumps;
+    list.SetStatsDumpHook([&dumps](const BiDirectionalListStats& stats) {
+      dumps.push_back(stats);
+    }, 4);
+    for (int i = 0; i < COUNT; ++i) {
+      list.PushBack(i);
+    }
+    BiDirectionalListStats stats = list.Stats();
+    assert(stats.allocations_ == COUNT);
+    assert(stats.frees_ == 0);
+    assert(stats.peak_size_ == COUNT);
+    assert(dumps.size() == COUNT / 4);
+    assert(dumps.back().allocations_ == COUNT / 4 * 4);
+
+    assert(*list.Find(9) == 9);
+    assert(list.Find(-1) == list.end());
+    assert(list.FindLast([](int value) { return value == COUNT - 2; }) !=
+           list.end());
+    stats = list.Stats();
+    assert(stats.find_links_ == 10 + COUNT + 2);
+    assert(stats.longest_scan_ == COUNT);
+
+    int steps = 0;
+    for (auto it = list.begin(); it != list.end(); ++it) {
+      ++steps;
+    }
+    auto it = list.end();
+    --it;
+    assert(list.Stats().iterator_links_ == static_cast<uint64_t>(steps) + 1);
+
+    bool exception_catched = false;
+    try {
+      ++list.end();
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    assert(list.Stats().bounds_exceptions_ == 1);
+
+    list.PopFront();
+    list.Erase(list.Find(5));
+    list.Clear();
+    stats = list.Stats();
+    assert(stats.frees_ == COUNT);
+    assert(stats.peak_size_ == COUNT);
+    assert(dumps.size() == 2 * COUNT / 4);
+
+    list.ResetStats();
+    list.SetStatsDumpHook(nullptr, 4);
+    list.PushBack(1);
+    stats = list.Stats();
+    assert(stats.allocations_ == 1 && stats.find_links_ == 0);
+    assert(stats.peak_size_ == 1);
+    assert(dumps.size() == 2 * COUNT / 4);
+
+    BiDirectionalList<int> copy(list);
+    BiDirectionalList<int> other;
+    other.PushBack(2);
+    other.PushBack(3);
+    copy.Splice(copy.end(), other);
+    assert(copy.Stats().allocations_ == 1);
+    assert(copy.Stats().peak_size_ == 3);
+    std::cout << "[PASS] Stats" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Stats" << std::endl;
+#endif // SKIP_Stats
+
+#if !defined(SKIP_Persistent) && defined(BIDIRECTIONAL_LIST_MMAP)
+  {
+    std::string path = "/tmp/bidirectional_list_test_" +
+                       std::to_string(getpid()) + ".bdl";
+    std::remove(path.c_str());
+    {
+      PersistentBiDirectionalList<int> list(path);
+      assert(list.IsEmpty() && list.begin() == list.end());
+      for (int i = 0; i < COUNT; ++i) {
+        list.PushBack(i);
+      }
+      list.PushFront(-1);
+      list.InsertAfter(list.Find(5), 100);
+      list.InsertBefore(list.Find(7), 200);
+      list.Erase(list.Find(3));
+      list.PopBack();
+      list.Sync();
+      // Без Sync() изменения при следующем открытии пропадут.
+      list.PopFront();
+      list.PushBack(300);
+      list.Clear();
+      list.PushBack(400);
+    }
+    std::vector<int> expected = {-1, 0, 1, 2, 4, 5, 100, 6, 200, 7};
+    for (int i = 8; i < COUNT - 1; ++i) {
+      expected.push_back(i);
+    }
+    {
+      PersistentBiDirectionalList<int> list(path);
+      assert(list.AsArray() == expected);
+      assert(list.Size() == expected.size());
+      std::vector<int> backwards;
+      for (auto it = list.end(); it != list.begin();) {
+        backwards.push_back(*--it);
+      }
+      assert(std::equal(backwards.rbegin(), backwards.rend(),
+                        expected.begin()));
+
+      // Узлы, освобождённые до Sync(), переиспользуются только после него.
+      uint64_t generation = list.SyncedGeneration();
+      for (int i = 0; i < 5; ++i) {
+        list.PopFront();
+      }
+      list.Sync();
+      assert(list.SyncedGeneration() == generation + 1);
+      for (int i = 0; i < 100000; ++i) {
+        list.PushBack(i);
+      }
+      list.Sync();
+      list.PushFront(500);
+    }
+    expected.erase(expected.begin(), expected.begin() + 5);
+    for (int i = 0; i < 100000; ++i) {
+      expected.push_back(i);
+    }
+    {
+      PersistentBiDirectionalList<int> list(path);
+      assert(list.AsArray() == expected);
+      assert(*list.begin() == expected.front());
+      assert(*--list.end() == 99999);
+      bool exception_catched = false;
+      try {
+        --list.begin();
+      } catch (const std::runtime_error&) {
+        exception_catched = true;
+      }
+      assert(exception_catched);
+      list.Clear();
+      list.Sync();
+    }
+    {
+      PersistentBiDirectionalList<int> list(path);
+      assert(list.IsEmpty());
+    }
+    bool exception_catched = false;
+    try {
+      PersistentBiDirectionalList<double> list(path);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    std::remove(path.c_str());
+    std::cout << "[PASS] Persistent" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Persistent" << std::endl;
+#endif // SKIP_Persistent
+
+#ifndef SKIP_Serialization
+  {
+    BiDirectionalList<int> list;
+    for (int i = 0; i < 100000; ++i) {
+      list.PushBack(i * 3);
+    }
+    std::stringstream stream;
+    list.Save(stream);
+    BiDirectionalList<int> loaded;
+    loaded.PushBack(-1);
+    loaded.Load(stream);
+    assert(loaded.AsArray() == list.AsArray());
+    assert(*--loaded.end() == 3 * 99999);
+
+    BiDirectionalList<std::string> strings = MakeStringList(COUNT);
+    strings.PushBack("");
+    strings.PushBack(std::string(100000, 'x'));
+    std::stringstream string_stream;
+    strings.Save(string_stream);
+    BiDirectionalList<std::string> loaded_strings;
+    loaded_strings.Load(string_stream);
+    assert(loaded_strings.AsArray() == strings.AsArray());
+
+    // Чтение по кускам: в памяти не больше одного куска.
+    std::stringstream chunked(stream.str());
+    BiDirectionalListReader<int> reader(chunked);
+    assert(reader.Size() == 100000);
+    std::vector<int> chunk;
+    size_t chunks = 0;
+    int64_t sum = 0;
+    while (reader.ReadChunk(chunk)) {
+      ++chunks;
+      assert(chunk.size() * sizeof(int) <= ListFileHeader::kChunkBytes);
+      sum = std::accumulate(chunk.begin(), chunk.end(), sum);
+    }
+    assert(chunks > 1);
+    assert(sum == int64_t(3) * 99999 * 100000 / 2);
+
+    BiDirectionalList<int> empty;
+    std::stringstream empty_stream;
+    empty.Save(empty_stream);
+    loaded.Load(empty_stream);
+    assert(loaded.IsEmpty());
+
+    // Битые и чужие данные не портят список.
+    std::string bytes = stream.str();
+    std::stringstream truncated(bytes.substr(0, bytes.size() / 2));
+    bool exception_catched = false;
+    try {
+      loaded.PushBack(7);
+      loaded.Load(truncated);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    assert(loaded.Size() == 1 && *loaded.begin() == 7);
+    // Размеры из файла проверяются до выделения памяти под них.
+    auto forged = [](uint32_t value_size, uint64_t size, uint64_t count,
+                     uint64_t chunk_bytes) {
+      ListFileHeader header{ListFileHeader::kMagic, ListFileHeader::kVersion,
+                            value_size, size};
+      uint64_t prefix[2] = {count, chunk_bytes};
+      std::string forged_bytes(reinterpret_cast<const char*>(&header),
+                               sizeof(header));
+      forged_bytes.append(reinterpret_cast<const char*>(prefix),
+                          sizeof(prefix));
+      return std::stringstream(forged_bytes);
+    };
+    std::stringstream huge_chunk = forged(0, 1, 1, uint64_t(1) << 45);
+    exception_catched = false;
+    try {
+      loaded_strings.Load(huge_chunk);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    std::stringstream huge_count = forged(sizeof(int), uint64_t(1) << 62,
+                                          uint64_t(1) << 62, 0);
+    exception_catched = false;
+    try {
+      loaded.Load(huge_count);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    std::stringstream huge_size = forged(sizeof(int), uint64_t(1) << 40, 1,
+                                         sizeof(int));
+    huge_size.seekp(0, std::ios::end);
+    huge_size.write("\0\0\0\0", 4);
+    exception_catched = false;
+    try {
+      BiDirectionalList<int, PoolAllocator<int>> pooled;
+      pooled.Load(huge_size);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    assert(loaded.Size() == 1 && *loaded.begin() == 7);
+
+    std::stringstream wrong_type(bytes);
+    exception_catched = false;
+    try {
+      BiDirectionalList<double> doubles;
+      doubles.Load(wrong_type);
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+
+#ifdef BIDIRECTIONAL_LIST_POSIX
+    std::string path = "/tmp/bidirectional_list_save_" +
+                       std::to_string(getpid()) + ".bin";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    list.Save(fd);
+    lseek(fd, 0, SEEK_SET);
+    loaded.Load(fd);
+    close(fd);
+    std::remove(path.c_str());
+    assert(loaded.AsArray() == list.AsArray());
+#endif
+    std::cout << "[PASS] Serialization" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Serialization" << std::endl;
+#endif // SKIP_Serialization
+
+#ifndef SKIP_Compact
+  {
+    CompactBiDirectionalList<int> list;
+    std::list<int> expected;
+    for (int i = 0; i < COUNT; ++i) {
+      list.PushBack(i);
+      list.PushFront(-i);
+      expected.push_back(i);
+      expected.push_front(-i);
+    }
+    assert(list.Size() == 2 * COUNT);
+    assert(list.AsArray() == std::vector<int>(expected.begin(),
+                                              expected.end()));
+
+    auto it = list.Find(5);
+    assert(it != list.end() && *it == 5);
+    list.InsertBefore(it, 100);
+    list.InsertAfter(it, 200);
+    list.Erase(it);
+    auto expected_it = std::find(expected.begin(), expected.end(), 5);
+    expected.insert(expected_it, 100);
+    expected.insert(std::next(expected_it), 200);
+    expected.erase(expected_it);
+    list.PopFront();
+    list.PopBack();
+    expected.pop_front();
+    expected.pop_back();
+    assert(list.AsArray() == std::vector<int>(expected.begin(),
+                                              expected.end()));
+    assert(*--list.end() == expected.back());
+
+    // Удалённые узлы переиспользуются, новые блоки не выделяются.
+    size_t capacity = list.CapacityBytes();
+    assert(list.RemoveIf([](int value) { return value % 2 == 0; }) ==
+           size_t(std::count_if(expected.begin(), expected.end(),
+                                [](int value) { return value % 2 == 0; })));
+    expected.remove_if([](int value) { return value % 2 == 0; });
+    for (int i = 0; i < COUNT; ++i) {
+      list.EmplaceBack(2 * i + 1000);
+      expected.push_back(2 * i + 1000);
+    }
+    assert(list.CapacityBytes() == capacity);
+    assert(list.CountIf([](int value) { return value >= 1000; }) == COUNT);
+    assert(*list.FindLast([](int value) { return value < 1000; }) ==
+           *std::find_if(expected.rbegin(), expected.rend(),
+                         [](int value) { return value < 1000; }));
+
+    list.Reverse();
+    expected.reverse();
+    assert(list.AsArray() == std::vector<int>(expected.begin(),
+                                              expected.end()));
+
+    CompactBiDirectionalList<int> copy = list;
+    CompactBiDirectionalList<int> moved = std::move(list);
+    assert(list.IsEmpty());
+    assert(copy.AsArray() == moved.AsArray());
+    list = copy;
+    copy.Clear();
+    assert(copy.IsEmpty() && copy.begin() == copy.end());
+    assert(list.AsArray() == moved.AsArray());
+
+    // Больше одного блока и нетривиальный тип.
+    CompactBiDirectionalList<std::string> strings;
+    strings.Reserve(100000);
+    for (int i = 0; i < 100000; ++i) {
+      strings.PushBack(std::to_string(i));
+    }
+    assert(strings.Size() == 100000);
+    assert(*strings.Find("99999") == "99999");
+    assert(strings.RemoveIf([](const std::string& value) {
+      return value.size() < 5;
+    }) == 10000);
+    assert(*strings.begin() == "10000");
+
+    // Сортировка, Unique и выгрузка -- как у BiDirectionalList.
+    CompactBiDirectionalList<std::pair<int, int>> pairs;
+    std::vector<std::pair<int, int>> pairs_checker;
+    for (int i = 0; i < COUNT * 33 + 7; i++) {
+      std::pair<int, int> temp(rand() % 10, i);
+      pairs.PushBack(temp);
+      pairs_checker.push_back(temp);
+    }
+    auto by_key = [](const std::pair<int, int>& left,
+                     const std::pair<int, int>& right) {
+      return left.first < right.first;
+    };
+    pairs.Sort(by_key);
+    std::stable_sort(pairs_checker.begin(), pairs_checker.end(), by_key);
+    assert(pairs.AsArray() == pairs_checker);
+    assert((--pairs.end())->second == pairs_checker.back().second);
+    assert(pairs.Unique([](const std::pair<int, int>& left,
+                           const std::pair<int, int>& right) {
+      return left.first == right.first;
+    }) == pairs_checker.size() - 10);
+    assert(pairs.Size() == 10 && pairs.begin()->first == 0);
+    assert(pairs.FindAll([](const std::pair<int, int>& value) {
+      return value.first % 2 == 0;
+    }).size() == 5);
+
+    CompactBiDirectionalList<int> sorted;
+    for (int i = 0; i < COUNT * 10; i++) {
+      sorted.PushFront(rand() % COUNT);
+    }
+    std::vector<int> sorted_checker = sorted.AsArray();
+    int calls = 0;
+    bool exception_catched = false;
+    try {
+      sorted.Sort([&calls](int left, int right) {
+        if (++calls == 100) {
+          throw std::runtime_error("comparison failed");
+        }
+        return left < right;
+      });
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    assert(sorted.Size() == sorted_checker.size());
+    std::vector<int> after_throw = sorted.AsArray();
+    std::sort(after_throw.begin(), after_throw.end());
+    std::sort(sorted_checker.begin(), sorted_checker.end());
+    assert(after_throw == sorted_checker);
+    sorted.Sort();
+    assert(sorted.AsArray() == sorted_checker);
+    assert(*--sorted.end() == sorted_checker.back());
+    std::vector<int> buffer(sorted.Size());
+    assert(sorted.CopyTo(std::span<int>(buffer)) == buffer.size());
+    assert(buffer == sorted_checker);
+    int64_t sum = std::accumulate(sorted_checker.begin(),
+                                  sorted_checker.end(), int64_t(0));
+    assert(sorted.Reduce(ParallelPolicy{2, 7}, int64_t(0),
+                         std::plus<int64_t>()) == sum);
+    assert(sorted.Transform(SequencedPolicy{5}, [](int value) {
+      return value * 2;
+    }).size() == sorted.Size());
+    sorted.ForEach(ParallelPolicy{2, 7}, [](int& value) { ++value; });
+    assert(*sorted.begin() == sorted_checker.front() + 1);
+    assert(*sorted.FindAny(ParallelPolicy{2, 7}, [](int value) {
+      return value == COUNT;
+    }) == COUNT);
+
+    // Файл общий с BiDirectionalList.
+    std::stringstream stream;
+    sorted.Save(stream);
+    BiDirectionalList<int> plain;
+    plain.Load(stream);
+    assert(plain.AsArray() == sorted.AsArray());
+    std::stringstream plain_stream;
+    plain.Save(plain_stream);
+    CompactBiDirectionalList<int> reloaded;
+    reloaded.PushBack(-1);
+    reloaded.Load(plain_stream);
+    assert(reloaded.AsArray() == plain.AsArray());
+    std::vector<int> drained = std::move(reloaded).AsArray();
+    assert(drained == plain.AsArray() && reloaded.IsEmpty());
+
+    exception_catched = false;
+    try {
+      ++moved.end();
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    exception_catched = false;
+    try {
+      copy.PopBack();
+    } catch (const std::runtime_error&) {
+      exception_catched = true;
+    }
+    assert(exception_catched);
+    std::cout << "[PASS] Compact" << std::endl;
+  }
+#else
+  std::cout << "[SKIPPED] Compact" << std::endl;
+#endif // SKIP_Compact
+
   return 0;
 }